@@ -16,7 +16,7 @@ def plot_elo_ratings(models, elos, games_per_gen, output):
     plt.savefig(output)
 
 parser = argparse.ArgumentParser()
-parser.add_argument("file", help="Path to elo csv file as generated by bayeselo")
+parser.add_argument("file", help="Path to elo_ratings.txt as written by deep_ww --ranking")
 parser.add_argument("--output", help="Path to output", default="elo_progression.png")
 parser.add_argument("--games", help="Number of games per iteration", default=5000, type=int)
 args = parser.parse_args()
@@ -1,6 +1,6 @@
 #!/bin/bash
 # Complete Universal Model ELO Tournament Script
-# Runs tournament, calculates ELO with BayesElo, and generates plots
+# Runs tournament (deep_ww rates the games itself) and generates plots
 #
 # Configuration: 18 tournaments × 10 games/matchup = 10,440 games per variant
 
@@ -19,56 +19,6 @@ COLUMNS=12
 ROWS=10
 SAMPLES=1200  # Match training configuration
 
-# BayesElo location - will check multiple common locations
-BAYESELO_PATHS=(
-    "../../../BayesianElo/src/bayeselo"     # Sibling to wallgame repo (YOUR ACTUAL LOCATION)
-    "../../bayeselo/src/bayeselo"           # Alternative lowercase naming
-    "../../../bayeselo/src/bayeselo"        # Parent directory
-    "$HOME/bayeselo/src/bayeselo"           # Home directory
-    "/usr/local/bin/bayeselo"               # System install
-    "bayeselo"                               # In PATH
-)
-
-#==============================================================================
-# HELPER FUNCTIONS
-#==============================================================================
-
-find_bayeselo() {
-    for path in "${BAYESELO_PATHS[@]}"; do
-        if [ -f "$path" ] || command -v "$path" &> /dev/null; then
-            echo "$path"
-            return 0
-        fi
-    done
-    return 1
-}
-
-print_bayeselo_help() {
-    cat << 'EOF'
-
-ERROR: BayesElo not found!
-
-BayesElo is required to calculate ELO ratings from tournament results.
-
-Installation options:
-
-1. Install as sibling to wallgame repo (recommended):
-   cd /mnt/c/Users/Nilo/repos
-   git clone https://github.com/ddugovic/bayeselo.git
-   cd bayeselo/src
-   make
-
-2. Install elsewhere and add to PATH:
-   git clone https://github.com/ddugovic/bayeselo.git
-   cd bayeselo/src
-   make
-   # Add to PATH or update BAYESELO_PATHS in this script
-
-After installation, re-run this script.
-
-EOF
-}
-
 #==============================================================================
 # TOURNAMENT EXECUTION
 #==============================================================================
@@ -100,8 +50,8 @@ run_variant_tournament() {
     cd ..
 
     # Move results to variant-specific directory
-    mv "$MODELS_DIR/games.pgn" "$output_dir/" 2>/dev/null || true
     mv "$MODELS_DIR/games.json" "$output_dir/" 2>/dev/null || true
+    mv "$MODELS_DIR/elo_ratings.txt" "$output_dir/" 2>/dev/null || true
 
     echo ""
     echo "=========================================="
@@ -112,62 +62,23 @@ run_variant_tournament() {
 }
 
 #==============================================================================
-# ELO CALCULATION
+# RESULTS
 #==============================================================================
 
-calculate_elo() {
+show_ratings() {
     local variant=$1
-    local pgn_file="$OUTPUT_DIR/$variant/games.pgn"
-    local output_txt="$OUTPUT_DIR/$variant/elo_ratings.txt"
-    local output_csv="$OUTPUT_DIR/$variant/elo_ratings.csv"
+    local ratings_file="$OUTPUT_DIR/$variant/elo_ratings.txt"
 
-    if [ ! -f "$pgn_file" ]; then
-        echo "ERROR: PGN file not found: $pgn_file"
+    if [ ! -f "$ratings_file" ]; then
+        echo "ERROR: Ratings file not found: $ratings_file"
         return 1
     fi
 
-    echo "=========================================="
-    echo "Calculating ELO for $variant variant"
-    echo "=========================================="
-    echo "Input: $pgn_file"
-    echo ""
-
-    # Create BayesElo command file (absolute path for PGN)
-    local abs_pgn_path=$(cd "$(dirname "$pgn_file")" && pwd)/$(basename "$pgn_file")
-    local abs_output_txt=$(cd "$(dirname "$output_txt")" && pwd)/$(basename "$output_txt")
-    local abs_output_csv=$(cd "$(dirname "$output_csv")" && pwd)/$(basename "$output_csv")
-
-    cat > /tmp/bayeselo_commands_$variant.txt << EOF
-readpgn $abs_pgn_path
-elo
-mm
-exactdist
-ratings >$abs_output_txt
-offset 1500
-ratings >$abs_output_csv
-x
-EOF
-
-    # Run BayesElo
-    $BAYESELO_CMD < /tmp/bayeselo_commands_$variant.txt
-
-    echo ""
-    echo "Results saved:"
-    echo "  Text: $output_txt"
-    echo "  CSV:  $output_csv"
+    echo "Top 10 models for $variant variant:"
+    echo "----------------------------------------"
+    head -11 "$ratings_file"
+    echo "----------------------------------------"
     echo ""
-
-    # Display top 10 models
-    if [ -f "$output_txt" ]; then
-        echo "Top 10 models for $variant variant:"
-        echo "----------------------------------------"
-        head -13 "$output_txt" | tail -10
-        echo "----------------------------------------"
-        echo ""
-    fi
-
-    # Clean up
-    rm /tmp/bayeselo_commands_$variant.txt
 }
 
 #==============================================================================
@@ -176,11 +87,11 @@ EOF
 
 generate_plot() {
     local variant=$1
-    local csv_file="$OUTPUT_DIR/$variant/elo_ratings.csv"
+    local ratings_file="$OUTPUT_DIR/$variant/elo_ratings.txt"
     local output_png="$OUTPUT_DIR/$variant/elo_progression.png"
 
-    if [ ! -f "$csv_file" ]; then
-        echo "WARNING: CSV file not found: $csv_file"
+    if [ ! -f "$ratings_file" ]; then
+        echo "WARNING: Ratings file not found: $ratings_file"
         return 1
     fi
 
@@ -194,7 +105,7 @@ generate_plot() {
 
     # Run plotting script
     cd scripts
-    python3 plot_elo.py "$csv_file" \
+    python3 plot_elo.py "$ratings_file" \
         --output "$output_png" \
         --games 4000 2>/dev/null || {
         echo "WARNING: Plot generation failed (missing dependencies?)"
@@ -234,15 +145,6 @@ if [ "$MODEL_COUNT" -ne 59 ]; then
     fi
 fi
 
-# Find BayesElo
-BAYESELO_CMD=$(find_bayeselo)
-if [ $? -ne 0 ]; then
-    print_bayeselo_help
-    exit 1
-fi
-echo "✓ BayesElo found: $BAYESELO_CMD"
-echo ""
-
 # Ask which variant(s) to run
 echo "Which variant(s) do you want to run?"
 echo "1) Standard only"
@@ -270,13 +172,11 @@ done
 echo ""
 echo "=========================================="
 echo "All tournaments complete!"
-echo "Processing results with BayesElo..."
 echo "=========================================="
 echo ""
 
-# Calculate ELO for each variant
 for variant in "${VARIANTS_TO_RUN[@]}"; do
-    calculate_elo "$variant"
+    show_ratings "$variant"
 done
 
 echo ""
@@ -303,10 +203,8 @@ echo "Results:"
 for variant in "${VARIANTS_TO_RUN[@]}"; do
     echo ""
     echo "$variant variant:"
-    echo "  PGN:    $OUTPUT_DIR/$variant/games.pgn"
     echo "  JSON:   $OUTPUT_DIR/$variant/games.json"
     echo "  ELO:    $OUTPUT_DIR/$variant/elo_ratings.txt"
-    echo "  CSV:    $OUTPUT_DIR/$variant/elo_ratings.csv"
     if [ -f "$OUTPUT_DIR/$variant/elo_progression.png" ]; then
         echo "  Plot:   $OUTPUT_DIR/$variant/elo_progression.png"
     fi
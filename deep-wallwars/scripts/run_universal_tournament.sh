@@ -65,8 +65,8 @@ run_variant_tournament() {
     cd ..
 
     # Move results to variant-specific directory
-    mv "$MODELS_DIR/games.pgn" "$output_dir/"
     mv "$MODELS_DIR/games.json" "$output_dir/"
+    mv "$MODELS_DIR/elo_ratings.txt" "$output_dir/"
 
     echo "=========================================="
     echo "$variant tournament complete!"
@@ -110,19 +110,7 @@ echo "=========================================="
 echo "ALL TOURNAMENTS COMPLETE!"
 echo "=========================================="
 echo ""
-echo "Next steps:"
-echo "1. Calculate ELO ratings with BayesElo:"
-echo "   cd scripts"
-echo "   ./calculate_elo.sh"
-echo ""
-echo "2. Or manually with BayesElo:"
-echo "   readpgn $OUTPUT_DIR/standard/games.pgn"
-echo "   elo"
-echo "   mm"
-echo "   exactdist"
-echo "   ratings"
-echo ""
-echo "Results locations:"
-echo "  Standard: $OUTPUT_DIR/standard/games.pgn"
-echo "  Classic:  $OUTPUT_DIR/classic/games.pgn"
+echo "Elo ratings (written by deep_ww after every tournament):"
+echo "  Standard: $OUTPUT_DIR/standard/elo_ratings.txt"
+echo "  Classic:  $OUTPUT_DIR/classic/elo_ratings.txt"
 echo "=========================================="
@@ -1,22 +1,74 @@
 #include "batched_model.hpp"
 
+#include <folly/Overload.h>
+#include <folly/executors/GlobalExecutor.h>
+#include <folly/io/async/Request.h>
+
 #include <algorithm>
+#include <atomic>
 
-#include "cuda_wrappers.hpp"
+#include "host_buffer.hpp"
 #include "model.hpp"
 
 constexpr int kDefaultBatchesInQueue = 16;
+// Every lane is guaranteed 1/kReservedShare of each batch (at least one slot) if it has tasks.
+constexpr int kReservedShare = 16;
+constexpr std::int64_t kWaitHistogramBucketUs = 100;
+constexpr std::int64_t kWaitHistogramMaxUs = 20'000;
+// Weight of the newest sample in the moving average of the inference time (adaptive batching).
+constexpr double kInferenceTimeSmoothing = 0.1;
+
+InferenceAwaitable::InferenceAwaitable(BatchedModel& model, ModelPosition position,
+                                       InferencePriority priority)
+    : m_model{&model}, m_position{std::move(position)}, m_priority{priority} {}
+
+void InferenceAwaitable::await_suspend(std::coroutine_handle<> continuation) {
+    m_continuation = continuation;
+    // Resuming inline would run the rest of the coroutine on the inference worker.
+    if (!m_executor) {
+        m_executor = folly::getGlobalCPUExecutor();
+    }
+    m_context = folly::RequestContext::saveContext();
+    // The worker may resume us before enqueue returns, so we must not touch any members after.
+    m_model->enqueue(BatchedModel::InferenceTask{std::move(m_position), this}, m_priority);
+}
+
+void InferenceAwaitable::resume(folly::Try<InferenceResult> result) {
+    m_result = std::move(result);
+
+    // Once added, the continuation may run (and destroy us) at any time. Like folly's own
+    // awaitables, it resumes in the request context it suspended in (e.g. its inference priority).
+    auto executor = std::move(m_executor);
+    executor->add([continuation = m_continuation, context = std::move(m_context)]() mutable {
+        folly::RequestContextScopeGuard guard{std::move(context)};
+        continuation.resume();
+    });
+}
 
 BatchedModel::BatchedModel(std::unique_ptr<Model> model)
     : BatchedModel{std::move(model), kDefaultBatchesInQueue * model->batch_size()} {}
 
-BatchedModel::BatchedModel(std::unique_ptr<Model> model, int queue_size) : m_tasks(queue_size) {
+BatchedModel::BatchedModel(std::unique_ptr<Model> model, int queue_size)
+    : m_histograms{std::in_place,
+                   BatchHistograms{{1, 0, model->batch_size() + 1},
+                                   {kWaitHistogramBucketUs, 0, kWaitHistogramMaxUs}}} {
+    for (int i = 0; i < kNumInferencePriorities; ++i) {
+        m_lanes.emplace_back(queue_size);
+    }
     m_models.push_back(std::move(model));
     m_workers.emplace_back([&] { run_worker(0); });
 }
 
-BatchedModel::BatchedModel(std::vector<std::unique_ptr<Model>> models, int queue_size)
-    : m_tasks(queue_size), m_models{std::move(models)} {
+BatchedModel::BatchedModel(std::vector<std::unique_ptr<Model>> models, int queue_size,
+                           BatchingOptions batching)
+    : m_models{std::move(models)},
+      m_batching{batching},
+      m_histograms{std::in_place,
+                   BatchHistograms{{1, 0, m_models.front()->batch_size() + 1},
+                                   {kWaitHistogramBucketUs, 0, kWaitHistogramMaxUs}}} {
+    for (int i = 0; i < kNumInferencePriorities; ++i) {
+        m_lanes.emplace_back(queue_size);
+    }
     for (std::size_t i = 0; i < m_models.size(); ++i) {
         m_workers.emplace_back([this, i] { run_worker(i); });
     }
@@ -25,19 +77,68 @@ BatchedModel::BatchedModel(std::vector<std::unique_ptr<Model>> models, int queue
 BatchedModel::~BatchedModel() {
     // Sentinel values so the workers stop (eventually)
     for (std::size_t i = 0; i < m_workers.size(); ++i) {
-        m_tasks.blockingWrite(InferenceTask{});
+        enqueue(InferenceTask{}, InferencePriority::Background);
     }
 }
 
-folly::SemiFuture<ModelOutput> BatchedModel::inference(std::vector<float> states) {
-    InferenceTask task{std::move(states), {}};
-    auto result = task.output.getSemiFuture();
+folly::SemiFuture<InferenceResult> BatchedModel::inference(std::vector<float> states,
+                                                           InferencePriority priority) {
+    folly::Promise<InferenceResult> promise;
+    auto result = promise.getSemiFuture();
+
+    enqueue(InferenceTask{std::move(states), std::move(promise)}, priority);
+
+    return result;
+}
+
+folly::SemiFuture<InferenceResult> BatchedModel::inference(Board board, Turn turn,
+                                                           InferencePriority priority) {
+    folly::Promise<InferenceResult> promise;
+    auto result = promise.getSemiFuture();
 
-    m_tasks.blockingWrite(std::move(task));
+    enqueue(InferenceTask{ModelPosition{std::move(board), turn}, std::move(promise)}, priority);
 
     return result;
 }
 
+InferenceAwaitable BatchedModel::co_inference(Board board, Turn turn, InferencePriority priority) {
+    return InferenceAwaitable{*this, ModelPosition{std::move(board), turn}, priority};
+}
+
+folly::SemiFuture<float> BatchedModel::value_inference(Board board, Turn turn,
+                                                       InferencePriority priority) {
+    folly::Promise<InferenceResult> promise;
+    auto result = promise.getSemiFuture();
+
+    enqueue(InferenceTask{ModelPosition{std::move(board), turn}, std::move(promise), true},
+            priority);
+
+    return std::move(result).deferValue(
+        [](InferenceResult const& inference) { return inference.value; });
+}
+
+folly::SemiFuture<std::vector<float>> BatchedModel::value_inference(
+    std::vector<ModelPosition> positions, InferencePriority priority) {
+    std::vector<folly::SemiFuture<float>> values;
+    values.reserve(positions.size());
+    for (auto& position : positions) {
+        values.push_back(value_inference(std::move(position.board), position.turn, priority));
+    }
+
+    return folly::collect(std::move(values));
+}
+
+void BatchedModel::enqueue(InferenceTask task, InferencePriority priority) {
+    m_lanes[int(priority)].blockingWrite(std::move(task));
+    m_pending.release();
+}
+
+void BatchedModel::deliver(InferenceOutput& output, folly::Try<InferenceResult> result) {
+    folly::variant_match(
+        output, [&](InferenceAwaitable* awaitable) { awaitable->resume(std::move(result)); },
+        [&](folly::Promise<InferenceResult>& promise) { promise.setTry(std::move(result)); });
+}
+
 std::size_t BatchedModel::total_inferences() const {
     return m_inferences;
 }
@@ -46,6 +147,22 @@ std::size_t BatchedModel::total_batches() const {
     return m_batches;
 }
 
+std::size_t BatchedModel::total_value_batches() const {
+    return m_value_batches;
+}
+
+std::size_t BatchedModel::total_output_slabs() const {
+    return m_output_slabs;
+}
+
+std::chrono::nanoseconds BatchedModel::total_worker_time() const {
+    return std::chrono::nanoseconds{m_worker_nanos.load()};
+}
+
+BatchHistograms BatchedModel::batch_histograms() const {
+    return m_histograms.copy();
+}
+
 int BatchedModel::wall_prior_size() const {
     return m_models.front()->wall_prior_size();
 }
@@ -58,45 +175,179 @@ int BatchedModel::prior_size() const {
     return m_models.front()->prior_size();
 }
 
+void BatchedModel::shut_down(std::vector<InferenceOutput>& dequeued_outputs) {
+    // Awaiters are only ever resumed by a delivery, so everything still queued has to fail rather
+    // than be dropped.
+    folly::exception_wrapper const error{folly::BrokenPromise{"InferenceResult"}};
+    for (InferenceOutput& output : dequeued_outputs) {
+        deliver(output, folly::Try<InferenceResult>{error});
+    }
+    dequeued_outputs.clear();
+
+    // The sentinels of the other workers are put back for them.
+    int sentinels = 0;
+    while (m_pending.try_acquire()) {
+        InferenceTask task;
+        while (!std::ranges::any_of(m_lanes, [&](auto& lane) { return lane.read(task); })) {
+        }
+        if (std::holds_alternative<std::monostate>(task.input)) {
+            ++sentinels;
+        } else {
+            deliver(task.output, folly::Try<InferenceResult>{error});
+        }
+    }
+    for (int i = 0; i < sentinels; ++i) {
+        enqueue(InferenceTask{}, InferencePriority::Background);
+    }
+}
+
 void BatchedModel::run_worker(std::size_t idx) {
-    std::vector<folly::Promise<ModelOutput>> dequeued_promises;
+    Model& model = *m_models[idx];
+    std::vector<InferenceOutput> dequeued_outputs;
+
+    // The model decides where its inputs and outputs live, e.g. pinned memory for TensorRT.
+    auto const allocator = model.host_allocator();
+    HostBuffer<float> states(model.batch_size() * model.state_size(), allocator);
+    HostBuffer<float> values(model.batch_size(), allocator);
+
+    // Priors are written straight into a slab which is then shared by all results of the batch.
+    SlabPool prior_slabs(model.batch_size() * model.prior_size(), allocator);
+
+    // Moving average of the inference time, only used for adaptive batching.
+    std::chrono::microseconds inference_time{0};
+
+    int const reserved_share = std::max(1, model.batch_size() / kReservedShare);
+    std::array<int, kNumInferencePriorities> reserved;
 
-    // This substantially improves GPU memory transfer times but feels a bit hacky to use
-    // cuda-specific code here...
-    PinnedBuffer<float> states(m_models[idx]->batch_size() * m_models[idx]->state_size());
-    PinnedBuffer<float> priors(m_models[idx]->batch_size() * m_models[idx]->prior_size());
-    PinnedBuffer<float> values(m_models[idx]->batch_size());
+    // Must only be called after acquiring a permit from m_pending, so some lane has a task for us.
+    auto read_task = [&](InferenceTask& task) {
+        // A lane may briefly look empty while a write to it is still in progress, so we retry.
+        while (true) {
+            for (int lane = 0; lane < kNumInferencePriorities; ++lane) {
+                if (reserved[lane] > 0 && m_lanes[lane].read(task)) {
+                    --reserved[lane];
+                    return;
+                }
+            }
+
+            for (auto& lane : m_lanes) {
+                if (lane.read(task)) {
+                    return;
+                }
+            }
+        }
+    };
 
     while (true) {
-        for (int i = 0; i < m_models[idx]->batch_size(); ++i) {
-            InferenceTask task;
+        InferenceTask task;
+        // Whether some task of the batch needs priors.
+        bool needs_priors = false;
+        reserved.fill(reserved_share);
+        m_pending.acquire();
+        read_task(task);
+        auto const first_task = std::chrono::steady_clock::now();
 
-            if (i == 0) {
-                m_tasks.blockingRead(task);
-            } else if (!m_tasks.read(task)) {
-                break;
+        int min_fill = std::min(m_batching.min_batch_fill, model.batch_size());
+        auto deadline = first_task + m_batching.max_wait;
+        if (m_batching.latency_target) {
+            min_fill = model.batch_size();
+            deadline = first_task + std::max(*m_batching.latency_target - inference_time,
+                                             std::chrono::microseconds{0});
+        }
+
+        for (int i = 0; i < model.batch_size(); ++i) {
+            if (i > 0) {
+                if (!m_pending.try_acquire() &&
+                    (int(dequeued_outputs.size()) >= min_fill ||
+                     !m_pending.try_acquire_until(deadline))) {
+                    break;
+                }
+                read_task(task);
             }
 
-            if (task.state.empty()) {
+            if (std::holds_alternative<std::monostate>(task.input)) {
+                shut_down(dequeued_outputs);
                 return;
             }
 
-            std::ranges::copy(task.state, states.data() + m_models[idx]->state_size() * i);
-            dequeued_promises.push_back(std::move(task.output));
+            std::span<float> slot{states.data() + model.state_size() * dequeued_outputs.size(),
+                                  std::size_t(model.state_size())};
+
+            try {
+                folly::variant_match(
+                    task.input, [](std::monostate) {},
+                    [&](ModelInput const& state) {
+                        if (state.size() != slot.size()) {
+                            throw std::runtime_error("Model input size does not match model!");
+                        }
+                        std::ranges::copy(state, slot.begin());
+                    },
+                    [&](ModelPosition const& position) {
+                        fill_model_input(position.board, position.turn, slot);
+                    });
+            } catch (std::exception const&) {
+                deliver(task.output, folly::Try<InferenceResult>{
+                                         folly::exception_wrapper{std::current_exception()}});
+                continue;
+            }
+
+            needs_priors |= !task.value_only;
+            dequeued_outputs.push_back(std::move(task.output));
+        }
+
+        if (dequeued_outputs.empty()) {
+            continue;
+        }
+
+        auto const batch_start = std::chrono::steady_clock::now();
+        m_histograms.withWLock([&](BatchHistograms& histograms) {
+            histograms.fill.addValue(dequeued_outputs.size());
+            histograms.wait_us.addValue(
+                std::chrono::duration_cast<std::chrono::microseconds>(batch_start - first_task)
+                    .count());
+        });
+
+        std::size_t const filled = dequeued_outputs.size();
+        auto const batch_states = std::span<float>(states).first(filled * model.state_size());
+        auto const batch_values = std::span<float>(values).first(filled);
+        std::shared_ptr<HostBuffer<float>> priors;
+        if (needs_priors) {
+            std::size_t const allocations = prior_slabs.allocations();
+            priors = prior_slabs.acquire();
+            m_output_slabs += prior_slabs.allocations() - allocations;
+            model.inference(batch_states,
+                            {std::span<float>(*priors).first(filled * model.prior_size()),
+                             batch_values});
+        } else {
+            model.value_inference(batch_states, batch_values);
+            ++m_value_batches;
         }
 
-        m_models[idx]->inference(states, {priors, values});
+        if (m_batching.latency_target) {
+            auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - batch_start);
+            inference_time = std::chrono::microseconds{std::int64_t(
+                (1 - kInferenceTimeSmoothing) * inference_time.count() +
+                kInferenceTimeSmoothing * elapsed.count())};
+        }
 
-        for (std::size_t i = 0; i < dequeued_promises.size(); ++i) {
-            std::vector<float> prior{priors.data() + m_models[idx]->prior_size() * i,
-                                     priors.data() + m_models[idx]->prior_size() * (i + 1)};
+        for (std::size_t i = 0; i < dequeued_outputs.size(); ++i) {
+            InferenceResult result{nullptr, {}, values[i]};
+            if (priors) {
+                result.slab = priors;
+                result.prior = {priors->data() + model.prior_size() * i,
+                                std::size_t(model.prior_size())};
+            }
 
-            dequeued_promises[i].setValue(ModelOutput{std::move(prior), values[i]});
+            deliver(dequeued_outputs[i], folly::Try<InferenceResult>{std::move(result)});
         }
 
         m_batches += 1;
-        m_inferences += dequeued_promises.size();
+        m_inferences += dequeued_outputs.size();
+        m_worker_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - batch_start)
+                              .count();
 
-        dequeued_promises.clear();
+        dequeued_outputs.clear();
     }
 }
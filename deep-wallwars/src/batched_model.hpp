@@ -1,23 +1,115 @@
 #pragma once
 
+#include <folly/Executor.h>
 #include <folly/MPMCQueue.h>
+#include <folly/Synchronized.h>
+#include <folly/Try.h>
 #include <folly/experimental/coro/Task.h>
 #include <folly/futures/Future.h>
+#include <folly/io/async/Request.h>
+#include <folly/stats/Histogram.h>
 
+#include <array>
+#include <chrono>
+#include <coroutine>
 #include <memory>
+#include <optional>
+#include <semaphore>
+#include <span>
 #include <thread>
+#include <variant>
 #include <vector>
 
+#include "gamestate.hpp"
+#include "inference_priority.hpp"
 #include "state_conversions.hpp"
 
+class BatchedModel;
 class Model;
 
+template <typename T>
+class HostBuffer;
+
+// Compact description of a position to run inference on. Workers tensorize it directly into their
+// batch buffer, which is much cheaper to pass around than the full model input.
+struct ModelPosition {
+    Board board;
+    Turn turn;
+};
+
+// Result of a single inference. The priors are a view into the output buffer of the batch that the
+// position was evaluated in. Workers do not reuse that buffer while any result still references it.
+// Value-only inferences have no slab and no priors.
+struct InferenceResult {
+    std::shared_ptr<HostBuffer<float> const> slab;
+    std::span<float const> prior;
+    float value;
+};
+
+// Awaitable returned by BatchedModel::co_inference(). The suspended coroutine and the result slot
+// live in the awaitable itself, so unlike the future-based API no shared state is allocated. When
+// awaited from a folly::coro::Task, the worker resumes the coroutine directly on its executor
+// (otherwise on the global CPU executor), in the request context it was suspended in.
+class InferenceAwaitable {
+public:
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> continuation);
+
+    InferenceResult await_resume() {
+        return std::move(m_result).value();
+    }
+
+    friend InferenceAwaitable co_viaIfAsync(folly::Executor::KeepAlive<> executor,
+                                            InferenceAwaitable&& awaitable) noexcept {
+        awaitable.m_executor = std::move(executor);
+        return std::move(awaitable);
+    }
+
+private:
+    friend class BatchedModel;
+
+    InferenceAwaitable(BatchedModel& model, ModelPosition position, InferencePriority priority);
+
+    void resume(folly::Try<InferenceResult> result);
+
+    BatchedModel* m_model;
+    ModelPosition m_position;
+    InferencePriority m_priority;
+    folly::Executor::KeepAlive<> m_executor;
+    std::shared_ptr<folly::RequestContext> m_context;
+    std::coroutine_handle<> m_continuation;
+    folly::Try<InferenceResult> m_result;
+};
+
+// Controls when a worker stops collecting tasks and fires a (possibly partial) batch. The defaults
+// fire as soon as the queue is drained, which is ideal when the queue is always full (self-play)
+// but produces tiny batches under light load.
+struct BatchingOptions {
+    // Keep waiting for more tasks until the batch holds at least this many (capped at the model
+    // batch size) ...
+    int min_batch_fill = 1;
+    // ... but never longer than this after the first task of the batch was dequeued.
+    std::chrono::microseconds max_wait{0};
+    // Adaptive mode: when set, wait for a full batch for as long as the target allows after
+    // accounting for the (measured) inference time. Overrides the two settings above.
+    std::optional<std::chrono::microseconds> latency_target;
+};
+
+struct BatchHistograms {
+    folly::Histogram<std::int64_t> fill;
+    folly::Histogram<std::int64_t> wait_us;
+};
+
 class BatchedModel {
 public:
     BatchedModel(std::unique_ptr<Model> model);
     BatchedModel(std::unique_ptr<Model> model, int queue_size);
     BatchedModel(std::vector<std::unique_ptr<Model>> models);
-    BatchedModel(std::vector<std::unique_ptr<Model>> models, int queue_size);
+    BatchedModel(std::vector<std::unique_ptr<Model>> models, int queue_size,
+                 BatchingOptions batching = {});
 
     ~BatchedModel();
 
@@ -27,28 +119,76 @@ public:
     BatchedModel& operator=(BatchedModel const& other) = delete;
     BatchedModel& operator=(BatchedModel&& other) = delete;
 
-    folly::SemiFuture<ModelOutput> inference(std::vector<float> state);
+    // Requests are queued in one lane per priority. Batches are composed highest priority first,
+    // except that every lane is guaranteed a small share of each batch so that a steady stream of
+    // high priority requests cannot starve the others.
+    folly::SemiFuture<InferenceResult> inference(
+        std::vector<float> state, InferencePriority priority = current_inference_priority());
+    folly::SemiFuture<InferenceResult> inference(
+        Board board, Turn turn, InferencePriority priority = current_inference_priority());
+    // Same as above, but must be co_awaited directly. Cheaper than going through a future.
+    InferenceAwaitable co_inference(Board board, Turn turn,
+                                    InferencePriority priority = current_inference_priority());
+    // Only the value of the position (from the perspective of the player to move), for analysis
+    // that needs no priors. Batches of value-only requests let the model skip the policy head.
+    folly::SemiFuture<float> value_inference(
+        Board board, Turn turn, InferencePriority priority = current_inference_priority());
+    // Values of many positions at once, e.g. all positions of a recorded game. They are queued
+    // together, so they end up in as few batches as possible.
+    folly::SemiFuture<std::vector<float>> value_inference(
+        std::vector<ModelPosition> positions,
+        InferencePriority priority = current_inference_priority());
 
     std::size_t total_inferences() const;
     std::size_t total_batches() const;
+    // Batches that consisted of value-only requests (see value_inference).
+    std::size_t total_value_batches() const;
+    // Number of output buffers the workers had to allocate. In steady state this stays flat since
+    // buffers are recycled once all results referencing them are gone.
+    std::size_t total_output_slabs() const;
+    // Time the workers spent running batches through the model and delivering the results. Waiting
+    // for the batch to fill up is tracked separately in the histograms below.
+    std::chrono::nanoseconds total_worker_time() const;
+    // Snapshot of the per-batch fill and the time spent waiting for the batch to fill up.
+    BatchHistograms batch_histograms() const;
     int wall_prior_size() const;
     int move_prior_size() const;
     int prior_size() const;
 
 private:
+    friend class InferenceAwaitable;
+
+    // Whoever is waiting for the result: a future (inference) or a suspended coroutine
+    // (co_inference).
+    using InferenceOutput = std::variant<InferenceAwaitable*, folly::Promise<InferenceResult>>;
+
     struct InferenceTask {
-        std::vector<float> state;
-        folly::Promise<ModelOutput> output;
+        // An empty input is the sentinel that stops a worker.
+        std::variant<std::monostate, ModelInput, ModelPosition> input;
+        InferenceOutput output;
+        bool value_only = false;
     };
 
-    folly::MPMCQueue<InferenceTask> m_tasks;
+    std::vector<folly::MPMCQueue<InferenceTask>> m_lanes;
+    // Counts the tasks across all lanes, so workers can block on all of them at once.
+    std::counting_semaphore<> m_pending{0};
     std::vector<std::unique_ptr<Model>> m_models;
+    BatchingOptions m_batching;
 
     std::atomic<std::size_t> m_batches = 0;
+    std::atomic<std::size_t> m_value_batches = 0;
     std::atomic<std::size_t> m_inferences = 0;
+    std::atomic<std::size_t> m_output_slabs = 0;
+    std::atomic<std::int64_t> m_worker_nanos = 0;
+    folly::Synchronized<BatchHistograms> m_histograms;
 
     // Worker threads need to come last so everything else is still alive while we join them.
     std::vector<std::jthread> m_workers;
 
+    void enqueue(InferenceTask task, InferencePriority priority);
+    static void deliver(InferenceOutput& output, folly::Try<InferenceResult> result);
     void run_worker(std::size_t idx);
+    // Fails the outputs of the batch a worker was collecting when it read its sentinel, along with
+    // all tasks still queued.
+    void shut_down(std::vector<InferenceOutput>& dequeued_outputs);
 };
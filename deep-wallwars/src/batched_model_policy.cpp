@@ -8,17 +8,22 @@ BatchedModelPolicy::BatchedModelPolicy(std::shared_ptr<BatchedModel> model,
 
 folly::coro::Task<Evaluation> BatchedModelPolicy::operator()(
     Board const& board, Turn turn, std::optional<PreviousPosition> previous_position) {
-    auto state = convert_to_model_input(board, turn);
-    auto inference_result = co_await m_model->inference(std::move(state));
+    auto inference_result = co_await m_model->co_inference(board, turn);
+    co_return evaluation_from_inference(board, turn, previous_position, inference_result,
+                                        m_model->move_prior_size(), m_boost_mouse_priors);
+}
 
+Evaluation evaluation_from_inference(Board const& board, Turn turn,
+                                     std::optional<PreviousPosition> const& previous_position,
+                                     InferenceResult const& inference_result, int move_prior_size,
+                                     bool boost_mouse_priors) {
     Evaluation eval;
     eval.value = inference_result.value;
 
     std::size_t board_size = board.columns() * board.rows();
     std::size_t wall_prior_size = 2 * board_size;
     int required_move_priors = board.move_prior_size();
-    int model_move_priors = m_model->move_prior_size();
-    if (model_move_priors < required_move_priors) {
+    if (move_prior_size < required_move_priors) {
         throw std::runtime_error(
             "Model priors do not include required move channels for this variant");
     }
@@ -50,7 +55,7 @@ folly::coro::Task<Evaluation> BatchedModelPolicy::operator()(
                 continue;
             }
             float prior = inference_result.prior[offset + int(dir)];
-            if (m_boost_mouse_priors) {
+            if (boost_mouse_priors) {
                 prior += 0.2f;
             }
             eval.edges.emplace_back(PawnMove{Pawn::Mouse, dir}, prior);
@@ -69,8 +74,25 @@ folly::coro::Task<Evaluation> BatchedModelPolicy::operator()(
 
     // Renormalize to account for illegal actions.
     for (TreeEdge& edge : eval.edges) {
-        edge.prior /= total_prior;
+        edge.prior = edge.prior / total_prior;
+    }
+
+    return eval;
+}
+
+folly::SemiFuture<std::vector<float>> game_values(BatchedModel& model, GameRecorder const& game) {
+    std::vector<ModelPosition> positions;
+    Player player = Player::Red;
+    for (Board const& board : game.board_states()) {
+        positions.push_back(ModelPosition{board, Turn{player, Turn::First}});
+        player = other_player(player);
     }
 
-    co_return eval;
+    return model.value_inference(std::move(positions)).deferValue([](std::vector<float> values) {
+        // Every other position is Blue's turn.
+        for (std::size_t i = 1; i < values.size(); i += 2) {
+            values[i] = -values[i];
+        }
+        return values;
+    });
 }
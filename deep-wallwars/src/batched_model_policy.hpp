@@ -1,8 +1,16 @@
 #pragma once
 
 #include "batched_model.hpp"
+#include "game_recorder.hpp"
 #include "mcts.hpp"
 
+// Turns the raw model output for a position into edges for the legal actions with renormalized
+// priors. Backtracking moves are excluded.
+Evaluation evaluation_from_inference(Board const& board, Turn turn,
+                                     std::optional<PreviousPosition> const& previous_position,
+                                     InferenceResult const& inference_result, int move_prior_size,
+                                     bool boost_mouse_priors);
+
 class BatchedModelPolicy {
 public:
     BatchedModelPolicy(std::shared_ptr<BatchedModel> model, bool boost_mouse_priors = false);
@@ -17,8 +25,20 @@ public:
     uint64_t total_batches() const {
         return m_model->total_batches();
     }
+    BatchedModel const& batched_model() const {
+        return *m_model;
+    }
+    // For requests that bypass the policy, such as value-only inference.
+    std::shared_ptr<BatchedModel> const& shared_batched_model() const {
+        return m_model;
+    }
 
 private:
     std::shared_ptr<BatchedModel> m_model;
     bool m_boost_mouse_priors;
 };
+
+// Values of the positions at the start of every turn of `game` (see GameRecorder::board_states),
+// from Red's perspective, e.g. for a post-game evaluation graph. They are evaluated in one bulk
+// value-only request.
+folly::SemiFuture<std::vector<float>> game_values(BatchedModel& model, GameRecorder const& game);
@@ -1,5 +1,7 @@
+#ifdef TENSORRT_ENABLED
 #include <NvInfer.h>
 #include <NvInferRuntime.h>
+#endif
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/experimental/coro/BlockingWait.h>
 #include <folly/experimental/coro/Collect.h>
@@ -10,6 +12,7 @@
 #include <folly/logging/xlog.h>
 #include <gflags/gflags.h>
 
+#include <format>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -20,22 +23,48 @@
 #include "batched_model_policy.hpp"
 #include "bgs_session.hpp"
 #include "cached_policy.hpp"
+#include "cpu_model.hpp"
+#include "evaluation_store.hpp"
+#include "inference_executor.hpp"
 #include "simple_policy.hpp"
+#ifdef TENSORRT_ENABLED
 #include "tensorrt_model.hpp"
+#endif
 
+#ifdef TENSORRT_ENABLED
 namespace nv = nvinfer1;
+#endif
 
 // ============================================================================
 // Command-line Flags
 // ============================================================================
 
-DEFINE_string(model, "", "Path to TensorRT model file (.trt) or 'simple' for simple policy");
+DEFINE_string(model, "",
+              "Path to TensorRT model file (.trt), model run on the CPU (.onnx or .wwnet) or "
+              "'simple' for simple policy");
 DEFINE_int32(samples, 1000, "Number of MCTS samples per move");
 DEFINE_uint32(seed, 42, "Random seed for MCTS");
-DEFINE_uint64(cache_size, 100'000, "Size of the MCTS evaluation cache");
+DEFINE_uint64(cache_mb, 256, "Memory budget of the MCTS evaluation cache in MiB");
+DEFINE_string(eval_store, "", "Path of the persistent evaluation store (empty to disable)");
+DEFINE_uint64(eval_store_mb, 1024, "Maximum size of the persistent evaluation store in MiB");
+DEFINE_int32(cpu_threads, 1, "Inference threads for CPU models");
+DEFINE_string(inference_cpus, "",
+              "CPUs to pin the inference threads of CPU models to, e.g. 0-7 (one thread per CPU, "
+              "overrides --cpu_threads)");
+DEFINE_string(search_cpus, "", "CPUs to pin the --thread_pool_size threads to, e.g. 8-31");
+DEFINE_int32(cpu_batch_size, 32, "Inference batch size for CPU models");
+DEFINE_string(cpu_int8_data, "",
+              "Quantize CPU models to int8, calibrated with the training data in this folder");
+DEFINE_bool(cpu_winograd, false, "Use Winograd float convolutions for CPU models");
 DEFINE_int32(model_rows, 8, "Model rows (for --model=simple)");
 DEFINE_int32(model_columns, 8, "Model columns (for --model=simple)");
 DEFINE_int32(thread_pool_size, 12, "Number of threads in the executor pool");
+DEFINE_int32(min_batch_fill, 1, "Minimum number of inferences per batch before it is sent");
+DEFINE_int64(max_batch_wait_us, 0,
+             "Maximum time (us) to wait for a batch to reach --min_batch_fill");
+DEFINE_int64(batch_latency_target_us, 0,
+             "If > 0, adaptively wait for full batches as long as inferences are answered within "
+             "this latency (us). Overrides --min_batch_fill and --max_batch_wait_us");
 
 // Simple policy options
 DEFINE_double(move_prior, 0.3, "Move prior of simple agent");
@@ -46,6 +75,7 @@ DEFINE_double(bad_move, 0.75, "Bad move bias of simple agent");
 // TensorRT Logger
 // ============================================================================
 
+#ifdef TENSORRT_ENABLED
 struct Logger : nv::ILogger {
     void log(Severity severity, char const* msg) noexcept {
         switch (severity) {
@@ -64,6 +94,7 @@ struct Logger : nv::ILogger {
         }
     }
 };
+#endif
 
 // ============================================================================
 // Async Stdin Reader
@@ -153,20 +184,53 @@ private:
 // Main
 // ============================================================================
 
+// Opens the persistent evaluation store if requested. Running without one is always an option, so
+// failures are logged rather than fatal.
+static std::shared_ptr<EvaluationStore> open_evaluation_store(bool boost_mouse_priors) {
+    if (FLAGS_eval_store.empty()) {
+        return nullptr;
+    }
+
+    // Stored evaluations are only valid for the settings they were computed with.
+    std::string const settings =
+        std::format("cpu_int8_data={} cpu_winograd={} boost_mouse_priors={}", FLAGS_cpu_int8_data,
+                    FLAGS_cpu_winograd, boost_mouse_priors);
+    try {
+        return std::make_shared<EvaluationStore>(
+            FLAGS_eval_store, model_identity(FLAGS_model, settings), FLAGS_eval_store_mb << 20);
+    } catch (std::exception const& e) {
+        XLOGF(WARN, "Continuing without evaluation store: {}", e.what());
+        return nullptr;
+    }
+}
+
 int main(int argc, char** argv) {
     gflags::SetUsageMessage(
         "Deep Wallwars V3 BGS Engine\n\n"
-        "Usage: deep_ww_bgs_engine --model <path.trt|simple> [options]\n\n"
+        "Usage: deep_ww_bgs_engine --model <path.trt|path.onnx|path.wwnet|simple> [options]\n\n"
         "This program implements the V3 Bot Game Session (BGS) protocol.\n"
         "It reads JSON-lines from stdin and writes responses to stdout.\n"
         "Multiple concurrent sessions are supported (up to 256).\n\n"
         "Required:\n"
-        "  --model PATH      Path to TensorRT model file (.trt) or 'simple'\n\n"
+        "  --model PATH      Path to TensorRT model file (.trt), model run on the CPU\n"
+        "                    (.onnx or .wwnet) or 'simple'\n\n"
         "Options:\n"
         "  --samples N       MCTS samples per move (default: 1000)\n"
         "  --seed N          Base random seed for MCTS (default: 42)\n"
-        "  --cache_size N    Evaluation cache size (default: 100000)\n"
-        "  --thread_pool_size N  Thread pool size (default: 12)\n\n"
+        "  --cache_mb N      Evaluation cache memory budget in MiB (default: 256)\n"
+        "  --eval_store PATH Persistent evaluation store shared across runs (default: off)\n"
+        "  --eval_store_mb N Maximum size of the evaluation store in MiB (default: 1024)\n"
+        "  --cpu_threads N   Inference threads for CPU models (default: 1)\n"
+        "  --inference_cpus LIST  One inference thread pinned to each CPU, e.g. 0-7\n"
+        "  --cpu_batch_size N  Inference batch size for CPU models (default: 32)\n"
+        "  --cpu_int8_data DIR Quantize CPU models to int8, calibrated with training data\n"
+        "                      from DIR (default: off)\n"
+        "  --cpu_winograd    Winograd float convolutions for CPU models (default: off)\n"
+        "  --thread_pool_size N  Thread pool size (default: 12)\n"
+        "  --search_cpus LIST  Pin the thread pool to these CPUs, e.g. 8-31\n"
+        "  --min_batch_fill N    Minimum inferences per GPU batch (default: 1)\n"
+        "  --max_batch_wait_us N Max wait for --min_batch_fill in microseconds (default: 0)\n"
+        "  --batch_latency_target_us N  Adaptive batching latency target (default: off)\n\n"
         "Simple Policy Options (when --model=simple):\n"
         "  --move_prior N    Likelihood of choosing a pawn move (default: 0.3)\n"
         "  --good_move N     Bias for moves closer to goal (default: 1.5)\n"
@@ -186,60 +250,88 @@ int main(int argc, char** argv) {
             XLOG(INFO, "Using simple policy");
             eval_fn = SimplePolicy(FLAGS_move_prior, FLAGS_good_move, FLAGS_bad_move);
         } else {
-            // Create TensorRT runtime
-            Logger logger;
-            std::unique_ptr<nv::IRuntime> runtime{nv::createInferRuntime(logger)};
-
-            if (!runtime) {
-                XLOG(ERR, "Failed to create TensorRT runtime");
-                std::cerr << "Error: Failed to create TensorRT runtime\n";
-                return 1;
-            }
-
             if (FLAGS_model.empty()) {
                 XLOG(ERR, "Error: --model flag is required");
                 std::cerr << "Error: --model flag is required\n";
                 return 1;
             }
 
-            // Load TensorRT model
-            std::ifstream model_file(FLAGS_model, std::ios::binary);
-            if (!model_file) {
-                XLOGF(ERR, "Failed to open model file: {}", FLAGS_model);
-                std::cerr << "Error: Failed to open model file: " << FLAGS_model << "\n";
-                return 1;
-            }
+            std::vector<std::unique_ptr<Model>> models;
+            if (is_cpu_model(FLAGS_model)) {
+                // CPU models need no TensorRT runtime.
+                auto cpu_model = load_cpu_resnet(
+                    FLAGS_model, FLAGS_cpu_batch_size,
+                    make_inference_executor(FLAGS_cpu_threads, FLAGS_inference_cpus),
+                    FLAGS_cpu_int8_data,
+                    FLAGS_cpu_winograd ? ConvAlgorithm::Winograd : ConvAlgorithm::Direct);
+                model_rows = cpu_model->rows();
+                model_columns = cpu_model->columns();
+                models.push_back(std::move(cpu_model));
+            } else {
+#ifdef TENSORRT_ENABLED
+                // Create TensorRT runtime
+                Logger logger;
+                std::unique_ptr<nv::IRuntime> runtime{nv::createInferRuntime(logger)};
+
+                if (!runtime) {
+                    XLOG(ERR, "Failed to create TensorRT runtime");
+                    std::cerr << "Error: Failed to create TensorRT runtime\n";
+                    return 1;
+                }
 
-            XLOGF(INFO, "Loading TensorRT engine from: {}", FLAGS_model);
+                // Load TensorRT model
+                std::ifstream model_file(FLAGS_model, std::ios::binary);
+                if (!model_file) {
+                    XLOGF(ERR, "Failed to open model file: {}", FLAGS_model);
+                    std::cerr << "Error: Failed to open model file: " << FLAGS_model << "\n";
+                    return 1;
+                }
 
-            std::shared_ptr<nv::ICudaEngine> engine;
-            try {
-                engine = load_serialized_engine(*runtime, model_file);
-            } catch (std::exception const& e) {
-                XLOGF(ERR, "Failed to load TensorRT engine: {}", e.what());
-                std::cerr << "Error: Failed to load TensorRT engine: " << e.what() << "\n";
-                return 1;
-            }
+                XLOGF(INFO, "Loading TensorRT engine from: {}", FLAGS_model);
+
+                std::shared_ptr<nv::ICudaEngine> engine;
+                try {
+                    engine = load_serialized_engine(*runtime, model_file);
+                } catch (std::exception const& e) {
+                    XLOGF(ERR, "Failed to load TensorRT engine: {}", e.what());
+                    std::cerr << "Error: Failed to load TensorRT engine: " << e.what() << "\n";
+                    return 1;
+                }
 
-            if (!engine) {
-                XLOG(ERR, "Failed to load TensorRT engine");
-                std::cerr << "Error: Failed to load TensorRT engine\n";
+                if (!engine) {
+                    XLOG(ERR, "Failed to load TensorRT engine");
+                    std::cerr << "Error: Failed to load TensorRT engine\n";
+                    return 1;
+                }
+
+                auto tensor_model = std::make_unique<TensorRTModel>(engine);
+                model_rows = tensor_model->rows();
+                model_columns = tensor_model->columns();
+                models.push_back(std::move(tensor_model));
+#else
+                XLOGF(ERR, "Cannot load {}: built without TensorRT", FLAGS_model);
+                std::cerr << "Error: This build has no TensorRT support. Pass an .onnx or .wwnet "
+                          << "model to run it on the CPU.\n";
                 return 1;
+#endif
             }
 
-            // Create batched model
-            std::vector<std::unique_ptr<Model>> models;
-            auto tensor_model = std::make_unique<TensorRTModel>(engine);
-            model_rows = tensor_model->rows();
-            model_columns = tensor_model->columns();
-            models.push_back(std::move(tensor_model));
+            BatchingOptions batching{
+                .min_batch_fill = FLAGS_min_batch_fill,
+                .max_wait = std::chrono::microseconds{FLAGS_max_batch_wait_us}};
+            if (FLAGS_batch_latency_target_us > 0) {
+                batching.latency_target =
+                    std::chrono::microseconds{FLAGS_batch_latency_target_us};
+            }
 
             constexpr int kBatchedModelQueueSize = 4096;
             auto batched_model = std::make_shared<BatchedModel>(
-                std::move(models), kBatchedModelQueueSize);
+                std::move(models), kBatchedModelQueueSize, batching);
 
-            BatchedModelPolicy batched_model_policy(std::move(batched_model));
-            eval_fn = CachedPolicy(std::move(batched_model_policy), FLAGS_cache_size);
+            constexpr bool kBoostMousePriors = false;
+            BatchedModelPolicy batched_model_policy(std::move(batched_model), kBoostMousePriors);
+            eval_fn = CachedPolicy(std::move(batched_model_policy), FLAGS_cache_mb << 20,
+                                   open_evaluation_store(kBoostMousePriors));
         }
 
         XLOGF(INFO, "Model dimensions: {}x{}", model_rows, model_columns);
@@ -256,7 +348,8 @@ int main(int argc, char** argv) {
 
         // Create thread pool for MCTS sampling
         auto thread_pool = std::make_shared<folly::CPUThreadPoolExecutor>(
-            FLAGS_thread_pool_size);
+            FLAGS_thread_pool_size,
+            pinned_thread_factory("Search", parse_cpu_list(FLAGS_search_cpus)));
 
         // Create response writer
         ResponseWriter response_writer;
@@ -313,8 +406,8 @@ int main(int argc, char** argv) {
         stdin_pipe->setReadCB(&stdin_reader);
 
         XLOG(INFO, "Deep Wallwars V3 BGS Engine started");
-        XLOGF(INFO, "Configuration: samples={}, threads={}, cache={}",
-              FLAGS_samples, FLAGS_thread_pool_size, FLAGS_cache_size);
+        XLOGF(INFO, "Configuration: samples={}, threads={}, cache={}MiB",
+              FLAGS_samples, FLAGS_thread_pool_size, FLAGS_cache_mb);
 
         // Run event loop
         evb.loopForever();
@@ -56,6 +56,7 @@ std::pair<bool, std::string> SessionManager::create_session(
     mcts_opts.starting_turn = turn;
     mcts_opts.seed = generate_seed(bgs_id);
     mcts_opts.max_parallelism = m_config.max_parallel_samples;
+    mcts_opts.priority = m_config.priority;
 
     auto session = std::make_unique<BgsSession>();
     session->bgs_id = bgs_id;
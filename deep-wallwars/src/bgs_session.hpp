@@ -26,6 +26,7 @@ struct BgsEngineConfig {
     std::uint32_t base_seed = 42;     // Base seed for reproducibility
     int model_rows = 8;
     int model_columns = 8;
+    InferencePriority priority = InferencePriority::Interactive;  // Live games skip the queue
 
     static constexpr int kMaxSessions = 256;
 };
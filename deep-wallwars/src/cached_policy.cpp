@@ -1,68 +1,31 @@
 #include "cached_policy.hpp"
 
-#include <folly/Hash.h>
 #include <folly/Overload.h>
-#include <folly/container/EvictingCacheMap.h>
-#include <folly/container/HeterogeneousAccess.h>
-#include <folly/detail/ThreadLocalDetail.h>
 
 #include <utility>
 
-std::size_t folly::HeterogeneousAccessHash<CacheEntry>::operator()(
-    CacheEntry const& cache_entry) const {
-    return operator()(
-        CacheEntryView{cache_entry.board, cache_entry.turn, cache_entry.previous_position});
-}
+CachedPolicy::CachedPolicy(EvaluationFunction evaluate, std::size_t capacity_bytes,
+                           std::shared_ptr<EvaluationStore> store)
+    : m_cache{std::make_shared<State>(std::move(evaluate), capacity_bytes, std::move(store))} {}
 
-std::size_t folly::HeterogeneousAccessHash<CacheEntry>::operator()(CacheEntryView ce_view) const {
-    auto hash = folly::hash::hash_combine(ce_view.board, ce_view.turn.action, ce_view.turn.player);
-    if (ce_view.previous_position) {
-        hash = folly::hash::hash_combine(hash, ce_view.previous_position->pawn,
-                                         ce_view.previous_position->cell);
-    }
-    return hash;
-}
-
-bool folly::HeterogeneousAccessEqualTo<CacheEntry>::operator()(CacheEntry const& lhs,
-                                                               CacheEntry const& rhs) const {
-    return operator()(CacheEntryView{lhs.board, lhs.turn, lhs.previous_position}, rhs);
+int CachedPolicy::cache_hits() const {
+    return m_cache->cache_hits;
 }
 
-bool folly::HeterogeneousAccessEqualTo<CacheEntry>::operator()(CacheEntryView lhs,
-                                                               CacheEntry const& rhs) const {
-    if (lhs.turn != rhs.turn) {
-        return false;
-    }
-
-    if (lhs.turn.player != rhs.turn.player) {
-        return false;
-    }
-
-    if (lhs.previous_position != rhs.previous_position) {
-        return false;
-    }
-
-    return lhs.board == rhs.board;
+int CachedPolicy::cache_misses() const {
+    return m_cache->cache_misses;
 }
 
-bool folly::HeterogeneousAccessEqualTo<CacheEntry>::operator()(CacheEntry const& lhs,
-                                                               CacheEntryView rhs) const {
-    return operator()(rhs, lhs);
+int CachedPolicy::cache_coalesced() const {
+    return m_cache->cache_coalesced;
 }
 
-CachedPolicy::CachedPolicy(EvaluationFunction evaluate, std::size_t capacity, unsigned shards)
-    : m_cache{std::make_shared<EvaluationCache>(std::move(evaluate))} {
-    for (unsigned i = 0; i < shards; ++i) {
-        m_cache->lrus.emplace_back(std::in_place, capacity / shards);
-    }
+int CachedPolicy::store_hits() const {
+    return m_cache->store_hits;
 }
 
-int CachedPolicy::cache_hits() const {
-    return m_cache->cache_hits;
-}
-
-int CachedPolicy::cache_misses() const {
-    return m_cache->cache_misses;
+std::size_t CachedPolicy::cache_bytes() const {
+    return m_cache->cache.size_bytes();
 }
 
 void flip_evaluation(Board const& board, Evaluation& eval) {
@@ -77,22 +40,78 @@ folly::coro::Task<Evaluation> CachedPolicy::operator()(Board const& board, Turn
                                                        std::optional<PreviousPosition>
                                                            previous_position) {
     CacheEntryView ce_view{board, turn, previous_position};
+    auto const hash = EvaluationCache::hash(ce_view);
 
-    // TODO: its a bit annoying that we always compute the hash twice
-    auto hash = folly::HeterogeneousAccessHash<CacheEntry>{}(ce_view);
-    auto& lru = m_cache->lrus[hash % m_cache->lrus.size()];
+    if (auto cached = m_cache->cache.find(ce_view, hash)) {
+        ++m_cache->cache_hits;
+        co_return std::move(*cached);
+    }
 
+    auto& pending = m_cache->pending[hash % kPendingShards];
+    std::optional<folly::SemiFuture<Evaluation>> in_flight;
     {
-        auto locked_lru = lru.wlock();
-        auto existing_entry = locked_lru->find(CacheEntryView{board, turn, previous_position});
-        if (existing_entry != locked_lru->end()) {
+        auto locked_pending = pending.wlock();
+        // The evaluation may have completed since we checked.
+        if (auto cached = m_cache->cache.find(ce_view, hash)) {
             ++m_cache->cache_hits;
-            co_return existing_entry->second;
+            co_return std::move(*cached);
+        }
+
+        auto existing_entry = locked_pending->find(ce_view);
+        if (existing_entry != locked_pending->end()) {
+            in_flight = existing_entry->second.getSemiFuture();
+        } else {
+            locked_pending->emplace(CacheEntry{board, turn, previous_position},
+                                    folly::SharedPromise<Evaluation>{});
+        }
+    }
+
+    if (in_flight) {
+        ++m_cache->cache_coalesced;
+        co_return co_await std::move(*in_flight);
+    }
+
+    // Hands the result (or failure) to everyone who coalesced onto this evaluation.
+    auto complete = [&](auto&& set_result) {
+        folly::SharedPromise<Evaluation> promise;
+        pending.withWLock([&](PendingMap& locked_pending) {
+            auto it = locked_pending.find(ce_view);
+            promise = std::move(it->second);
+            locked_pending.erase(it);
+        });
+        set_result(promise);
+    };
+
+    if (m_cache->store) {
+        if (auto stored = m_cache->store->find(ce_view, hash)) {
+            m_cache->cache.insert(CacheEntry{board, turn, previous_position}, hash, *stored);
+            ++m_cache->store_hits;
+            Evaluation eval{(*stored)->value(), {}, *stored};
+            complete([&](auto& promise) { promise.setValue(eval); });
+            co_return eval;
         }
     }
 
-    Evaluation eval = co_await m_cache->evaluate(board, turn, previous_position);
-    lru.wlock()->insert(CacheEntry{board, turn, previous_position}, eval);
+    Evaluation eval;
+    try {
+        eval = co_await m_cache->evaluate(board, turn, previous_position);
+    } catch (...) {
+        complete([](auto& promise) {
+            promise.setException(folly::exception_wrapper{std::current_exception()});
+        });
+        throw;
+    }
+
+    // Wrapped caches (e.g. OpeningCachePolicy) may already answer in compact form only.
+    CompactEvaluation::Ref compact =
+        eval.compact ? eval.compact : CompactEvaluation::make(board, eval.value, eval.edges);
+
+    // Insert before completing so that no later miss can start a second evaluation.
+    m_cache->cache.insert(CacheEntry{board, turn, previous_position}, hash, compact);
+    if (m_cache->store) {
+        m_cache->store->append(ce_view, hash, compact);
+    }
     ++m_cache->cache_misses;
+    complete([&](auto& promise) { promise.setValue(Evaluation{eval.value, {}, compact}); });
     co_return eval;
 }
@@ -1,54 +1,35 @@
 #pragma once
 
 #include <folly/Synchronized.h>
-#include <folly/ThreadLocal.h>
-#include <folly/container/EvictingCacheMap.h>
-#include <folly/container/HeterogeneousAccess.h>
+#include <folly/container/F14Map.h>
+#include <folly/futures/SharedPromise.h>
 
+#include <array>
 #include <atomic>
+#include <memory>
 
+#include "evaluation_cache.hpp"
+#include "evaluation_store.hpp"
 #include "mcts.hpp"
 
-struct CacheEntry {
-    Board board;
-    Turn turn;
-    std::optional<PreviousPosition> previous_position;
-};
-
-struct CacheEntryView {
-    Board const& board;
-    Turn const& turn;
-    std::optional<PreviousPosition> const& previous_position;
-};
-
-template <>
-struct folly::HeterogeneousAccessHash<CacheEntry> {
-    using is_transparent = void;
-    using folly_is_avalanching = std::true_type;
-
-    std::uint64_t operator()(CacheEntry const& cache_entry) const;
-    std::uint64_t operator()(CacheEntryView ce_view) const;
-};
-
-template <>
-struct folly::HeterogeneousAccessEqualTo<CacheEntry> {
-    using is_transparent = void;
-
-    bool operator()(CacheEntry const& lhs, CacheEntry const& rhs) const;
-    bool operator()(CacheEntry const& lhs, CacheEntryView rhs) const;
-    bool operator()(CacheEntryView lhs, CacheEntry const& rhs) const;
-};
-
 class CachedPolicy {
 public:
-    CachedPolicy(EvaluationFunction evaluate, std::size_t capacity,
-                 unsigned shards = std::thread::hardware_concurrency());
+    // Misses in memory are looked up in the store (if any) before evaluating, and new evaluations
+    // are appended to it.
+    CachedPolicy(EvaluationFunction evaluate, std::size_t capacity_bytes,
+                 std::shared_ptr<EvaluationStore> store = nullptr);
 
     folly::coro::Task<Evaluation> operator()(Board const& board, Turn turn,
                                              std::optional<PreviousPosition> previous_position);
 
     int cache_hits() const;
     int cache_misses() const;
+    // Misses that did not need their own evaluation because the same position was already being
+    // evaluated.
+    int cache_coalesced() const;
+    // Misses that were served by the evaluation store.
+    int store_hits() const;
+    std::size_t cache_bytes() const;
 
     // Returns a reference to the underlying policy
     EvaluationFunction const& underlying_policy() const {
@@ -56,17 +37,30 @@ public:
     }
 
 private:
-    using LRU = folly::EvictingCacheMap<CacheEntry, Evaluation>;
+    static constexpr std::size_t kPendingShards = 64;
+
+    // Evaluations in flight. Later misses on the same position wait for the first one.
+    using PendingMap =
+        folly::F14FastMap<CacheEntry, folly::SharedPromise<Evaluation>,
+                          folly::HeterogeneousAccessHash<CacheEntry>,
+                          folly::HeterogeneousAccessEqualTo<CacheEntry>>;
+
+    struct State {
+        State(EvaluationFunction evaluate, std::size_t capacity_bytes,
+              std::shared_ptr<EvaluationStore> store)
+            : evaluate{std::move(evaluate)}, cache{capacity_bytes}, store{std::move(store)} {}
 
-    struct EvaluationCache {
         EvaluationFunction evaluate;
-        // LRUs are sharded instead of thread-local because computing an evaluation is a co-routine
-        // that might hop threads.
-        std::vector<folly::Synchronized<LRU>> lrus;
+        EvaluationCache cache;
+        std::shared_ptr<EvaluationStore> store;
+        std::array<folly::Synchronized<PendingMap>, kPendingShards> pending;
 
         std::atomic<int> cache_hits = 0;
         std::atomic<int> cache_misses = 0;
+        std::atomic<int> cache_coalesced = 0;
+        std::atomic<int> store_hits = 0;
     };
 
-    std::shared_ptr<EvaluationCache> m_cache;
+    // Shared so that copies of the policy (it is stored in an std::function) share the cache.
+    std::shared_ptr<State> m_cache;
 };
@@ -0,0 +1,196 @@
+#include "compact_evaluation.hpp"
+
+#include <folly/Overload.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+#include "mcts.hpp"
+
+CompactEvaluation::Ref::Ref(Ref const& other) noexcept : m_ptr{other.m_ptr} {
+    if (m_ptr) {
+        m_ptr->m_refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+CompactEvaluation::Ref::Ref(Ref&& other) noexcept : m_ptr{std::exchange(other.m_ptr, nullptr)} {}
+
+CompactEvaluation::Ref& CompactEvaluation::Ref::operator=(Ref other) noexcept {
+    std::swap(m_ptr, other.m_ptr);
+    return *this;
+}
+
+CompactEvaluation::Ref::~Ref() {
+    if (m_ptr && m_ptr->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        m_ptr->~CompactEvaluation();
+        ::operator delete(m_ptr);
+    }
+}
+
+CompactEvaluation* CompactEvaluation::allocate(float value, std::size_t size) {
+    void* memory = ::operator new(sizeof(CompactEvaluation) + 2 * sizeof(std::uint16_t) * size);
+    return new (memory) CompactEvaluation{value, std::uint32_t(size)};
+}
+
+CompactEvaluation::Ref CompactEvaluation::make(Board const& board, float value,
+                                               std::span<TreeEdge const> edges) {
+    auto* eval = allocate(value, edges.size());
+    Ref ref{eval};
+
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+        eval->action_ids()[i] = encode_action(board, edges[i].action);
+        eval->priors()[i] = float_to_half(edges[i].prior);
+    }
+
+    return ref;
+}
+
+CompactEvaluation::Ref CompactEvaluation::make(float value,
+                                               std::span<std::uint16_t const> encoded_actions,
+                                               std::span<std::uint16_t const> encoded_priors) {
+    if (encoded_actions.size() != encoded_priors.size()) {
+        throw std::runtime_error("Number of actions and priors do not match!");
+    }
+
+    auto* eval = allocate(value, encoded_actions.size());
+    std::ranges::copy(encoded_actions, eval->action_ids());
+    std::ranges::copy(encoded_priors, eval->priors());
+    return Ref{eval};
+}
+
+float CompactEvaluation::value() const {
+    return m_value;
+}
+
+std::size_t CompactEvaluation::size() const {
+    return m_size;
+}
+
+std::size_t CompactEvaluation::bytes() const {
+    return sizeof(CompactEvaluation) + 2 * sizeof(std::uint16_t) * m_size;
+}
+
+Action CompactEvaluation::action(Board const& board, std::size_t i) const {
+    return decode_action(board, action_ids()[i]);
+}
+
+float CompactEvaluation::prior(std::size_t i) const {
+    return half_to_float(priors()[i]);
+}
+
+std::vector<TreeEdge> CompactEvaluation::edges(Board const& board) const {
+    std::vector<TreeEdge> result;
+    result.reserve(m_size);
+    for (std::size_t i = 0; i < m_size; ++i) {
+        result.emplace_back(action(board, i), prior(i));
+    }
+    return result;
+}
+
+std::span<std::uint16_t const> CompactEvaluation::encoded_actions() const {
+    return {action_ids(), m_size};
+}
+
+std::span<std::uint16_t const> CompactEvaluation::encoded_priors() const {
+    return {priors(), m_size};
+}
+
+std::uint16_t* CompactEvaluation::action_ids() {
+    return reinterpret_cast<std::uint16_t*>(this + 1);
+}
+
+std::uint16_t* CompactEvaluation::priors() {
+    return action_ids() + m_size;
+}
+
+std::uint16_t const* CompactEvaluation::action_ids() const {
+    return reinterpret_cast<std::uint16_t const*>(this + 1);
+}
+
+std::uint16_t const* CompactEvaluation::priors() const {
+    return action_ids() + m_size;
+}
+
+std::uint16_t encode_action(Board const& board, Action const& action) {
+    int const board_size = board.columns() * board.rows();
+    if (2 * board_size + 8 > std::numeric_limits<std::uint16_t>::max()) {
+        throw std::runtime_error("Board too large for 16-bit action ids!");
+    }
+
+    return folly::variant_match(
+        action,
+        [&](Wall wall) {
+            return std::uint16_t(int(wall.type) * board_size + board.index_from_cell(wall.cell));
+        },
+        [&](PawnMove move) {
+            return std::uint16_t(2 * board_size + 4 * int(move.pawn) + int(move.dir));
+        });
+}
+
+Action decode_action(Board const& board, std::uint16_t id) {
+    int const board_size = board.columns() * board.rows();
+    if (id < 2 * board_size) {
+        return Wall{board.cell_at_index(id % board_size), Wall::Type(id / board_size)};
+    }
+
+    int const move = id - 2 * board_size;
+    return PawnMove{Pawn(move / 4), Direction(move % 4)};
+}
+
+std::uint16_t float_to_half(float f) {
+    auto const bits = std::bit_cast<std::uint32_t>(f);
+    auto const sign = std::uint16_t((bits >> 16) & 0x8000);
+    int const float_exponent = (bits >> 23) & 0xff;
+    std::uint32_t mantissa = bits & 0x7fffff;
+
+    if (float_exponent == 0xff) {
+        // Infinity or NaN (keep it a NaN).
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+
+    int const exponent = float_exponent - 127 + 15;
+    if (exponent >= 0x1f) {
+        return sign | 0x7c00;
+    }
+
+    // Rounds the result of dropping the lowest `shift` bits to nearest even.
+    auto round = [](std::uint32_t value, int shift) {
+        std::uint32_t const result = value >> shift;
+        std::uint32_t const remainder = value & ((1u << shift) - 1);
+        std::uint32_t const halfway = 1u << (shift - 1);
+        return result + (remainder > halfway || (remainder == halfway && (result & 1)));
+    };
+
+    if (exponent <= 0) {
+        // Subnormal (or zero) as a half.
+        if (exponent < -10) {
+            return sign;
+        }
+        return sign | std::uint16_t(round(mantissa | 0x800000, 14 - exponent));
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent (up to infinity).
+    return sign | std::uint16_t(round((std::uint32_t(exponent) << 23) | mantissa, 13));
+}
+
+float half_to_float(std::uint16_t h) {
+    std::uint32_t const sign = std::uint32_t(h & 0x8000) << 16;
+    int const exponent = (h >> 10) & 0x1f;
+    std::uint32_t const mantissa = h & 0x3ff;
+
+    if (exponent == 0) {
+        float const magnitude = std::ldexp(float(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    if (exponent == 0x1f) {
+        return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+    }
+
+    return std::bit_cast<float>(sign | (std::uint32_t(exponent - 15 + 127) << 23) |
+                                (mantissa << 13));
+}
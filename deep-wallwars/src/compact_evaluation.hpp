@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "gamestate.hpp"
+
+struct TreeEdge;
+
+// Immutable, reference counted evaluation in a single allocation: the value followed by one 16-bit
+// action id and one fp16 prior per edge. About 4 bytes per edge instead of a full TreeEdge, and
+// handing it out is just a reference count increment, which makes it the format of choice for
+// caching.
+//
+// Action ids use the same layout as the model priors (walls, then cat moves, then mouse moves), so
+// they are only meaningful together with the board dimensions.
+class CompactEvaluation {
+public:
+    // Intrusive shared pointer to a CompactEvaluation.
+    class Ref {
+    public:
+        Ref() = default;
+        Ref(Ref const& other) noexcept;
+        Ref(Ref&& other) noexcept;
+        Ref& operator=(Ref other) noexcept;
+        ~Ref();
+
+        CompactEvaluation const* operator->() const {
+            return m_ptr;
+        }
+
+        CompactEvaluation const& operator*() const {
+            return *m_ptr;
+        }
+
+        explicit operator bool() const {
+            return m_ptr;
+        }
+
+    private:
+        friend class CompactEvaluation;
+
+        explicit Ref(CompactEvaluation* ptr) : m_ptr{ptr} {}
+
+        CompactEvaluation* m_ptr = nullptr;
+    };
+
+    static Ref make(Board const& board, float value, std::span<TreeEdge const> edges);
+    // From previously encoded action ids and priors (see below), e.g. when loading from disk.
+    static Ref make(float value, std::span<std::uint16_t const> encoded_actions,
+                    std::span<std::uint16_t const> encoded_priors);
+
+    CompactEvaluation(CompactEvaluation const& other) = delete;
+    CompactEvaluation& operator=(CompactEvaluation const& other) = delete;
+
+    float value() const;
+    std::size_t size() const;
+    // Size of the whole block including the header.
+    std::size_t bytes() const;
+
+    Action action(Board const& board, std::size_t i) const;
+    float prior(std::size_t i) const;
+
+    std::vector<TreeEdge> edges(Board const& board) const;
+
+    std::span<std::uint16_t const> encoded_actions() const;
+    std::span<std::uint16_t const> encoded_priors() const;
+
+private:
+    mutable std::atomic<std::uint32_t> m_refs = 1;
+    std::uint32_t m_size;
+    float m_value;
+
+    CompactEvaluation(float value, std::uint32_t size) : m_size{size}, m_value{value} {}
+
+    static CompactEvaluation* allocate(float value, std::size_t size);
+
+    std::uint16_t* action_ids();
+    std::uint16_t* priors();
+    std::uint16_t const* action_ids() const;
+    std::uint16_t const* priors() const;
+};
+
+std::uint16_t encode_action(Board const& board, Action const& action);
+Action decode_action(Board const& board, std::uint16_t id);
+
+// IEEE 754 half precision conversions (round to nearest even).
+std::uint16_t float_to_half(float f);
+float half_to_float(std::uint16_t h);
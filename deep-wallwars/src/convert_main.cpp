@@ -0,0 +1,61 @@
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include "cpu_model.hpp"
+#include "onnx_graph.hpp"
+#include "wwnet.hpp"
+
+DEFINE_string(output, "", "Path of the .wwnet file (default: the input path with .wwnet)");
+
+constexpr char kUsage[] =
+    "Converts ONNX models to the .wwnet format, which the CPU backend maps and uses in place\n"
+    "instead of parsing and packing the ONNX weights at every start.\n\n"
+    "Usage: deep_ww_convert [--output PATH] model.onnx...\n\n"
+    "PyTorch checkpoints (.pt) must be exported to ONNX first, which scripts/training.py does\n"
+    "for every generation.";
+
+int main(int argc, char** argv) {
+    gflags::SetUsageMessage(kUsage);
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+    // --output only makes sense for a single model.
+    if (argc < 2 || (argc > 2 && !FLAGS_output.empty())) {
+        std::cerr << kUsage << std::endl;
+        return 1;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::filesystem::path const input{argv[i]};
+        if (input.extension() != ".onnx") {
+            XLOGF(ERR, "Expected an .onnx model, got {}", input.string());
+            return 1;
+        }
+
+        std::filesystem::path output = FLAGS_output;
+        if (output.empty()) {
+            output = input;
+            output.replace_extension(".wwnet");
+        }
+
+        try {
+            write_wwnet(pack_resnet(resnet_from_onnx(read_onnx_graph(input))), output);
+
+            // Loading the result checks it, and shows what the conversion saves.
+            auto const start = std::chrono::steady_clock::now();
+            CpuResNetModel model{map_wwnet(output), 1};
+            XLOGF(INFO, "Wrote {}, which loads in {:.2f} ms", output.string(),
+                  std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                            start)
+                      .count());
+        } catch (std::exception const& e) {
+            XLOGF(ERR, "Failed to convert {}: {}", input.string(), e.what());
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,742 @@
+#include "cpu_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Number of output pixels of a row computed at once. Together with kConvBlock this determines the
+// number of accumulators, which should all fit into vector registers.
+constexpr int kConvPixels = 4;
+// Partial sums of dot products, so that they vectorize without reassociating floating point math.
+constexpr int kDotLanes = 16;
+
+PackedConv pack_conv3x3(std::span<float const> weights, std::span<float const> bias,
+                        int out_channels, int in_channels) {
+    if (out_channels % kConvBlock != 0) {
+        throw std::runtime_error("Convolution channels must be a multiple of the block size!");
+    }
+    if (int(weights.size()) != out_channels * in_channels * 9 ||
+        (!bias.empty() && int(bias.size()) != out_channels)) {
+        throw std::runtime_error("Convolution weights do not match their shape!");
+    }
+
+    // The bias goes right after the weights.
+    auto storage = std::make_shared<std::vector<float>>(weights.size() + out_channels, 0.0f);
+    std::ranges::copy(bias, storage->begin() + weights.size());
+
+    for (int o = 0; o < out_channels; ++o) {
+        for (int i = 0; i < in_channels; ++i) {
+            for (int tap = 0; tap < 9; ++tap) {
+                std::size_t const block = std::size_t(o / kConvBlock) * 9 + tap;
+                std::size_t const packed = (block * in_channels + i) * kConvBlock + o % kConvBlock;
+                (*storage)[packed] = weights[(std::size_t(o) * in_channels + i) * 9 + tap];
+            }
+        }
+    }
+
+    std::span<float const> const packed{*storage};
+    return {in_channels, out_channels, packed.first(weights.size()),
+            packed.subspan(weights.size()), std::move(storage)};
+}
+
+// Number of floats in the widest vector registers of the target. The kernels use GCC/Clang vector
+// types of this width rather than intrinsics, so they compile for any target.
+#if defined(__AVX512F__)
+constexpr int kVectorWidth = 16;
+#elif defined(__AVX__)
+constexpr int kVectorWidth = 8;
+#else
+constexpr int kVectorWidth = 4;
+#endif
+
+constexpr int kBlockVectors = kConvBlock / kVectorWidth;
+
+using FloatVector = float __attribute__((vector_size(kVectorWidth * sizeof(float))));
+
+[[gnu::always_inline]] static inline FloatVector load_vector(float const* values) {
+    FloatVector vector;
+    std::memcpy(&vector, values, sizeof(vector));
+    return vector;
+}
+
+// Stores one vector of outputs (including the bias) after applying the epilogue. `residual` points
+// to the matching residual values, or is nullptr.
+[[gnu::always_inline]] static inline void store_output(float* out, FloatVector value,
+                                                       float const* residual, bool relu) {
+    if (residual) {
+        value += load_vector(residual);
+    }
+    if (relu) {
+        FloatVector const zero{};
+        value = value > zero ? value : zero;
+    }
+    std::memcpy(out, &value, sizeof(value));
+}
+
+// The residual values matching `out`, an output position within `images`.
+static float const* residual_at(ConvEpilogue const& epilogue, float const* images,
+                                float const* out) {
+    return epilogue.residual ? epilogue.residual + (out - images) : nullptr;
+}
+
+// Computes kConvBlock output channels of `pixels` neighboring pixels. `in` points to the top left
+// input pixel of the first receptive field and `out` to the first output.
+template <int pixels>
+static void conv_tile(float const* in, std::size_t in_row, int in_channels, float const* weights,
+                      float const* bias, float* out, int out_channels, float const* residual,
+                      bool relu) {
+    FloatVector acc[pixels][kBlockVectors];
+    for (int p = 0; p < pixels; ++p) {
+        for (int v = 0; v < kBlockVectors; ++v) {
+            acc[p][v] = load_vector(bias + v * kVectorWidth);
+        }
+    }
+
+    for (int tap = 0; tap < 9; ++tap) {
+        float const* tap_in = in + (tap / 3) * in_row + (tap % 3) * in_channels;
+        float const* tap_weights = weights + std::size_t(tap) * in_channels * kConvBlock;
+
+        for (int c = 0; c < in_channels; ++c) {
+            FloatVector w[kBlockVectors];
+            for (int v = 0; v < kBlockVectors; ++v) {
+                w[v] = load_vector(tap_weights + c * kConvBlock + v * kVectorWidth);
+            }
+            for (int p = 0; p < pixels; ++p) {
+                float const x = tap_in[p * in_channels + c];
+                for (int v = 0; v < kBlockVectors; ++v) {
+                    acc[p][v] += x * w[v];
+                }
+            }
+        }
+    }
+
+    for (int p = 0; p < pixels; ++p) {
+        for (int v = 0; v < kBlockVectors; ++v) {
+            std::size_t const offset = p * out_channels + v * kVectorWidth;
+            store_output(out + offset, acc[p][v], residual ? residual + offset : nullptr, relu);
+        }
+    }
+}
+
+void conv3x3(PackedConv const& conv, int height, int width, float const* in, float* out,
+             int count, ConvEpilogue epilogue) {
+    ImageShape const in_shape{height, width, conv.in_channels};
+    ImageShape const out_shape{height, width, conv.out_channels};
+    std::size_t const in_row = std::size_t(width + 2) * conv.in_channels;
+    std::size_t const out_row = std::size_t(width + 2) * conv.out_channels;
+    std::size_t const block_size = std::size_t(9) * conv.in_channels * kConvBlock;
+
+    // Each weight block is applied to all images before moving on to the next one.
+    for (int block = 0; block < conv.out_channels / kConvBlock; ++block) {
+        float const* weights = conv.weights.data() + block * block_size;
+        float const* bias = conv.bias.data() + block * kConvBlock;
+
+        for (int image = 0; image < count; ++image) {
+            float const* image_in = in + image * in_shape.size();
+            // Skip the border of the output.
+            float* image_out =
+                out + image * out_shape.size() + out_row + conv.out_channels + block * kConvBlock;
+
+            for (int y = 0; y < height; ++y) {
+                float const* row_in = image_in + y * in_row;
+                float* row_out = image_out + y * out_row;
+
+                float const* row_residual = residual_at(epilogue, out, row_out);
+                auto tile_residual = [&](int x) {
+                    return row_residual ? row_residual + x * conv.out_channels : nullptr;
+                };
+
+                int x = 0;
+                for (; x + kConvPixels <= width; x += kConvPixels) {
+                    conv_tile<kConvPixels>(row_in + x * conv.in_channels, in_row, conv.in_channels,
+                                           weights, bias, row_out + x * conv.out_channels,
+                                           conv.out_channels, tile_residual(x), epilogue.relu);
+                }
+                for (; x < width; ++x) {
+                    conv_tile<1>(row_in + x * conv.in_channels, in_row, conv.in_channels, weights,
+                                 bias, row_out + x * conv.out_channels, conv.out_channels,
+                                 tile_residual(x), epilogue.relu);
+                }
+            }
+        }
+    }
+}
+
+// Winograd F(2x2, 3x3) with the transforms of Lavin & Gray, "Fast Algorithms for Convolutional
+// Neural Networks":
+//     B^T = [1 0 -1 0; 0 1 1 0; 0 -1 1 0; 0 1 0 -1]
+//     G = [1 0 0; 1/2 1/2 1/2; 1/2 -1/2 1/2; 0 0 1]
+//     A^T = [1 1 1 0; 0 1 -1 -1]
+WinogradConv winograd_conv3x3(PackedConv const& conv) {
+    std::size_t const size = std::size_t(16) * conv.in_channels * conv.out_channels;
+    WinogradConv winograd{conv.in_channels, conv.out_channels, std::vector<float>(size),
+                          {conv.bias.begin(), conv.bias.end()}};
+    int const blocks = conv.out_channels / kConvBlock;
+
+    for (int block = 0; block < blocks; ++block) {
+        for (int i = 0; i < conv.in_channels; ++i) {
+            for (int o = 0; o < kConvBlock; ++o) {
+                float g[3][3];
+                for (int tap = 0; tap < 9; ++tap) {
+                    std::size_t const packed =
+                        ((std::size_t(block) * 9 + tap) * conv.in_channels + i) * kConvBlock + o;
+                    g[tap / 3][tap % 3] = conv.weights[packed];
+                }
+
+                // G g, then (G g) G^T.
+                float gg[4][3];
+                for (int x = 0; x < 3; ++x) {
+                    gg[0][x] = g[0][x];
+                    gg[1][x] = 0.5f * (g[0][x] + g[1][x] + g[2][x]);
+                    gg[2][x] = 0.5f * (g[0][x] - g[1][x] + g[2][x]);
+                    gg[3][x] = g[2][x];
+                }
+                float u[4][4];
+                for (int y = 0; y < 4; ++y) {
+                    u[y][0] = gg[y][0];
+                    u[y][1] = 0.5f * (gg[y][0] + gg[y][1] + gg[y][2]);
+                    u[y][2] = 0.5f * (gg[y][0] - gg[y][1] + gg[y][2]);
+                    u[y][3] = gg[y][2];
+                }
+
+                for (int xi = 0; xi < 16; ++xi) {
+                    std::size_t const packed =
+                        ((std::size_t(xi) * blocks + block) * conv.in_channels + i) * kConvBlock +
+                        o;
+                    winograd.weights[packed] = u[xi / 4][xi % 4];
+                }
+            }
+        }
+    }
+
+    return winograd;
+}
+
+static int winograd_tiles(int height, int width) {
+    return ((height + 1) / 2) * ((width + 1) / 2);
+}
+
+std::size_t winograd_scratch_size(WinogradConv const& conv, int height, int width, int count) {
+    std::size_t const tiles = std::size_t(winograd_tiles(height, width)) * count;
+    return 16 * tiles * (conv.in_channels + conv.out_channels);
+}
+
+// Loads and stores either a single float or a FloatVector.
+template <typename T>
+[[gnu::always_inline]] static inline T load(float const* values) {
+    T value;
+    std::memcpy(&value, values, sizeof(value));
+    return value;
+}
+
+template <typename T>
+[[gnu::always_inline]] static inline void store(float* values, T value) {
+    std::memcpy(values, &value, sizeof(value));
+}
+
+// Computes B^T d B for the channels starting at `c` of the 4x4 input tile `d`. Element xi of the
+// result goes to out[xi * stride].
+template <typename T>
+[[gnu::always_inline]] static inline void winograd_input_tile(float const* const (&d)[4][4], int c,
+                                                              float* out, std::size_t stride) {
+    T t[4][4];
+    for (int x = 0; x < 4; ++x) {
+        T const d0 = load<T>(d[0][x] + c);
+        T const d1 = load<T>(d[1][x] + c);
+        T const d2 = load<T>(d[2][x] + c);
+        T const d3 = load<T>(d[3][x] + c);
+        t[0][x] = d0 - d2;
+        t[1][x] = d1 + d2;
+        t[2][x] = d2 - d1;
+        t[3][x] = d1 - d3;
+    }
+    for (int y = 0; y < 4; ++y) {
+        store(out + (y * 4 + 0) * stride, t[y][0] - t[y][2]);
+        store(out + (y * 4 + 1) * stride, t[y][1] + t[y][2]);
+        store(out + (y * 4 + 2) * stride, t[y][2] - t[y][1]);
+        store(out + (y * 4 + 3) * stride, t[y][1] - t[y][3]);
+    }
+}
+
+// Multiplies `rows` transformed input tiles with one block of transformed weights, for one of the
+// 16 tile elements. Same structure as conv_tile with a single tap.
+template <int rows>
+static void winograd_gemm_tile(float const* in, int in_channels, float const* weights, float* out,
+                               int out_channels) {
+    FloatVector acc[rows][kBlockVectors] = {};
+    for (int c = 0; c < in_channels; ++c) {
+        FloatVector w[kBlockVectors];
+        for (int v = 0; v < kBlockVectors; ++v) {
+            w[v] = load_vector(weights + c * kConvBlock + v * kVectorWidth);
+        }
+        for (int r = 0; r < rows; ++r) {
+            float const x = in[r * in_channels + c];
+            for (int v = 0; v < kBlockVectors; ++v) {
+                acc[r][v] += x * w[v];
+            }
+        }
+    }
+
+    for (int r = 0; r < rows; ++r) {
+        std::memcpy(out + r * out_channels, acc[r], sizeof(acc[r]));
+    }
+}
+
+// Tiles are multiplied in chunks of this many, whose transformed inputs stay in the L1 cache while
+// all weight blocks are applied to them.
+constexpr int kWinogradChunk = 32;
+constexpr int kWinogradRows = 8;
+
+void conv3x3_winograd(WinogradConv const& conv, int height, int width, float const* in,
+                      float* out, int count, float* scratch, ConvEpilogue epilogue) {
+    ImageShape const in_shape{height, width, conv.in_channels};
+    ImageShape const out_shape{height, width, conv.out_channels};
+    int const tiles_y = (height + 1) / 2;
+    int const tiles_x = (width + 1) / 2;
+    std::size_t const tiles = std::size_t(tiles_y) * tiles_x * count;
+    std::size_t const in_stride = tiles * conv.in_channels;
+    std::size_t const out_stride = tiles * conv.out_channels;
+    float* transformed_in = scratch;
+    float* transformed_out = scratch + 16 * in_stride;
+
+    // Tiles of odd sized images reach one pixel past the border, which reads as zero.
+    std::vector<float> const zeros(conv.in_channels, 0.0f);
+
+    std::size_t tile = 0;
+    for (int image = 0; image < count; ++image) {
+        float const* image_in = in + image * in_shape.size();
+        for (int ty = 0; ty < tiles_y; ++ty) {
+            for (int tx = 0; tx < tiles_x; ++tx, ++tile) {
+                float const* d[4][4];
+                for (int y = 0; y < 4; ++y) {
+                    for (int x = 0; x < 4; ++x) {
+                        int const py = 2 * ty + y;
+                        int const px = 2 * tx + x;
+                        d[y][x] = py < height + 2 && px < width + 2
+                                      ? image_in + (std::size_t(py) * (width + 2) + px) *
+                                                       conv.in_channels
+                                      : zeros.data();
+                    }
+                }
+
+                float* tile_out = transformed_in + tile * conv.in_channels;
+                int c = 0;
+                for (; c + kVectorWidth <= conv.in_channels; c += kVectorWidth) {
+                    winograd_input_tile<FloatVector>(d, c, tile_out + c, in_stride);
+                }
+                for (; c < conv.in_channels; ++c) {
+                    winograd_input_tile<float>(d, c, tile_out + c, in_stride);
+                }
+            }
+        }
+    }
+
+    int const blocks = conv.out_channels / kConvBlock;
+    std::size_t const block_size = std::size_t(conv.in_channels) * kConvBlock;
+    for (int xi = 0; xi < 16; ++xi) {
+        float const* xi_in = transformed_in + xi * in_stride;
+        float* xi_out = transformed_out + xi * out_stride;
+        float const* xi_weights = conv.weights.data() + xi * blocks * block_size;
+
+        for (std::size_t first = 0; first < tiles; first += kWinogradChunk) {
+            std::size_t const last = std::min(tiles, first + kWinogradChunk);
+            for (int block = 0; block < blocks; ++block) {
+                float const* weights = xi_weights + block * block_size;
+                std::size_t row = first;
+                for (; row + kWinogradRows <= last; row += kWinogradRows) {
+                    winograd_gemm_tile<kWinogradRows>(
+                        xi_in + row * conv.in_channels, conv.in_channels, weights,
+                        xi_out + row * conv.out_channels + block * kConvBlock, conv.out_channels);
+                }
+                for (; row < last; ++row) {
+                    winograd_gemm_tile<1>(xi_in + row * conv.in_channels, conv.in_channels,
+                                          weights,
+                                          xi_out + row * conv.out_channels + block * kConvBlock,
+                                          conv.out_channels);
+                }
+            }
+        }
+    }
+
+    // A^T m A plus the bias and the epilogue, keeping only the outputs inside the image.
+    std::size_t const out_row = std::size_t(width + 2) * conv.out_channels;
+    tile = 0;
+    for (int image = 0; image < count; ++image) {
+        float* image_out = out + image * out_shape.size() + out_row + conv.out_channels;
+        for (int ty = 0; ty < tiles_y; ++ty) {
+            for (int tx = 0; tx < tiles_x; ++tx, ++tile) {
+                float const* m = transformed_out + tile * conv.out_channels;
+                float* tile_out = image_out + 2 * ty * out_row + 2 * tx * conv.out_channels;
+                float const* tile_residual = residual_at(epilogue, out, tile_out);
+                bool const full_row = 2 * tx + 1 < width;
+                bool const full_column = 2 * ty + 1 < height;
+
+                for (int c = 0; c < conv.out_channels; c += kVectorWidth) {
+                    FloatVector s[2][4];
+                    for (int x = 0; x < 4; ++x) {
+                        FloatVector const m0 = load_vector(m + (0 + x) * out_stride + c);
+                        FloatVector const m1 = load_vector(m + (4 + x) * out_stride + c);
+                        FloatVector const m2 = load_vector(m + (8 + x) * out_stride + c);
+                        FloatVector const m3 = load_vector(m + (12 + x) * out_stride + c);
+                        s[0][x] = m0 + m1 + m2;
+                        s[1][x] = m1 - m2 - m3;
+                    }
+
+                    FloatVector const bias = load_vector(conv.bias.data() + c);
+                    for (int y = 0; y < (full_column ? 2 : 1); ++y) {
+                        std::size_t const offset = y * out_row + c;
+                        float const* residual = tile_residual ? tile_residual + offset : nullptr;
+                        store_output(tile_out + offset, s[y][0] + s[y][1] + s[y][2] + bias,
+                                     residual, epilogue.relu);
+                        if (full_row) {
+                            store_output(tile_out + offset + conv.out_channels,
+                                         s[y][1] - s[y][2] - s[y][3] + bias,
+                                         residual ? residual + conv.out_channels : nullptr,
+                                         epilogue.relu);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int quantized_channels(int channels) {
+    return (channels + kChannelGroup - 1) / kChannelGroup * kChannelGroup;
+}
+
+QuantizedConv quantize_conv3x3(PackedConv const& conv, float input_scale) {
+    if (!(input_scale > 0.0f)) {
+        throw std::runtime_error("Input scale of quantized convolution must be positive!");
+    }
+
+    int const in_channels = quantized_channels(conv.in_channels);
+    int const groups = in_channels / kChannelGroup;
+    std::size_t const size = std::size_t(conv.out_channels) * in_channels * 9;
+    QuantizedConv quantized{in_channels,
+                            conv.out_channels,
+                            std::vector<std::int8_t>(size),
+                            std::vector<float>(conv.out_channels),
+                            {conv.bias.begin(), conv.bias.end()},
+                            input_scale};
+
+    auto weight = [&](int o, int tap, int i) {
+        std::size_t const block = std::size_t(o / kConvBlock) * 9 + tap;
+        return conv.weights[(block * conv.in_channels + i) * kConvBlock + o % kConvBlock];
+    };
+
+    for (int o = 0; o < conv.out_channels; ++o) {
+        float max = 0.0f;
+        for (int tap = 0; tap < 9; ++tap) {
+            for (int i = 0; i < conv.in_channels; ++i) {
+                max = std::max(max, std::abs(weight(o, tap, i)));
+            }
+        }
+
+        float const weight_scale = max > 0.0f ? max / kMaxQuantizedWeight : 1.0f;
+        quantized.scales[o] = input_scale * weight_scale;
+
+        for (int tap = 0; tap < 9; ++tap) {
+            for (int i = 0; i < conv.in_channels; ++i) {
+                std::size_t const group = (std::size_t(o / kConvBlock) * 9 + tap) * groups +
+                                          i / kChannelGroup;
+                std::size_t const index =
+                    (group * kConvBlock + o % kConvBlock) * kChannelGroup + i % kChannelGroup;
+                quantized.weights[index] =
+                    std::int8_t(std::lrint(weight(o, tap, i) / weight_scale));
+            }
+        }
+    }
+
+    return quantized;
+}
+
+void quantize_images(ImageShape shape, float const* in, std::uint8_t* out, float input_scale,
+                     int count) {
+    int const channels = quantized_channels(shape.channels);
+    std::size_t const pixels = std::size_t(shape.height + 2) * (shape.width + 2) * count;
+    float const inverse_scale = 1.0f / input_scale;
+
+    for (std::size_t pixel = 0; pixel < pixels; ++pixel) {
+        float const* pixel_in = in + pixel * shape.channels;
+        std::uint8_t* pixel_out = out + pixel * channels;
+        for (int c = 0; c < shape.channels; ++c) {
+            float const value = std::nearbyint(pixel_in[c] * inverse_scale);
+            pixel_out[c] = std::uint8_t(std::clamp(value, 0.0f, float(kMaxQuantizedActivation)));
+        }
+        std::fill(pixel_out + shape.channels, pixel_out + channels, std::uint8_t(0));
+    }
+}
+
+static_assert(kConvBlock == 16, "The int8 kernels assume 16 output channels per block");
+
+// Int8 version of conv_tile. Each group of kChannelGroup input channels is broadcast as one 32 bit
+// value and multiplied with the kConvBlock x kChannelGroup weights of the group.
+template <int pixels>
+static void conv_tile_int8(std::uint8_t const* in, std::size_t in_row, int in_channels,
+                           std::int8_t const* weights, float const* scales, float const* bias,
+                           float* out, int out_channels, float const* residual, bool relu) {
+    int const groups = in_channels / kChannelGroup;
+    std::size_t const group_size = kConvBlock * kChannelGroup;
+    std::int32_t sums[pixels][kConvBlock];
+
+    [[maybe_unused]] auto group_input = [&](std::uint8_t const* tap_in, int p, int group) {
+        std::int32_t x;
+        std::memcpy(&x, tap_in + p * in_channels + group * kChannelGroup, sizeof(x));
+        return x;
+    };
+
+#if defined(__AVX512VNNI__)
+    __m512i acc[pixels];
+    for (int p = 0; p < pixels; ++p) {
+        acc[p] = _mm512_setzero_si512();
+    }
+
+    for (int tap = 0; tap < 9; ++tap) {
+        std::uint8_t const* tap_in = in + (tap / 3) * in_row + (tap % 3) * in_channels;
+        std::int8_t const* tap_weights = weights + std::size_t(tap) * groups * group_size;
+
+        for (int group = 0; group < groups; ++group) {
+            __m512i const w = _mm512_loadu_si512(tap_weights + group * group_size);
+            for (int p = 0; p < pixels; ++p) {
+                __m512i const x = _mm512_set1_epi32(group_input(tap_in, p, group));
+                acc[p] = _mm512_dpbusd_epi32(acc[p], x, w);
+            }
+        }
+    }
+
+    for (int p = 0; p < pixels; ++p) {
+        _mm512_storeu_si512(sums[p], acc[p]);
+    }
+#elif defined(__AVX2__)
+    __m256i acc[pixels][2];
+    for (int p = 0; p < pixels; ++p) {
+        acc[p][0] = acc[p][1] = _mm256_setzero_si256();
+    }
+#if !defined(__AVXVNNI__)
+    __m256i const ones = _mm256_set1_epi16(1);
+#endif
+
+    for (int tap = 0; tap < 9; ++tap) {
+        std::uint8_t const* tap_in = in + (tap / 3) * in_row + (tap % 3) * in_channels;
+        std::int8_t const* tap_weights = weights + std::size_t(tap) * groups * group_size;
+
+        for (int group = 0; group < groups; ++group) {
+            auto const* group_weights =
+                reinterpret_cast<__m256i const*>(tap_weights + group * group_size);
+            __m256i const w[2] = {_mm256_loadu_si256(group_weights),
+                                  _mm256_loadu_si256(group_weights + 1)};
+            for (int p = 0; p < pixels; ++p) {
+                __m256i const x = _mm256_set1_epi32(group_input(tap_in, p, group));
+                for (int half = 0; half < 2; ++half) {
+#if defined(__AVXVNNI__)
+                    acc[p][half] = _mm256_dpbusd_avx_epi32(acc[p][half], x, w[half]);
+#else
+                    __m256i const pairs = _mm256_maddubs_epi16(x, w[half]);
+                    acc[p][half] = _mm256_add_epi32(acc[p][half], _mm256_madd_epi16(pairs, ones));
+#endif
+                }
+            }
+        }
+    }
+
+    for (int p = 0; p < pixels; ++p) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums[p]), acc[p][0]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums[p] + 8), acc[p][1]);
+    }
+#else
+    for (int p = 0; p < pixels; ++p) {
+        std::fill_n(sums[p], kConvBlock, 0);
+    }
+
+    for (int tap = 0; tap < 9; ++tap) {
+        std::uint8_t const* tap_in = in + (tap / 3) * in_row + (tap % 3) * in_channels;
+        std::int8_t const* tap_weights = weights + std::size_t(tap) * groups * group_size;
+
+        for (int group = 0; group < groups; ++group) {
+            std::int8_t const* w = tap_weights + group * group_size;
+            for (int p = 0; p < pixels; ++p) {
+                std::uint8_t const* x = tap_in + p * in_channels + group * kChannelGroup;
+                for (int j = 0; j < kConvBlock; ++j) {
+                    for (int k = 0; k < kChannelGroup; ++k) {
+                        sums[p][j] += x[k] * w[j * kChannelGroup + k];
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    for (int p = 0; p < pixels; ++p) {
+        float values[kConvBlock];
+        for (int j = 0; j < kConvBlock; ++j) {
+            values[j] = float(sums[p][j]) * scales[j] + bias[j];
+        }
+        for (int v = 0; v < kBlockVectors; ++v) {
+            std::size_t const offset = p * out_channels + v * kVectorWidth;
+            store_output(out + offset, load_vector(values + v * kVectorWidth),
+                         residual ? residual + offset : nullptr, relu);
+        }
+    }
+}
+
+void conv3x3_int8(QuantizedConv const& conv, int height, int width, std::uint8_t const* in,
+                  float* out, int count, ConvEpilogue epilogue) {
+    ImageShape const in_shape{height, width, conv.in_channels};
+    ImageShape const out_shape{height, width, conv.out_channels};
+    std::size_t const in_row = std::size_t(width + 2) * conv.in_channels;
+    std::size_t const out_row = std::size_t(width + 2) * conv.out_channels;
+    std::size_t const block_size = std::size_t(9) * conv.in_channels * kConvBlock;
+
+    for (int block = 0; block < conv.out_channels / kConvBlock; ++block) {
+        std::int8_t const* weights = conv.weights.data() + block * block_size;
+        float const* scales = conv.scales.data() + block * kConvBlock;
+        float const* bias = conv.bias.data() + block * kConvBlock;
+
+        for (int image = 0; image < count; ++image) {
+            std::uint8_t const* image_in = in + image * in_shape.size();
+            float* image_out =
+                out + image * out_shape.size() + out_row + conv.out_channels + block * kConvBlock;
+
+            for (int y = 0; y < height; ++y) {
+                std::uint8_t const* row_in = image_in + y * in_row;
+                float* row_out = image_out + y * out_row;
+
+                float const* row_residual = residual_at(epilogue, out, row_out);
+                auto tile_residual = [&](int x) {
+                    return row_residual ? row_residual + x * conv.out_channels : nullptr;
+                };
+
+                // The int8 accumulators of a pixel need half as many registers as the float
+                // ones, so wider tiles pay off.
+                int x = 0;
+                for (; x + 2 * kConvPixels <= width; x += 2 * kConvPixels) {
+                    conv_tile_int8<2 * kConvPixels>(
+                        row_in + x * conv.in_channels, in_row, conv.in_channels, weights, scales,
+                        bias, row_out + x * conv.out_channels, conv.out_channels, tile_residual(x),
+                        epilogue.relu);
+                }
+                for (; x + kConvPixels <= width; x += kConvPixels) {
+                    conv_tile_int8<kConvPixels>(row_in + x * conv.in_channels, in_row,
+                                                conv.in_channels, weights, scales, bias,
+                                                row_out + x * conv.out_channels, conv.out_channels,
+                                                tile_residual(x), epilogue.relu);
+                }
+                for (; x < width; ++x) {
+                    conv_tile_int8<1>(row_in + x * conv.in_channels, in_row, conv.in_channels,
+                                      weights, scales, bias, row_out + x * conv.out_channels,
+                                      conv.out_channels, tile_residual(x), epilogue.relu);
+                }
+            }
+        }
+    }
+}
+
+char const* int8_kernel_name() {
+#if defined(__AVX512VNNI__)
+    return "AVX-512 VNNI";
+#elif defined(__AVXVNNI__)
+    return "AVX-VNNI";
+#elif defined(__AVX2__)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+
+void relu(std::span<float> values) {
+    for (float& value : values) {
+        value = std::max(value, 0.0f);
+    }
+}
+
+void add_relu(std::span<float> values, std::span<float const> residual) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = std::max(values[i] + residual[i], 0.0f);
+    }
+}
+
+static float dot(float const* a, float const* b, int size) {
+    float lanes[kDotLanes] = {};
+    int i = 0;
+    for (; i + kDotLanes <= size; i += kDotLanes) {
+        for (int j = 0; j < kDotLanes; ++j) {
+            lanes[j] += a[i + j] * b[i + j];
+        }
+    }
+
+    float sum = 0.0f;
+    for (; i < size; ++i) {
+        sum += a[i] * b[i];
+    }
+    for (float lane : lanes) {
+        sum += lane;
+    }
+    return sum;
+}
+
+void linear(std::span<float const> weights, std::span<float const> bias, int in_size,
+            int out_size, float const* in, float* out, int count) {
+    // Row by row, so each row is read from memory once for the whole batch.
+    for (int o = 0; o < out_size; ++o) {
+        float const* row = weights.data() + std::size_t(o) * in_size;
+        for (int i = 0; i < count; ++i) {
+            out[i * out_size + o] = bias[o] + dot(row, in + std::size_t(i) * in_size, in_size);
+        }
+    }
+}
+
+void sparse_linear(std::span<float const> weights, std::span<float const> bias, int in_size,
+                   std::span<int const> rows, float const* in, float* out) {
+    for (std::size_t k = 0; k < rows.size(); ++k) {
+        out[k] = bias[rows[k]] + dot(weights.data() + std::size_t(rows[k]) * in_size, in, in_size);
+    }
+}
+
+void strip_border(ImageShape shape, float const* in, float* out, int count) {
+    std::size_t const row = std::size_t(shape.width) * shape.channels;
+    std::size_t const padded_row = std::size_t(shape.width + 2) * shape.channels;
+
+    for (int image = 0; image < count; ++image) {
+        float const* image_in = in + image * shape.size() + padded_row + shape.channels;
+        for (int y = 0; y < shape.height; ++y) {
+            std::copy_n(image_in + y * padded_row, row, out);
+            out += row;
+        }
+    }
+}
+
+void softmax(std::span<float> values) {
+    if (values.empty()) {
+        return;
+    }
+    float const max = *std::ranges::max_element(values);
+    float sum = 0.0f;
+    for (float& value : values) {
+        value = std::exp(value - max);
+        sum += value;
+    }
+    for (float& value : values) {
+        value /= sum;
+    }
+}
+
+void log_softmax(std::span<float> values) {
+    if (values.empty()) {
+        return;
+    }
+    float const max = *std::ranges::max_element(values);
+    float sum = 0.0f;
+    for (float value : values) {
+        sum += std::exp(value - max);
+    }
+    float const log_sum = max + std::log(sum);
+    for (float& value : values) {
+        value -= log_sum;
+    }
+}
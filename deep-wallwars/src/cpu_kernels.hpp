@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Kernels of the CPU inference backend.
+//
+// Activations are stored channels last (all channels of a pixel next to each other) with a border
+// of one zero pixel around the board, so that 3x3 convolutions need no bounds checks. A batch is
+// just several of those images back to back.
+
+// Number of output channels a convolution computes at once. Weights are packed in blocks of this
+// many output channels, so each block is a few dozen KiB and stays in cache while it is applied to
+// all images of a batch.
+constexpr int kConvBlock = 16;
+
+struct ImageShape {
+    int height;
+    int width;
+    int channels;
+
+    // Including the border.
+    std::size_t size() const {
+        return std::size_t(height + 2) * (width + 2) * channels;
+    }
+};
+
+// Applied to the outputs of a convolution as they are stored, which saves the separate passes over
+// the activations that a bias, residual connection or activation would otherwise need. The outputs
+// are max(conv + bias + residual, 0) with a ReLU.
+struct ConvEpilogue {
+    // Images of the same shape as the output, or nullptr.
+    float const* residual = nullptr;
+    bool relu = false;
+};
+
+// 3x3 convolution with stride 1 and padding 1.
+struct PackedConv {
+    int in_channels;
+    int out_channels;
+    // [out_channels / kConvBlock][3][3][in_channels][kConvBlock]
+    std::span<float const> weights;
+    std::span<float const> bias;
+    // Keeps the memory of the weights and bias alive: their own buffer, or a mapped file.
+    std::shared_ptr<void const> storage;
+};
+
+// From PyTorch/ONNX weights in [out_channels][in_channels][3][3] layout. The output channels must
+// be a multiple of kConvBlock.
+PackedConv pack_conv3x3(std::span<float const> weights, std::span<float const> bias,
+                        int out_channels, int in_channels);
+
+// Convolves `count` images. Only the inside of the output images is written, so their borders must
+// have been zeroed before.
+void conv3x3(PackedConv const& conv, int height, int width, float const* in, float* out,
+             int count, ConvEpilogue epilogue = {});
+
+// The same convolution with the Winograd F(2x2, 3x3) algorithm: the images are cut into 2x2 output
+// tiles, each of which takes 16 multiplications per pair of channels instead of 36. The weights are
+// transformed once, when the convolution is created. Results differ from conv3x3 by rounding only.
+struct WinogradConv {
+    int in_channels;
+    int out_channels;
+    // [16][out_channels / kConvBlock][in_channels][kConvBlock]
+    std::vector<float> weights;
+    std::vector<float> bias;
+};
+
+WinogradConv winograd_conv3x3(PackedConv const& conv);
+
+// Number of floats of scratch space conv3x3_winograd needs for `count` images.
+std::size_t winograd_scratch_size(WinogradConv const& conv, int height, int width, int count);
+
+void conv3x3_winograd(WinogradConv const& conv, int height, int width, float const* in,
+                      float* out, int count, float* scratch, ConvEpilogue epilogue = {});
+
+// Int8 convolutions multiply unsigned 7 bit activations with signed 8 bit weights. Using 7 rather
+// than 8 bits for the activations keeps the pairwise products of the AVX2 kernel (vpmaddubsw) from
+// saturating, so every kernel computes exactly the same results. Convolution inputs are always
+// non-negative (input planes or the outputs of a ReLU), so no sign bit is needed.
+constexpr int kMaxQuantizedActivation = 127;
+constexpr int kMaxQuantizedWeight = 127;
+
+// Input channels of int8 convolutions are processed in groups of this many, matching the 4-way
+// dot products of VNNI. Quantized images have their channels padded with zeros to a multiple of it.
+constexpr int kChannelGroup = 4;
+
+int quantized_channels(int channels);
+
+struct QuantizedConv {
+    // Padded to a multiple of kChannelGroup.
+    int in_channels;
+    int out_channels;
+    // [out_channels / kConvBlock][3][3][in_channels / kChannelGroup][kConvBlock][kChannelGroup]
+    std::vector<std::int8_t> weights;
+    // Converts the integer sums of each output channel back to floats (input scale times weight
+    // scale).
+    std::vector<float> scales;
+    std::vector<float> bias;
+    // Activations are quantized as round(value / input_scale).
+    float input_scale;
+};
+
+// Symmetric per output channel quantization of the weights. `input_scale` should map the largest
+// expected input to kMaxQuantizedActivation.
+QuantizedConv quantize_conv3x3(PackedConv const& conv, float input_scale);
+
+// Quantizes `count` images (including their borders) for a convolution with the given input scale.
+// The output images have quantized_channels(shape.channels) channels.
+void quantize_images(ImageShape shape, float const* in, std::uint8_t* out, float input_scale,
+                     int count);
+
+// Same as conv3x3, on images quantized for this convolution. The output is not quantized.
+void conv3x3_int8(QuantizedConv const& conv, int height, int width, std::uint8_t const* in,
+                  float* out, int count, ConvEpilogue epilogue = {});
+
+// The instruction set the int8 convolution was compiled for.
+char const* int8_kernel_name();
+
+// Unfused versions of the epilogues, for comparison.
+void relu(std::span<float> values);
+// values = max(values + residual, 0)
+void add_relu(std::span<float> values, std::span<float const> residual);
+
+// Fully connected layer from `in_size` to `out_size` values for each of `count` inputs. The weights
+// are row major ([out_size][in_size]).
+void linear(std::span<float const> weights, std::span<float const> bias, int in_size,
+            int out_size, float const* in, float* out, int count);
+
+// The outputs of `linear` listed in `rows` for a single input, in that order.
+void sparse_linear(std::span<float const> weights, std::span<float const> bias, int in_size,
+                   std::span<int const> rows, float const* in, float* out);
+
+// Copies the inside of `count` images into contiguous [pixel][channel] arrays.
+void strip_border(ImageShape shape, float const* in, float* out, int count);
+
+// Both leave empty spans (positions without legal actions) alone.
+void softmax(std::span<float> values);
+void log_softmax(std::span<float> values);
@@ -0,0 +1,639 @@
+#include "cpu_model.hpp"
+
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "onnx_graph.hpp"
+#include "state_conversions.hpp"
+#include "wwnet.hpp"
+
+static OnnxNode const& expect_producer(OnnxGraph const& graph, std::string const& tensor,
+                                       std::string_view op_type) {
+    OnnxNode const* node = graph.producer(tensor);
+    if (!node || node->op_type != op_type) {
+        throw std::runtime_error("Unexpected network structure: expected " + std::string(op_type) +
+                                 " producing " + tensor);
+    }
+    return *node;
+}
+
+// The convolution producing `tensor`, possibly through a BatchNormalization, or nullptr.
+static OnnxNode const* conv_producer(OnnxGraph const& graph, std::string const& tensor) {
+    OnnxNode const* node = graph.producer(tensor);
+    if (node && node->op_type == "BatchNormalization") {
+        node = graph.producer(node->inputs.at(0));
+    }
+    return node && node->op_type == "Conv" ? node : nullptr;
+}
+
+static OnnxNode const& expect_conv(OnnxGraph const& graph, std::string const& tensor) {
+    OnnxNode const* node = conv_producer(graph, tensor);
+    if (!node) {
+        throw std::runtime_error("Unexpected network structure: expected Conv producing " + tensor);
+    }
+    return *node;
+}
+
+// y = scale * (x - mean) / sqrt(var + epsilon) + shift is folded into the weights and bias.
+static void fold_batch_norm(OnnxGraph const& graph, OnnxNode const& batch_norm,
+                            ResNetWeights::Conv& conv) {
+    auto parameter = [&](int input) -> std::vector<float> const& {
+        auto const& data = graph.initializer(batch_norm.inputs.at(input)).data;
+        if (int(data.size()) != conv.out_channels) {
+            throw std::runtime_error("Batch normalization does not match its convolution!");
+        }
+        return data;
+    };
+    auto const& scale = parameter(1);
+    auto const& shift = parameter(2);
+    auto const& mean = parameter(3);
+    auto const& var = parameter(4);
+
+    auto epsilon = batch_norm.attributes.find("epsilon");
+    float const eps = epsilon == batch_norm.attributes.end() ? 1e-5f : epsilon->second.f;
+
+    std::size_t const filter_size = std::size_t(conv.in_channels) * 9;
+    for (int o = 0; o < conv.out_channels; ++o) {
+        float const factor = scale[o] / std::sqrt(var[o] + eps);
+        for (std::size_t i = 0; i < filter_size; ++i) {
+            conv.weights[o * filter_size + i] *= factor;
+        }
+        conv.bias[o] = (conv.bias[o] - mean[o]) * factor + shift[o];
+    }
+}
+
+// Reads the convolution producing `tensor`. Exports that keep batch normalization as a separate
+// node (as PyTorch does without constant folding) have it folded into the convolution.
+static ResNetWeights::Conv conv_from_onnx(OnnxGraph const& graph, std::string const& tensor) {
+    OnnxNode const& node = expect_conv(graph, tensor);
+    OnnxTensor const& weights = graph.initializer(node.inputs.at(1));
+    if (weights.dims.size() != 4 || weights.dims[2] != 3 || weights.dims[3] != 3) {
+        throw std::runtime_error("Only 3x3 convolutions are supported!");
+    }
+
+    auto check_attribute = [&](std::string const& name, std::vector<std::int64_t> expected) {
+        auto it = node.attributes.find(name);
+        if (it != node.attributes.end() && it->second.ints != expected) {
+            throw std::runtime_error("Unsupported convolution attribute " + name);
+        }
+    };
+    check_attribute("pads", {1, 1, 1, 1});
+    check_attribute("strides", {1, 1});
+    check_attribute("dilations", {1, 1});
+
+    ResNetWeights::Conv conv{int(weights.dims[0]), int(weights.dims[1]), weights.data, {}};
+    if (node.inputs.size() > 2) {
+        conv.bias = graph.initializer(node.inputs[2]).data;
+    } else {
+        conv.bias.assign(conv.out_channels, 0.0f);
+    }
+
+    OnnxNode const* batch_norm = graph.producer(tensor);
+    if (batch_norm != &node) {
+        fold_batch_norm(graph, *batch_norm, conv);
+    }
+    return conv;
+}
+
+// Traces a head back from its output: Conv -> (BatchNormalization) -> Relu -> Flatten -> Gemm ->
+// `activation`. Returns the input of the head.
+static std::string head_from_onnx(OnnxGraph const& graph, std::string const& output,
+                                  OnnxNode const& activation, ResNetWeights::Conv& conv,
+                                  ResNetWeights::Linear& linear) {
+    OnnxNode const& gemm = expect_producer(graph, activation.inputs.at(0), "Gemm");
+    auto trans_b = gemm.attributes.find("transB");
+    if (trans_b == gemm.attributes.end() || trans_b->second.i != 1) {
+        throw std::runtime_error("Unsupported layout of the linear layer producing " + output);
+    }
+
+    OnnxTensor const& weights = graph.initializer(gemm.inputs.at(1));
+    linear = {int(weights.dims.at(0)), int(weights.dims.at(1)), weights.data,
+              graph.initializer(gemm.inputs.at(2)).data};
+
+    OnnxNode const& flatten = expect_producer(graph, gemm.inputs[0], "Flatten");
+    OnnxNode const& relu = expect_producer(graph, flatten.inputs.at(0), "Relu");
+    conv = conv_from_onnx(graph, relu.inputs.at(0));
+    return expect_conv(graph, relu.inputs[0]).inputs.at(0);
+}
+
+ResNetWeights resnet_from_onnx(OnnxGraph const& graph) {
+    if (graph.inputs.size() != 1 || graph.inputs[0].dims.size() != 4) {
+        throw std::runtime_error("Expected a single 4D network input!");
+    }
+
+    ResNetWeights weights;
+    weights.input_channels = int(graph.inputs[0].dims[1]);
+    weights.columns = int(graph.inputs[0].dims[2]);
+    weights.rows = int(graph.inputs[0].dims[3]);
+
+    OnnxNode const* prior_activation = graph.producer("Priors");
+    if (!prior_activation ||
+        (prior_activation->op_type != "Softmax" && prior_activation->op_type != "LogSoftmax")) {
+        throw std::runtime_error("Unexpected network structure: priors are not a softmax!");
+    }
+    weights.log_priors = prior_activation->op_type == "LogSoftmax";
+
+    auto const trunk = head_from_onnx(graph, "Priors", *prior_activation, weights.prior_conv,
+                                      weights.prior_linear);
+    auto const& value_activation = expect_producer(graph, "Values", "Tanh");
+    auto const value_trunk = head_from_onnx(graph, "Values", value_activation, weights.value_conv,
+                                            weights.value_linear);
+    if (trunk != value_trunk) {
+        throw std::runtime_error("Unexpected network structure: heads have different inputs!");
+    }
+
+    int const board_size = weights.columns * weights.rows;
+    weights.move_prior_size = weights.prior_linear.out_size - 2 * board_size;
+
+    // Walk the residual blocks back to the start.
+    std::string tensor = trunk;
+    while (true) {
+        OnnxNode const& relu = expect_producer(graph, tensor, "Relu");
+        OnnxNode const* start = conv_producer(graph, relu.inputs.at(0));
+        if (start && start->inputs.at(0) == graph.inputs[0].name) {
+            weights.start = conv_from_onnx(graph, relu.inputs[0]);
+            break;
+        }
+
+        OnnxNode const* node = graph.producer(relu.inputs[0]);
+        if (!node || node->op_type != "Add") {
+            throw std::runtime_error("Unexpected network structure before " + tensor);
+        }
+
+        // One of the summands is the output of the second convolution, the other the residual.
+        int const conv_input = conv_producer(graph, node->inputs.at(1)) ? 1 : 0;
+        std::string const& conv2_output = node->inputs.at(conv_input);
+        OnnxNode const& inner_relu =
+            expect_producer(graph, expect_conv(graph, conv2_output).inputs.at(0), "Relu");
+        std::string const& conv1_output = inner_relu.inputs.at(0);
+
+        tensor = node->inputs.at(1 - conv_input);
+        if (expect_conv(graph, conv1_output).inputs.at(0) != tensor) {
+            throw std::runtime_error("Unexpected network structure: broken residual connection");
+        }
+
+        weights.blocks.insert(weights.blocks.begin(), {conv_from_onnx(graph, conv1_output),
+                                                       conv_from_onnx(graph, conv2_output)});
+    }
+
+    return weights;
+}
+
+// The linear layers of the heads take their input flattened in channels first order. Our
+// activations are channels last, so we permute the weights instead of the activations.
+static PackedLinear pack_linear(ResNetWeights::Linear const& linear, int channels, int pixels) {
+    if (linear.in_size != channels * pixels) {
+        throw std::runtime_error("Linear layer does not match the size of the head!");
+    }
+
+    // The bias goes right after the weights.
+    auto storage = std::make_shared<std::vector<float>>(linear.weights.size());
+    for (int o = 0; o < linear.out_size; ++o) {
+        for (int c = 0; c < channels; ++c) {
+            for (int p = 0; p < pixels; ++p) {
+                (*storage)[std::size_t(o) * linear.in_size + p * channels + c] =
+                    linear.weights[std::size_t(o) * linear.in_size + c * pixels + p];
+            }
+        }
+    }
+    storage->insert(storage->end(), linear.bias.begin(), linear.bias.end());
+
+    std::span<float const> const packed{*storage};
+    return {linear.in_size, linear.out_size, packed.first(linear.weights.size()),
+            packed.subspan(linear.weights.size()), std::move(storage)};
+}
+
+static PackedConv pack(ResNetWeights::Conv const& conv) {
+    return pack_conv3x3(conv.weights, conv.bias, conv.out_channels, conv.in_channels);
+}
+
+PackedResNet pack_resnet(ResNetWeights const& weights) {
+    PackedResNet network{weights.columns, weights.rows, weights.input_channels,
+                         weights.move_prior_size, weights.log_priors};
+
+    network.convs.push_back(pack(weights.start));
+    for (auto const& [conv1, conv2] : weights.blocks) {
+        network.convs.push_back(pack(conv1));
+        network.convs.push_back(pack(conv2));
+    }
+    network.convs.push_back(pack(weights.prior_conv));
+    network.convs.push_back(pack(weights.value_conv));
+
+    int const pixels = weights.columns * weights.rows;
+    network.prior_linear =
+        pack_linear(weights.prior_linear, weights.prior_conv.out_channels, pixels);
+    network.value_linear =
+        pack_linear(weights.value_linear, weights.value_conv.out_channels, pixels);
+    return network;
+}
+
+CpuResNetModel::CpuResNetModel(ResNetWeights const& weights, int batch_size,
+                               std::shared_ptr<InferenceExecutor> executor,
+                               ConvAlgorithm algorithm)
+    : CpuResNetModel{pack_resnet(weights), batch_size, std::move(executor), algorithm} {}
+
+CpuResNetModel::CpuResNetModel(PackedResNet network, int batch_size,
+                               std::shared_ptr<InferenceExecutor> executor,
+                               ConvAlgorithm algorithm)
+    : Model{batch_size, network.input_channels, network.columns, network.rows,
+            network.move_prior_size},
+      m_columns{network.columns},
+      m_rows{network.rows},
+      m_input_channels{network.input_channels},
+      m_hidden_channels{network.convs.at(0).out_channels},
+      m_head_channels{network.convs.back().out_channels},
+      m_convs{std::move(network.convs)},
+      m_prior_linear{std::move(network.prior_linear)},
+      m_value_linear{std::move(network.value_linear)},
+      m_log_priors{network.log_priors},
+      m_executor{std::move(executor)},
+      m_threads{std::max(1, std::min(m_executor ? m_executor->threads() : 1, batch_size))},
+      m_images_per_thread{(batch_size + m_threads - 1) / m_threads} {
+    // Packed networks may come from a file, so check everything the kernels rely on.
+    std::size_t const prior_layer = m_convs.size() - 2;
+    if (m_convs.size() < 3 || prior_layer % 2 == 0) {
+        throw std::runtime_error("Unexpected number of convolutions in the network!");
+    }
+    for (std::size_t layer = 0; layer < m_convs.size(); ++layer) {
+        PackedConv const& conv = m_convs[layer];
+        int const in_channels = layer == 0 ? m_input_channels : m_hidden_channels;
+        int const out_channels = layer < prior_layer ? m_hidden_channels : m_head_channels;
+        if (conv.in_channels != in_channels || conv.out_channels != out_channels ||
+            out_channels % kConvBlock != 0 ||
+            conv.weights.size() != std::size_t(9) * in_channels * out_channels ||
+            conv.bias.size() != std::size_t(out_channels)) {
+            throw std::runtime_error("Convolution " + std::to_string(layer) +
+                                     " does not fit the network!");
+        }
+    }
+
+    int const pixels = m_columns * m_rows;
+    for (PackedLinear const* linear : {&m_prior_linear, &m_value_linear}) {
+        if (linear->in_size != m_head_channels * pixels ||
+            linear->weights.size() != std::size_t(linear->in_size) * linear->out_size ||
+            linear->bias.size() != std::size_t(linear->out_size)) {
+            throw std::runtime_error("Linear layer does not match the size of the head!");
+        }
+    }
+    if (m_prior_linear.out_size != prior_size() || m_value_linear.out_size != 1) {
+        throw std::runtime_error("Unexpected output sizes of the network!");
+    }
+
+    std::size_t winograd_scratch = 0;
+    if (algorithm == ConvAlgorithm::Winograd) {
+        for (PackedConv const& conv : m_convs) {
+            auto const& winograd = m_winograd_convs.emplace_back(winograd_conv3x3(conv));
+            winograd_scratch = std::max(
+                winograd_scratch,
+                winograd_scratch_size(winograd, m_columns, m_rows, m_images_per_thread));
+        }
+    }
+
+    auto images = [&](int channels) {
+        return std::vector<float>(ImageShape{m_columns, m_rows, channels}.size() *
+                                  m_images_per_thread);
+    };
+
+    m_workspaces.resize(m_threads);
+    for (Workspace& workspace : m_workspaces) {
+        workspace.input = images(m_input_channels);
+        for (auto& hidden : workspace.hidden) {
+            hidden = images(m_hidden_channels);
+        }
+        workspace.head = images(m_head_channels);
+        workspace.flat.resize(std::size_t(pixels) * m_head_channels * m_images_per_thread);
+        workspace.winograd.resize(winograd_scratch);
+        workspace.legal_actions.resize(prior_size());
+        workspace.legal_priors.resize(prior_size());
+    }
+}
+
+void CpuResNetModel::quantize(std::span<float const> states) {
+    std::size_t const positions = states.size() / m_state_size;
+    if (positions == 0 || states.size() % m_state_size != 0) {
+        throw std::runtime_error("Calibration positions do not match the model!");
+    }
+
+    // Calibrate in float.
+    m_quantized_convs.clear();
+
+    std::vector<float> input_max(m_convs.size(), 0.0f);
+    std::vector<float> priors(std::size_t(m_images_per_thread) * prior_size());
+    std::vector<float> values(m_images_per_thread);
+    for (std::size_t first = 0; first < positions; first += m_images_per_thread) {
+        int const count = int(std::min<std::size_t>(m_images_per_thread, positions - first));
+        run(m_workspaces[0], states.data() + first * m_state_size, nullptr, priors.data(),
+            values.data(), count, input_max);
+    }
+
+    for (std::size_t i = 0; i < m_convs.size(); ++i) {
+        float const input_scale =
+            input_max[i] > 0.0f ? input_max[i] / kMaxQuantizedActivation : 1.0f;
+        m_quantized_convs.push_back(quantize_conv3x3(m_convs[i], input_scale));
+    }
+
+    ImageShape const largest{m_columns, m_rows,
+                             quantized_channels(std::max(m_input_channels, m_hidden_channels))};
+    for (Workspace& workspace : m_workspaces) {
+        workspace.quantized.resize(largest.size() * m_images_per_thread);
+    }
+}
+
+bool CpuResNetModel::quantized() const {
+    return !m_quantized_convs.empty();
+}
+
+int CpuResNetModel::columns() const {
+    return m_columns;
+}
+
+int CpuResNetModel::rows() const {
+    return m_rows;
+}
+
+void CpuResNetModel::inference(std::span<float> states, Output const& out) {
+    infer(states, {}, out);
+}
+
+void CpuResNetModel::value_inference(std::span<float> states, std::span<float> values) {
+    infer(states, {}, {{}, values});
+}
+
+void CpuResNetModel::legal_inference(std::span<float> states, std::span<std::uint8_t const> legal,
+                                     Output const& out) {
+    if (legal.size() != out.priors.size()) {
+        throw std::runtime_error("Legal actions do not match the inference buffers!");
+    }
+    infer(states, legal, out);
+}
+
+void CpuResNetModel::infer(std::span<float> states, std::span<std::uint8_t const> legal,
+                           Output const& out) {
+    int const count = int(out.values.size());
+    bool const value_only = out.priors.empty();
+    if (count > m_batch_size || states.size() != std::size_t(count) * m_state_size ||
+        (!value_only && out.priors.size() != std::size_t(count) * prior_size())) {
+        throw std::runtime_error("Inference buffers do not match the model!");
+    }
+
+    // Small batches use fewer threads rather than tiny shares.
+    int const per_thread = std::max(1, (count + m_threads - 1) / m_threads);
+    int const chunks = (count + per_thread - 1) / per_thread;
+
+    auto run_chunk = [&, per_thread](int chunk) {
+        int const first = chunk * per_thread;
+        std::size_t const prior_offset = std::size_t(first) * prior_size();
+        run(m_workspaces[chunk], states.data() + std::size_t(first) * m_state_size,
+            legal.empty() ? nullptr : legal.data() + prior_offset,
+            value_only ? nullptr : out.priors.data() + prior_offset, out.values.data() + first,
+            std::min(per_thread, count - first));
+    };
+
+    if (!m_executor) {
+        run_chunk(0);
+        return;
+    }
+    // Even single chunks go to the executor, whose threads may be pinned to the inference cores.
+    m_executor->parallel_for(chunks, run_chunk);
+}
+
+void CpuResNetModel::run(Workspace& workspace, float const* states, std::uint8_t const* legal,
+                         float* priors, float* values, int count, std::span<float> input_max) {
+    int const pixels = m_columns * m_rows;
+    ImageShape const input_shape{m_columns, m_rows, m_input_channels};
+    ImageShape const head_shape{m_columns, m_rows, m_head_channels};
+
+    // Model inputs are planes (channels first), so transpose them into the inside of the images.
+    for (int image = 0; image < count; ++image) {
+        float const* state = states + std::size_t(image) * m_state_size;
+        float* input = workspace.input.data() + image * input_shape.size();
+        for (int p = 0; p < pixels; ++p) {
+            int const y = p / m_rows;
+            int const x = p % m_rows;
+            float* pixel = input + (std::size_t(y + 1) * (m_rows + 2) + x + 1) * m_input_channels;
+            for (int c = 0; c < m_input_channels; ++c) {
+                pixel[c] = state[c * pixels + p];
+            }
+        }
+    }
+
+    auto convolve = [&](std::size_t layer, int in_channels, float const* in, float* out,
+                        ConvEpilogue epilogue) {
+        ImageShape const in_shape{m_columns, m_rows, in_channels};
+        if (!input_max.empty()) {
+            auto const inputs = std::span(in, in_shape.size() * count);
+            input_max[layer] = std::max(input_max[layer], *std::ranges::max_element(inputs));
+        }
+
+        if (!m_quantized_convs.empty()) {
+            QuantizedConv const& conv = m_quantized_convs[layer];
+            quantize_images(in_shape, in, workspace.quantized.data(), conv.input_scale, count);
+            conv3x3_int8(conv, m_columns, m_rows, workspace.quantized.data(), out, count,
+                         epilogue);
+        } else if (!m_winograd_convs.empty()) {
+            conv3x3_winograd(m_winograd_convs[layer], m_columns, m_rows, in, out, count,
+                             workspace.winograd.data(), epilogue);
+        } else {
+            conv3x3(m_convs[layer], m_columns, m_rows, in, out, count, epilogue);
+        }
+    };
+
+    float* x = workspace.hidden[0].data();
+    float* t = workspace.hidden[1].data();
+    float* y = workspace.hidden[2].data();
+
+    // Bias, residual connections and ReLUs are all applied by the convolutions.
+    convolve(0, m_input_channels, workspace.input.data(), x, {.relu = true});
+
+    std::size_t const prior_layer = m_convs.size() - 2;
+    for (std::size_t layer = 1; layer < prior_layer; layer += 2) {
+        convolve(layer, m_hidden_channels, x, t, {.relu = true});
+        convolve(layer + 1, m_hidden_channels, t, y, {.residual = x, .relu = true});
+        std::swap(x, y);
+    }
+
+    auto run_head_conv = [&](std::size_t layer) {
+        convolve(layer, m_hidden_channels, x, workspace.head.data(), {.relu = true});
+        strip_border(head_shape, workspace.head.data(), workspace.flat.data(), count);
+    };
+    auto normalize = [&](std::span<float> image_priors) {
+        if (m_log_priors) {
+            log_softmax(image_priors);
+        } else {
+            softmax(image_priors);
+        }
+    };
+
+    // Value-only inference skips the policy head.
+    if (priors) {
+        run_head_conv(prior_layer);
+        if (!legal) {
+            linear(m_prior_linear.weights, m_prior_linear.bias, m_prior_linear.in_size,
+                   m_prior_linear.out_size, workspace.flat.data(), priors, count);
+            for (int image = 0; image < count; ++image) {
+                normalize({priors + std::size_t(image) * prior_size(), std::size_t(prior_size())});
+            }
+        } else {
+            // Only the rows of the linear layer that belong to legal actions are computed.
+            for (int image = 0; image < count; ++image) {
+                std::uint8_t const* image_legal = legal + std::size_t(image) * prior_size();
+                int actions = 0;
+                for (int action = 0; action < prior_size(); ++action) {
+                    if (image_legal[action]) {
+                        workspace.legal_actions[actions++] = action;
+                    }
+                }
+
+                std::span<int const> const legal_actions{workspace.legal_actions.data(),
+                                                         std::size_t(actions)};
+                std::span<float> const legal_priors{workspace.legal_priors.data(),
+                                                    std::size_t(actions)};
+                sparse_linear(m_prior_linear.weights, m_prior_linear.bias, m_prior_linear.in_size,
+                              legal_actions, workspace.flat.data() + image * m_prior_linear.in_size,
+                              legal_priors.data());
+                normalize(legal_priors);
+
+                float* image_priors = priors + std::size_t(image) * prior_size();
+                std::fill_n(image_priors, prior_size(),
+                            m_log_priors ? -std::numeric_limits<float>::infinity() : 0.0f);
+                for (int k = 0; k < actions; ++k) {
+                    image_priors[legal_actions[k]] = legal_priors[k];
+                }
+            }
+        }
+    }
+
+    run_head_conv(prior_layer + 1);
+    linear(m_value_linear.weights, m_value_linear.bias, m_value_linear.in_size,
+           m_value_linear.out_size, workspace.flat.data(), values, count);
+    for (int image = 0; image < count; ++image) {
+        values[image] = std::tanh(values[image]);
+    }
+}
+
+AccuracyReport compare_models(Model& reference, Model& model, std::span<float const> states) {
+    int const positions = int(states.size() / model.state_size());
+    int const batch_size = std::min(reference.batch_size(), model.batch_size());
+    if (reference.state_size() != model.state_size() ||
+        reference.prior_size() != model.prior_size()) {
+        throw std::runtime_error("Cannot compare models of different shapes!");
+    }
+
+    AccuracyReport report{positions, 0.0, 0.0, 0.0};
+    std::vector<float> batch_states(std::size_t(batch_size) * model.state_size());
+    std::vector<float> reference_priors(std::size_t(batch_size) * model.prior_size());
+    std::vector<float> priors(reference_priors.size());
+    std::vector<float> reference_values(batch_size);
+    std::vector<float> values(batch_size);
+
+    int agreements = 0;
+    for (int first = 0; first < positions; first += batch_size) {
+        int const count = std::min(batch_size, positions - first);
+        auto const batch = std::span(batch_states).first(std::size_t(count) * model.state_size());
+        std::ranges::copy(states.subspan(std::size_t(first) * model.state_size(), batch.size()),
+                          batch.begin());
+
+        auto const prior_count = std::size_t(count) * model.prior_size();
+        reference.inference(batch, {std::span(reference_priors).first(prior_count),
+                                    std::span(reference_values).first(count)});
+        model.inference(batch,
+                        {std::span(priors).first(prior_count), std::span(values).first(count)});
+
+        for (int i = 0; i < count; ++i) {
+            auto const offset = std::size_t(i) * model.prior_size();
+            auto const size = std::size_t(model.prior_size());
+            auto const reference_prior = std::span(reference_priors).subspan(offset, size);
+            auto const prior = std::span(priors).subspan(offset, size);
+            agreements += std::ranges::max_element(reference_prior) - reference_prior.begin() ==
+                          std::ranges::max_element(prior) - prior.begin();
+
+            double const error = std::abs(reference_values[i] - values[i]);
+            report.value_mae += error;
+            report.max_value_error = std::max(report.max_value_error, error);
+        }
+    }
+
+    if (positions > 0) {
+        report.top1_agreement = double(agreements) / positions;
+        report.value_mae /= positions;
+    }
+    return report;
+}
+
+CalibrationData read_calibration_data(std::filesystem::path const& folder, int state_size,
+                                      int positions) {
+    std::vector<std::filesystem::path> games;
+    for (auto const& entry : std::filesystem::directory_iterator{folder}) {
+        if (entry.path().extension() == ".csv") {
+            games.push_back(entry.path());
+        }
+    }
+    // Directory order is arbitrary, but the split should not be.
+    std::ranges::sort(games);
+
+    CalibrationData data;
+    std::size_t const max_size = std::size_t(positions) * state_size;
+    for (std::size_t game = 0; game < games.size(); ++game) {
+        std::vector<float>& out = game % 2 == 0 ? data.calibration : data.held_out;
+        std::ifstream game_file{games[game]};
+        for (ModelInput const& input : read_training_inputs(game_file)) {
+            if (int(input.size()) == state_size && out.size() < max_size) {
+                out.insert(out.end(), input.begin(), input.end());
+            }
+        }
+
+        if (data.calibration.size() == max_size && data.held_out.size() == max_size) {
+            break;
+        }
+    }
+
+    if (data.calibration.empty() || data.held_out.empty()) {
+        throw std::runtime_error("Not enough training data of the right size in " +
+                                 folder.string());
+    }
+    return data;
+}
+
+// Enough to see the typical activations, while keeping the start up reasonably fast.
+constexpr int kCalibrationPositions = 256;
+
+bool is_cpu_model(std::filesystem::path const& path) {
+    return path.extension() == ".onnx" || path.extension() == ".wwnet";
+}
+
+std::unique_ptr<CpuResNetModel> load_cpu_resnet(std::filesystem::path const& path,
+                                                int batch_size,
+                                                std::shared_ptr<InferenceExecutor> executor,
+                                                std::filesystem::path const& calibration_folder,
+                                                ConvAlgorithm algorithm) {
+    auto const start = std::chrono::steady_clock::now();
+    auto const network = path.extension() == ".wwnet"
+                             ? map_wwnet(path)
+                             : pack_resnet(resnet_from_onnx(read_onnx_graph(path)));
+    auto model = std::make_unique<CpuResNetModel>(network, batch_size, executor, algorithm);
+    XLOGF(INFO, "Loaded {} for CPU inference in {:.1f} ms", path.string(),
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+              .count());
+    if (calibration_folder.empty()) {
+        return model;
+    }
+
+    auto const data =
+        read_calibration_data(calibration_folder, model->state_size(), kCalibrationPositions);
+    CpuResNetModel reference{network, batch_size, std::move(executor), algorithm};
+    model->quantize(data.calibration);
+
+    auto const report = compare_models(reference, *model, data.held_out);
+    XLOGF(INFO,
+          "Quantized {} to int8 ({} kernel). On {} held out positions: top-1 policy agreement "
+          "{:.1f}%, value MAE {:.4f}, max value error {:.4f}",
+          path.string(), int8_kernel_name(), report.positions, 100 * report.top1_agreement,
+          report.value_mae, report.max_value_error);
+    return model;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "cpu_kernels.hpp"
+#include "inference_executor.hpp"
+#include "model.hpp"
+
+struct OnnxGraph;
+
+// Weights of the ResNet defined in scripts/model.py, in PyTorch layout, with the batch
+// normalizations folded into the convolutions. The spatial dimensions follow the model input:
+// columns first, then rows.
+struct ResNetWeights {
+    struct Conv {
+        int out_channels;
+        int in_channels;
+        // [out_channels][in_channels][3][3]
+        std::vector<float> weights;
+        std::vector<float> bias;
+    };
+
+    struct Linear {
+        int out_size;
+        int in_size;
+        // [out_size][in_size]
+        std::vector<float> weights;
+        std::vector<float> bias;
+    };
+
+    int columns;
+    int rows;
+    int input_channels;
+    int move_prior_size;
+
+    Conv start;
+    std::vector<std::array<Conv, 2>> blocks;
+    Conv prior_conv;
+    Linear prior_linear;
+    Conv value_conv;
+    Linear value_linear;
+
+    // Whether the priors are log probabilities (log_output in scripts/model.py).
+    bool log_priors;
+};
+
+// Extracts the weights from an exported network, with or without constant folding. Throws if the
+// graph has a different structure.
+ResNetWeights resnet_from_onnx(OnnxGraph const& graph);
+
+// Fully connected layer of a head, taking the head's convolution output flattened in channels last
+// order.
+struct PackedLinear {
+    int in_size;
+    int out_size;
+    // [out_size][in_size]
+    std::span<float const> weights;
+    std::span<float const> bias;
+    // Keeps the memory of the weights and bias alive, like PackedConv::storage.
+    std::shared_ptr<void const> storage;
+};
+
+// A ResNet with its weights in the layouts the kernels use: packed from ResNetWeights or mapped
+// from a .wwnet file (see wwnet.hpp).
+struct PackedResNet {
+    int columns;
+    int rows;
+    int input_channels;
+    int move_prior_size;
+    bool log_priors;
+
+    // The start, then two for each residual block, then the prior and the value head.
+    std::vector<PackedConv> convs = {};
+    PackedLinear prior_linear = {};
+    PackedLinear value_linear = {};
+};
+
+PackedResNet pack_resnet(ResNetWeights const& weights);
+
+// How float convolutions are computed (see cpu_kernels.hpp).
+enum class ConvAlgorithm { Direct, Winograd };
+
+// Runs the network on the CPU. With an executor, the batch is split evenly between its threads,
+// each of which runs the whole network on its share. Without one, the calling thread runs it all.
+class CpuResNetModel : public Model {
+public:
+    // Throws if the layers do not fit together.
+    CpuResNetModel(PackedResNet network, int batch_size,
+                   std::shared_ptr<InferenceExecutor> executor = nullptr,
+                   ConvAlgorithm algorithm = ConvAlgorithm::Direct);
+    CpuResNetModel(ResNetWeights const& weights, int batch_size,
+                   std::shared_ptr<InferenceExecutor> executor = nullptr,
+                   ConvAlgorithm algorithm = ConvAlgorithm::Direct);
+
+    void inference(std::span<float> states, Output const& out) override;
+    // Skips the policy head entirely.
+    void value_inference(std::span<float> states, std::span<float> values) override;
+
+    // Same as inference, but only computes the priors of legal actions. `legal` holds prior_size()
+    // flags for each position, which are non-zero for legal actions (see fill_legal_actions). The
+    // priors are normalized over the legal actions only, and illegal actions get a prior of zero
+    // (minus infinity for log priors).
+    void legal_inference(std::span<float> states, std::span<std::uint8_t const> legal,
+                         Output const& out);
+
+    // Switches all convolutions to int8 (see cpu_kernels.hpp). `states` are representative
+    // positions used to calibrate the range of the activations, which should not be too far off
+    // from the positions that are evaluated later: larger activations are clipped.
+    void quantize(std::span<float const> states);
+    bool quantized() const;
+
+    int columns() const;
+    int rows() const;
+
+private:
+    // Scratch space of one thread, big enough for its share of the largest batch.
+    struct Workspace {
+        std::vector<float> input;
+        std::vector<float> hidden[3];
+        std::vector<float> head;
+        std::vector<float> flat;
+        std::vector<std::uint8_t> quantized;
+        std::vector<float> winograd;
+        // Of a single position.
+        std::vector<int> legal_actions;
+        std::vector<float> legal_priors;
+    };
+
+    int m_columns;
+    int m_rows;
+    int m_input_channels;
+    int m_hidden_channels;
+    int m_head_channels;
+
+    // Same order as in PackedResNet.
+    std::vector<PackedConv> m_convs;
+    // Same order, empty unless quantized.
+    std::vector<QuantizedConv> m_quantized_convs;
+    // Same order, empty unless using ConvAlgorithm::Winograd.
+    std::vector<WinogradConv> m_winograd_convs;
+    PackedLinear m_prior_linear;
+    PackedLinear m_value_linear;
+    bool m_log_priors;
+
+    std::shared_ptr<InferenceExecutor> m_executor;
+    int m_threads;
+    int m_images_per_thread;
+    std::vector<Workspace> m_workspaces;
+
+    // Splits the batch between the threads. `legal` is empty for dense priors, and `out.priors` is
+    // empty if only the values are needed.
+    void infer(std::span<float> states, std::span<std::uint8_t const> legal, Output const& out);
+
+    // Records the largest input of each convolution in `input_max` if it is not empty. Skips the
+    // policy head if `priors` is null.
+    void run(Workspace& workspace, float const* states, std::uint8_t const* legal, float* priors,
+             float* values, int count, std::span<float> input_max = {});
+};
+
+// How closely a model follows a reference model.
+struct AccuracyReport {
+    int positions;
+    // Fraction of positions where both agree on the most likely action.
+    double top1_agreement;
+    double value_mae;
+    double max_value_error;
+};
+
+AccuracyReport compare_models(Model& reference, Model& model, std::span<float const> states);
+
+// Self-play positions (see TrainingDataPrinter) split into two disjoint sets of whole games.
+struct CalibrationData {
+    std::vector<float> calibration;
+    std::vector<float> held_out;
+};
+
+// Reads up to `positions` positions for each set from the game_*.csv files in `folder`, skipping
+// positions of other sizes than `state_size`.
+CalibrationData read_calibration_data(std::filesystem::path const& folder, int state_size,
+                                      int positions);
+
+// Whether `path` is a model that load_cpu_resnet can load (.onnx or .wwnet).
+bool is_cpu_model(std::filesystem::path const& path);
+
+// Loads an .onnx or .wwnet model, and quantizes it with training data if `calibration_folder` is
+// not empty. The accuracy of the quantized model on held out positions is logged.
+std::unique_ptr<CpuResNetModel> load_cpu_resnet(
+    std::filesystem::path const& path, int batch_size,
+    std::shared_ptr<InferenceExecutor> executor = nullptr,
+    std::filesystem::path const& calibration_folder = {},
+    ConvAlgorithm algorithm = ConvAlgorithm::Direct);
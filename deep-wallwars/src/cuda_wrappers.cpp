@@ -40,3 +40,18 @@ cudaStream_t CudaStream::get() {
 void CudaStream::synchronize() {
     cuda_check(cudaStreamSynchronize(*m_stream));
 }
+
+void* PinnedHostAllocator::allocate(std::size_t bytes) {
+    void* data = nullptr;
+    cuda_check(cudaMallocHost(&data, bytes));
+    return data;
+}
+
+void PinnedHostAllocator::deallocate(void* data, std::size_t) noexcept {
+    cudaFreeHost(data);
+}
+
+std::shared_ptr<HostAllocator> pinned_host_allocator() {
+    static auto const allocator = std::make_shared<PinnedHostAllocator>();
+    return allocator;
+}
@@ -2,10 +2,13 @@
 
 #include <cuda_runtime.h>
 
+#include <memory>
 #include <optional>
 #include <span>
 #include <stdexcept>
 
+#include "host_buffer.hpp"
+
 class CudaException : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
@@ -31,62 +34,16 @@ private:
     std::optional<cudaStream_t> m_stream;
 };
 
-template <typename T>
-class PinnedBuffer {
+// Page-locked host memory, which the GPU copies from and to much faster than pageable memory.
+class PinnedHostAllocator : public HostAllocator {
 public:
-    PinnedBuffer(std::size_t size) : m_size{size} {
-        cuda_check(cudaMallocHost(&m_data, size * sizeof(T)));
-        std::fill(m_data, m_data + size, T{});
-    }
-
-    ~PinnedBuffer() {
-        cuda_check(cudaFreeHost(m_data));
-    }
-
-    PinnedBuffer(PinnedBuffer const& other) : m_size{other.m_size} {
-        cuda_check(cudaMallocHost(&m_data, m_size * sizeof(T)));
-        std::copy(other.m_data, other.m_data + m_size, m_data);
-    }
-
-    PinnedBuffer(PinnedBuffer&& other) noexcept : PinnedBuffer() {
-        swap(*this, other);
-    }
-
-    friend void swap(PinnedBuffer& lhs, PinnedBuffer& rhs) noexcept {
-        std::swap(lhs.m_data, rhs.m_data);
-        std::swap(lhs.m_size, rhs.m_size);
-    }
-
-    PinnedBuffer& operator=(PinnedBuffer other) noexcept {
-        swap(*this, other);
-        return *this;
-    }
-
-    T& operator[](std::size_t idx) {
-        return m_data[idx];
-    }
-
-    T const& operator[](std::size_t idx) const {
-        return m_data[idx];
-    }
-
-    T* data() const {
-        return m_data;
-    }
-
-    std::size_t size() const {
-        return m_size;
-    }
-
-    operator std::span<T>() const {
-        return std::span<T>(m_data, m_size);
-    }
-
-private:
-    T* m_data;
-    std::size_t m_size;
+    void* allocate(std::size_t bytes) override;
+    void deallocate(void* data, std::size_t bytes) noexcept override;
 };
 
+// A process-wide PinnedHostAllocator.
+std::shared_ptr<HostAllocator> pinned_host_allocator();
+
 template <typename T>
 class CudaBuffer {
 public:
@@ -138,12 +95,13 @@ public:
                                    cudaMemcpyHostToDevice, stream.get()));
     }
 
+    // Downloads the first out.size() elements.
     void to_host(std::span<T> out, CudaStream& stream) {
-        if (m_size > out.size()) {
+        if (out.size() > m_size) {
             throw std::runtime_error("Cannot download buffer to host - too large!");
         }
 
-        cuda_check(cudaMemcpyAsync(out.data(), m_device_ptr, m_size * sizeof(T),
+        cuda_check(cudaMemcpyAsync(out.data(), m_device_ptr, out.size() * sizeof(T),
                                    cudaMemcpyDeviceToHost, stream.get()));
     }
 
@@ -0,0 +1,401 @@
+#include "elo.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+// ln(10) / 400, so that d/dx of the logistic curve in Elo is kSlope * f(x) * (1 - f(x)).
+constexpr double kSlope = 0.0057564627324851142;
+// Newton steps are capped, far from the optimum the quadratic model can be way off.
+constexpr double kMaxStep = 200;
+// Draws have no probability at draw_elo = 0.
+constexpr double kMinDrawElo = 1;
+
+static double expected_score(double elo_difference) {
+    return 1 / (1 + std::exp(-kSlope * elo_difference));
+}
+
+// Cholesky decomposition of the symmetric n x n matrix, in place into its lower triangle.
+static void cholesky(std::vector<double>& matrix, int n) {
+    for (int j = 0; j < n; ++j) {
+        double diagonal = matrix[j * n + j];
+        for (int k = 0; k < j; ++k) {
+            diagonal -= matrix[j * n + k] * matrix[j * n + k];
+        }
+        if (diagonal <= 0) {
+            throw std::runtime_error("Elo estimation is degenerate.");
+        }
+        diagonal = std::sqrt(diagonal);
+        matrix[j * n + j] = diagonal;
+
+        for (int i = j + 1; i < n; ++i) {
+            double entry = matrix[i * n + j];
+            for (int k = 0; k < j; ++k) {
+                entry -= matrix[i * n + k] * matrix[j * n + k];
+            }
+            matrix[i * n + j] = entry / diagonal;
+        }
+    }
+}
+
+// Solves L * L^T * x = b in place, given the decomposition L of cholesky().
+static void cholesky_solve(std::vector<double> const& lower, int n, std::vector<double>& b) {
+    for (int i = 0; i < n; ++i) {
+        for (int k = 0; k < i; ++k) {
+            b[i] -= lower[i * n + k] * b[k];
+        }
+        b[i] /= lower[i * n + i];
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        for (int k = i + 1; k < n; ++k) {
+            b[i] -= lower[k * n + i] * b[k];
+        }
+        b[i] /= lower[i * n + i];
+    }
+}
+
+PlayerRating const& EloRatings::at(std::string const& name) const {
+    auto it = std::ranges::find(players, name, &PlayerRating::name);
+    if (it == players.end()) {
+        throw std::runtime_error("No rating for " + name + ".");
+    }
+    return *it;
+}
+
+BayesElo::BayesElo(EloOptions opts)
+    : m_opts{opts}, m_advantage{opts.advantage}, m_draw_elo{opts.draw_elo} {}
+
+int BayesElo::player_index(std::string const& name) {
+    auto [it, inserted] = m_player_indices.try_emplace(name, int(m_names.size()));
+    if (inserted) {
+        m_names.push_back(name);
+        m_fixed.push_back(false);
+        m_elos.push_back(0);
+    }
+    return it->second;
+}
+
+void BayesElo::add_game(std::string const& red, std::string const& blue, Winner winner) {
+    if (winner == Winner::Undecided) {
+        return;
+    }
+
+    int const red_idx = player_index(red);
+    int const blue_idx = player_index(blue);
+    std::uint64_t const key = (std::uint64_t(red_idx) << 32) | std::uint32_t(blue_idx);
+    auto [it, inserted] = m_pairing_indices.try_emplace(key, int(m_pairings.size()));
+    if (inserted) {
+        m_pairings.push_back({.red = red_idx, .blue = blue_idx});
+    }
+
+    Pairing& pairing = m_pairings[it->second];
+    switch (winner) {
+        case Winner::Red:
+            ++pairing.red_wins;
+            break;
+        case Winner::Blue:
+            ++pairing.blue_wins;
+            break;
+        default:
+            ++pairing.draws;
+            ++m_draws;
+    }
+    ++m_rated_games;
+}
+
+void BayesElo::add_games(std::vector<GameRecorder> const& recorders) {
+    for (GameRecorder const& recorder : recorders) {
+        add_game(recorder.red(), recorder.blue(), recorder.winner());
+    }
+}
+
+int BayesElo::rated_games() const {
+    return m_rated_games;
+}
+
+void BayesElo::fix_rating(std::string const& name, double elo) {
+    int const idx = player_index(name);
+    m_fixed[idx] = true;
+    m_elos[idx] = elo;
+}
+
+EloRatings BayesElo::estimate() {
+    int const players = int(m_names.size());
+    // The ratings, followed by the advantage and the draw Elo.
+    int const params = players + 2;
+    int const advantage_idx = players;
+    int const draw_idx = players + 1;
+
+    bool const fit_advantage = m_opts.fit_advantage && m_rated_games > 0;
+    bool const fit_draw_elo = m_opts.fit_draw_elo && m_draws > 0;
+    bool const anchored = std::ranges::find(m_fixed, true) != m_fixed.end();
+    if (!fit_advantage) {
+        m_advantage = m_opts.fit_advantage ? 0 : m_opts.advantage;
+    }
+    if (!fit_draw_elo) {
+        m_draw_elo = m_opts.fit_draw_elo ? 0 : m_opts.draw_elo;
+    } else if (m_draw_elo < kMinDrawElo) {
+        m_draw_elo = m_opts.draw_elo;
+    }
+
+    // Parameters that are not estimated. The prior of the other ratings is centered on the fixed
+    // ones.
+    std::vector<int> fixed_params;
+    double prior_mean = 0;
+    for (int i = 0; i < players; ++i) {
+        if (m_fixed[i]) {
+            fixed_params.push_back(i);
+            prior_mean += m_elos[i];
+        }
+    }
+    if (anchored) {
+        prior_mean /= double(fixed_params.size());
+    }
+    if (!fit_advantage) {
+        fixed_params.push_back(advantage_idx);
+    }
+    if (!fit_draw_elo) {
+        fixed_params.push_back(draw_idx);
+    }
+
+    // Fisher scoring: Newton's method with the expected instead of the observed information, which
+    // is always positive definite. Its inverse at the optimum is the covariance of the estimate.
+    std::vector<double> information(params * params);
+    std::vector<double> gradient(params);
+
+    auto evaluate = [&] {
+        std::ranges::fill(information, 0.0);
+        std::ranges::fill(gradient, 0.0);
+
+        for (Pairing const& pairing : m_pairings) {
+            double const x = m_elos[pairing.red] - m_elos[pairing.blue] + m_advantage;
+            double const red_wins = expected_score(x - m_draw_elo);
+            double const blue_wins = expected_score(-x - m_draw_elo);
+            double const draws = std::max(0.0, 1 - red_wins - blue_wins);
+
+            // Gradients of the log probabilities of each outcome by x and the draw Elo.
+            std::array<double, 2> const red_gradient{kSlope * (1 - red_wins),
+                                                     -kSlope * (1 - red_wins)};
+            std::array<double, 2> const blue_gradient{-kSlope * (1 - blue_wins),
+                                                      -kSlope * (1 - blue_wins)};
+            double const red_slope = kSlope * red_wins * (1 - red_wins);
+            double const blue_slope = kSlope * blue_wins * (1 - blue_wins);
+            std::array<double, 2> const draw_derivative{blue_slope - red_slope,
+                                                        red_slope + blue_slope};
+
+            int const games = pairing.red_wins + pairing.blue_wins + pairing.draws;
+            std::array<double, 2> score;
+            std::array<double, 3> info{};  // xx, xd, dd
+            for (int i = 0; i < 2; ++i) {
+                score[i] =
+                    pairing.red_wins * red_gradient[i] + pairing.blue_wins * blue_gradient[i];
+            }
+            info[0] = red_wins * red_gradient[0] * red_gradient[0] +
+                      blue_wins * blue_gradient[0] * blue_gradient[0];
+            info[1] = red_wins * red_gradient[0] * red_gradient[1] +
+                      blue_wins * blue_gradient[0] * blue_gradient[1];
+            info[2] = red_wins * red_gradient[1] * red_gradient[1] +
+                      blue_wins * blue_gradient[1] * blue_gradient[1];
+            if (draws > 1e-12) {
+                for (int i = 0; i < 2; ++i) {
+                    score[i] += pairing.draws * draw_derivative[i] / draws;
+                }
+                info[0] += draw_derivative[0] * draw_derivative[0] / draws;
+                info[1] += draw_derivative[0] * draw_derivative[1] / draws;
+                info[2] += draw_derivative[1] * draw_derivative[1] / draws;
+            }
+
+            // x is red - blue + advantage, so that is where the derivatives by x go.
+            struct Term {
+                int param;
+                double by_x;
+                double by_draw;
+            };
+            std::array<Term, 4> const terms{Term{pairing.red, 1, 0}, Term{pairing.blue, -1, 0},
+                                            Term{advantage_idx, 1, 0}, Term{draw_idx, 0, 1}};
+            for (Term const& row : terms) {
+                gradient[row.param] += row.by_x * score[0] + row.by_draw * score[1];
+                for (Term const& col : terms) {
+                    information[row.param * params + col.param] +=
+                        games * (row.by_x * col.by_x * info[0] +
+                                 (row.by_x * col.by_draw + row.by_draw * col.by_x) * info[1] +
+                                 row.by_draw * col.by_draw * info[2]);
+                }
+            }
+        }
+
+        double const precision = 1 / (m_opts.prior_stddev * m_opts.prior_stddev);
+        for (int i = 0; i < players; ++i) {
+            gradient[i] -= precision * (m_elos[i] - prior_mean);
+            information[i * params + i] += precision;
+        }
+
+        for (int fixed : fixed_params) {
+            gradient[fixed] = 0;
+            for (int i = 0; i < params; ++i) {
+                information[fixed * params + i] = 0;
+                information[i * params + fixed] = 0;
+            }
+            information[fixed * params + fixed] = 1;
+        }
+        cholesky(information, params);
+    };
+
+    int iterations = 0;
+    for (;; ++iterations) {
+        evaluate();
+        if (iterations == m_opts.max_iterations) {
+            break;
+        }
+
+        std::vector<double> step = gradient;
+        cholesky_solve(information, params, step);
+        double largest = 0;
+        for (double s : step) {
+            largest = std::max(largest, std::abs(s));
+        }
+        double const scale = largest > kMaxStep ? kMaxStep / largest : 1.0;
+
+        for (int i = 0; i < players; ++i) {
+            m_elos[i] += scale * step[i];
+        }
+        m_advantage += scale * step[advantage_idx];
+        m_draw_elo += scale * step[draw_idx];
+        if (fit_draw_elo) {
+            m_draw_elo = std::max(m_draw_elo, kMinDrawElo);
+        }
+
+        if (scale * largest < m_opts.tolerance) {
+            // Leaves the information at the optimum for the intervals.
+            evaluate();
+            ++iterations;
+            break;
+        }
+    }
+
+    // The prior only pins the average rating loosely, so report the ratings relative to their mean
+    // along with the variances of those differences. Fixed ratings pin the scale instead.
+    double const mean = players > 0 && !anchored
+                            ? std::accumulate(m_elos.begin(), m_elos.end(), 0.0) / players
+                            : 0.0;
+    std::vector<std::vector<double>> covariance(players);
+    for (int i = 0; i < players; ++i) {
+        covariance[i].assign(params, 0.0);
+        covariance[i][i] = 1;
+        cholesky_solve(information, params, covariance[i]);
+    }
+    std::vector<double> row_means(players, 0.0);
+    double total_mean = 0;
+    for (int i = 0; i < players; ++i) {
+        for (int j = 0; j < players; ++j) {
+            row_means[i] += covariance[i][j] / players;
+        }
+        total_mean += row_means[i] / players;
+    }
+
+    EloRatings ratings{
+        .players = {}, .advantage = m_advantage, .draw_elo = m_draw_elo, .iterations = iterations};
+    for (int i = 0; i < players; ++i) {
+        double variance = covariance[i][i] - 2 * row_means[i] + total_mean;
+        if (anchored) {
+            variance = m_fixed[i] ? 0 : covariance[i][i];
+        }
+        double const error = m_opts.interval_stddevs * std::sqrt(std::max(0.0, variance));
+        double const elo = anchored ? m_elos[i] : m_elos[i] - mean + m_opts.offset;
+        ratings.players.push_back({.name = m_names[i],
+                                   .elo = elo,
+                                   .lower = elo - error,
+                                   .upper = elo + error,
+                                   .games = 0,
+                                   .score = 0,
+                                   .draw_rate = 0,
+                                   .opponent_elo = 0});
+    }
+
+    for (Pairing const& pairing : m_pairings) {
+        int const games = pairing.red_wins + pairing.blue_wins + pairing.draws;
+        PlayerRating& red = ratings.players[pairing.red];
+        PlayerRating& blue = ratings.players[pairing.blue];
+        red.games += games;
+        blue.games += games;
+        red.score += pairing.red_wins + 0.5 * pairing.draws;
+        blue.score += pairing.blue_wins + 0.5 * pairing.draws;
+        red.draw_rate += pairing.draws;
+        blue.draw_rate += pairing.draws;
+        red.opponent_elo += games * blue.elo;
+        blue.opponent_elo += games * red.elo;
+    }
+    for (PlayerRating& player : ratings.players) {
+        if (player.games > 0) {
+            player.score /= player.games;
+            player.draw_rate /= player.games;
+            player.opponent_elo /= player.games;
+        }
+    }
+
+    std::ranges::sort(ratings.players, std::greater{}, &PlayerRating::elo);
+    return ratings;
+}
+
+void write_ratings(EloRatings const& ratings, std::filesystem::path const& path) {
+    std::size_t name_width = 4;
+    for (PlayerRating const& player : ratings.players) {
+        name_width = std::max(name_width, player.name.size());
+    }
+
+    std::ofstream file{path};
+    if (!file) {
+        throw std::runtime_error("Could not open " + path.string() + ".");
+    }
+
+    file << std::format("{:>4} {:<{}} {:>5} {:>4} {:>4} {:>5} {:>5} {:>5} {:>5}\n", "Rank",
+                        "Name", name_width, "Elo", "+", "-", "games", "score", "oppo.", "draws");
+    int rank = 1;
+    for (PlayerRating const& player : ratings.players) {
+        file << std::format("{:>4} {:<{}} {:>5.0f} {:>4.0f} {:>4.0f} {:>5} {:>4.0f}% {:>5.0f} "
+                            "{:>4.0f}%\n",
+                            rank++, player.name, name_width, player.elo,
+                            player.upper - player.elo, player.elo - player.lower, player.games,
+                            100 * player.score, player.opponent_elo, 100 * player.draw_rate);
+    }
+}
+
+std::vector<PlayerRating> read_ratings(std::filesystem::path const& path) {
+    std::ifstream file{path};
+    if (!file) {
+        throw std::runtime_error("Could not open " + path.string() + ".");
+    }
+
+    std::vector<PlayerRating> players;
+    std::string line;
+    std::getline(file, line);  // Header
+    while (std::getline(file, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        std::istringstream stream{line};
+        PlayerRating player;
+        int rank;
+        double plus;
+        double minus;
+        char percent;
+        stream >> rank >> player.name >> player.elo >> plus >> minus >> player.games >>
+            player.score >> percent >> player.opponent_elo >> player.draw_rate >> percent;
+        if (!stream) {
+            throw std::runtime_error("Could not parse the ratings in " + path.string() + ": " +
+                                     line);
+        }
+        player.lower = player.elo - minus;
+        player.upper = player.elo + plus;
+        player.score /= 100;
+        player.draw_rate /= 100;
+        players.push_back(std::move(player));
+    }
+    return players;
+}
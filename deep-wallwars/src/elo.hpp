@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "game_recorder.hpp"
+#include "gamestate.hpp"
+
+// Elo ratings in the model of BayesElo: with a rating difference x (including the advantage of
+// Red, who moves first), Red wins with probability f(x - draw_elo), Blue wins with probability
+// f(-x - draw_elo) and the remaining probability is a draw, where f(x) = 1 / (1 + 10^(-x / 400)).
+
+struct EloOptions {
+    // Standard deviation of the Gaussian prior of each rating. It keeps the ratings of models that
+    // won (or lost) all their games finite and pins the average rating.
+    double prior_stddev = 400;
+    // Estimate the advantage of Red and the draw rate from the games, or keep them fixed.
+    bool fit_advantage = true;
+    bool fit_draw_elo = true;
+    double advantage = 0;
+    double draw_elo = 100;
+    // Confidence intervals span this many standard deviations on both sides (1.96 for 95%).
+    double interval_stddevs = 1.96;
+    // Added to all ratings, which are otherwise zero on average. Not used once a rating is fixed.
+    double offset = 0;
+
+    // Stops once no parameter changes by more than this many Elo.
+    double tolerance = 1e-4;
+    int max_iterations = 100;
+};
+
+struct PlayerRating {
+    std::string name;
+    double elo;
+    double lower;
+    double upper;
+    int games;
+    // Points per game, draws count as half a point.
+    double score;
+    double draw_rate;
+    // Average rating of the opponents, weighted by games.
+    double opponent_elo;
+};
+
+struct EloRatings {
+    // Sorted by rating, best first.
+    std::vector<PlayerRating> players;
+    double advantage;
+    double draw_elo;
+    int iterations;
+
+    // Throws if there is no player with that name.
+    PlayerRating const& at(std::string const& name) const;
+};
+
+// Maximum a posteriori ratings of a stream of games. Games are folded into counts per pairing as
+// they are added, so estimating is independent of the number of games, and every estimate starts
+// from the previous one, so that adding a few games only takes an iteration or two.
+class BayesElo {
+public:
+    explicit BayesElo(EloOptions opts = {});
+
+    void add_game(std::string const& red, std::string const& blue, Winner winner);
+    // Undecided games are not rated.
+    void add_games(std::vector<GameRecorder> const& recorders);
+
+    int rated_games() const;
+
+    // Keeps the rating of the player at `elo` instead of estimating it, e.g. for anchors whose
+    // ratings have to stay comparable to earlier estimates. Once any rating is fixed, all ratings
+    // are on the scale of the fixed ones instead of being relative to their mean, and fixed ratings
+    // have no interval.
+    void fix_rating(std::string const& name, double elo);
+
+    EloRatings estimate();
+
+private:
+    struct Pairing {
+        int red;
+        int blue;
+        int red_wins = 0;
+        int blue_wins = 0;
+        int draws = 0;
+    };
+
+    int player_index(std::string const& name);
+
+    EloOptions m_opts;
+    std::vector<std::string> m_names;
+    std::unordered_map<std::string, int> m_player_indices;
+    std::vector<Pairing> m_pairings;
+    std::unordered_map<std::uint64_t, int> m_pairing_indices;
+    int m_rated_games = 0;
+    int m_draws = 0;
+
+    std::vector<bool> m_fixed;
+
+    // The last estimate.
+    std::vector<double> m_elos;
+    double m_advantage;
+    double m_draw_elo;
+};
+
+// Writes a table in the layout of the ratings command of BayesElo, which scripts/plot_elo.py reads.
+void write_ratings(EloRatings const& ratings, std::filesystem::path const& path);
+
+// Reads a table of write_ratings back, best first. Throws if the file cannot be read or parsed.
+std::vector<PlayerRating> read_ratings(std::filesystem::path const& path);
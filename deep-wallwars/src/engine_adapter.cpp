@@ -9,6 +9,9 @@
 #include <sstream>
 #include <stdexcept>
 
+#include "batched_model_policy.hpp"
+#include "cached_policy.hpp"
+
 namespace engine_adapter {
 
 // ============================================================================
@@ -563,6 +566,15 @@ std::optional<MoveResult> find_best_move(
 // Draw Evaluation
 // ============================================================================
 
+// The model behind `eval_fn` if it is a batched model, possibly behind a cache.
+static BatchedModel* find_batched_model(EvaluationFunction const& eval_fn) {
+    auto const* policy = eval_fn.target<BatchedModelPolicy>();
+    if (auto const* cached_policy = eval_fn.target<CachedPolicy>()) {
+        policy = cached_policy->underlying_policy().target<BatchedModelPolicy>();
+    }
+    return policy ? policy->shared_batched_model().get() : nullptr;
+}
+
 bool should_accept_draw(
     Board const& board,
     Turn turn,
@@ -572,22 +584,28 @@ bool should_accept_draw(
 
     XLOGF(DBG, "Evaluating position to decide on draw offer");
 
-    // Create MCTS instance to evaluate the position
-    MCTS::Options mcts_opts;
-    mcts_opts.starting_turn = turn;
-    mcts_opts.seed = config.seed;
-    mcts_opts.max_parallelism = 4;
+    float root_value;
+    if (BatchedModel* model = find_batched_model(eval_fn)) {
+        // The value of the network is all we need, so skip the search and the policy head.
+        root_value = model->value_inference(board, turn).get();
+    } else {
+        // Create MCTS instance to evaluate the position
+        MCTS::Options mcts_opts;
+        mcts_opts.starting_turn = turn;
+        mcts_opts.seed = config.seed;
+        mcts_opts.max_parallelism = 4;
 
-    MCTS mcts(eval_fn, board, mcts_opts);
+        MCTS mcts(eval_fn, board, mcts_opts);
 
-    // Run some samples to get a position evaluation
-    // Use fewer samples than for move generation since this is just an evaluation
-    int eval_samples = std::min(config.samples / 2, 200);
+        // Run some samples to get a position evaluation
+        // Use fewer samples than for move generation since this is just an evaluation
+        int eval_samples = std::min(config.samples / 2, 200);
 
-    folly::CPUThreadPoolExecutor thread_pool(4);
-    folly::coro::blockingWait(mcts.sample(eval_samples).scheduleOn(&thread_pool));
+        folly::CPUThreadPoolExecutor thread_pool(4);
+        folly::coro::blockingWait(mcts.sample(eval_samples).scheduleOn(&thread_pool));
 
-    float root_value = mcts.root_value();
+        root_value = mcts.root_value();
+    }
 
     XLOGF(INFO, "Position evaluation: {} (from perspective of current player)", root_value);
 
@@ -1,30 +1,53 @@
+#ifdef TENSORRT_ENABLED
 #include <NvInfer.h>
 #include <NvInferRuntime.h>
+#endif
 #include <folly/logging/xlog.h>
 #include <gflags/gflags.h>
 
+#include <format>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <string>
 
 #include "batched_model.hpp"
 #include "batched_model_policy.hpp"
 #include "cached_policy.hpp"
+#include "cpu_model.hpp"
 #include "engine_adapter.hpp"
+#include "evaluation_store.hpp"
+#include "inference_executor.hpp"
 #include "simple_policy.hpp"
+#ifdef TENSORRT_ENABLED
 #include "tensorrt_model.hpp"
+#endif
 
+#ifdef TENSORRT_ENABLED
 namespace nv = nvinfer1;
+#endif
 
 // ============================================================================
 // Command-line Flags
 // ============================================================================
 
-DEFINE_string(model, "", "Path to TensorRT model file (.trt) or 'simple' for simple policy");
+DEFINE_string(model, "",
+              "Path to TensorRT model file (.trt), model run on the CPU (.onnx or .wwnet) or "
+              "'simple' for simple policy");
 DEFINE_int32(think_time, 5, "Thinking time in seconds");
 DEFINE_int32(samples, 500, "Number of MCTS samples per move (overrides think time)");
 DEFINE_uint32(seed, 42, "Random seed for MCTS");
-DEFINE_uint64(cache_size, 100'000, "Size of the MCTS evaluation cache");
+DEFINE_uint64(cache_mb, 256, "Memory budget of the MCTS evaluation cache in MiB");
+DEFINE_string(eval_store, "", "Path of the persistent evaluation store (empty to disable)");
+DEFINE_uint64(eval_store_mb, 1024, "Maximum size of the persistent evaluation store in MiB");
+DEFINE_int32(cpu_threads, 1, "Inference threads for CPU models");
+DEFINE_string(inference_cpus, "",
+              "CPUs to pin the inference threads of CPU models to, e.g. 0-7 (one thread per CPU, "
+              "overrides --cpu_threads)");
+DEFINE_int32(cpu_batch_size, 32, "Inference batch size for CPU models");
+DEFINE_string(cpu_int8_data, "",
+              "Quantize CPU models to int8, calibrated with the training data in this folder");
+DEFINE_bool(cpu_winograd, false, "Use Winograd float convolutions for CPU models");
 DEFINE_int32(model_rows, 8, "Model rows for --model=simple");
 DEFINE_int32(model_columns, 8, "Model columns for --model=simple");
 
@@ -36,6 +59,7 @@ DEFINE_double(bad_move, 0.75, "Bad move bias of simple agent");
 // TensorRT Logger
 // ============================================================================
 
+#ifdef TENSORRT_ENABLED
 struct Logger : nv::ILogger {
     void log(Severity severity, char const* msg) noexcept {
         switch (severity) {
@@ -54,24 +78,54 @@ struct Logger : nv::ILogger {
         }
     }
 };
+#endif
 
 // ============================================================================
 // Main
 // ============================================================================
 
+// Opens the persistent evaluation store if requested. Running without one is always an option, so
+// failures are logged rather than fatal.
+static std::shared_ptr<EvaluationStore> open_evaluation_store(bool boost_mouse_priors) {
+    if (FLAGS_eval_store.empty()) {
+        return nullptr;
+    }
+
+    // Stored evaluations are only valid for the settings they were computed with.
+    std::string const settings =
+        std::format("cpu_int8_data={} cpu_winograd={} boost_mouse_priors={}", FLAGS_cpu_int8_data,
+                    FLAGS_cpu_winograd, boost_mouse_priors);
+    try {
+        return std::make_shared<EvaluationStore>(
+            FLAGS_eval_store, model_identity(FLAGS_model, settings), FLAGS_eval_store_mb << 20);
+    } catch (std::exception const& e) {
+        XLOGF(WARN, "Continuing without evaluation store: {}", e.what());
+        return nullptr;
+    }
+}
+
 int main(int argc, char** argv) {
     gflags::SetUsageMessage(
         "Deep Wallwars Engine Adapter for Official Custom-Bot Client\n\n"
-        "Usage: deep_ww_engine --model <path.trt|simple> [options]\n\n"
+        "Usage: deep_ww_engine --model <path.trt|path.onnx|path.wwnet|simple> [options]\n\n"
         "This program reads a JSON request from stdin and writes a JSON response to stdout.\n"
         "It is designed to be called by the official custom-bot client.\n\n"
         "Required:\n"
-        "  --model PATH      Path to TensorRT model file (.trt) or 'simple' for simple policy\n\n"
+        "  --model PATH      Path to TensorRT model file (.trt), model run on the CPU\n"
+        "                    (.onnx or .wwnet) or 'simple' for simple policy\n\n"
         "Options:\n"
         "  --think_time N    Thinking time in seconds (default: 5)\n"
         "  --samples N       MCTS samples per move (default: 500, overrides think_time)\n"
         "  --seed N          Random seed for MCTS (default: 42)\n"
-        "  --cache_size N    MCTS evaluation cache size (default: 100000)\n\n"
+        "  --cache_mb N      MCTS evaluation cache memory budget in MiB (default: 256)\n"
+        "  --eval_store PATH Persistent evaluation store shared across runs (default: off)\n"
+        "  --eval_store_mb N Maximum size of the evaluation store in MiB (default: 1024)\n\n"
+        "  --cpu_threads N   Inference threads for CPU models (default: 1)\n"
+        "  --inference_cpus LIST  One inference thread pinned to each CPU, e.g. 0-7\n"
+        "  --cpu_batch_size N  Inference batch size for CPU models (default: 32)\n"
+        "  --cpu_int8_data DIR Quantize CPU models to int8, calibrated with training data\n"
+        "                      from DIR (default: off)\n"
+        "  --cpu_winograd    Winograd float convolutions for CPU models (default: off)\n"
         "Simple Policy Options (when --model=simple):\n"
         "  --move_prior N    Likelihood of choosing a pawn move (default: 0.3)\n"
         "  --good_move N     Bias for pawn moves closer to goal (default: 1.5)\n"
@@ -95,62 +149,82 @@ int main(int argc, char** argv) {
             XLOG(INFO, "Using simple policy");
             eval_fn = SimplePolicy(FLAGS_move_prior, FLAGS_good_move, FLAGS_bad_move);
         } else {
-            // Create TensorRT runtime only when needed
-            Logger logger;
-            std::unique_ptr<nv::IRuntime> runtime{nv::createInferRuntime(logger)};
-
-            if (!runtime) {
-                XLOG(ERR, "Failed to create TensorRT runtime");
-                std::cerr << "Error: Failed to create TensorRT runtime. "
-                          << "CUDA may not be available or out of memory.\n";
-                return 1;
-            }
-
             if (FLAGS_model.empty()) {
                 XLOG(ERR, "Error: --model flag is required");
                 std::cerr << "Error: --model flag is required (path to .trt file or 'simple')\n";
                 return 1;
             }
 
-            // Load TensorRT model
-            std::ifstream model_file(FLAGS_model, std::ios::binary);
-            if (!model_file) {
-                XLOGF(ERR, "Failed to open model file: {}", FLAGS_model);
-                std::cerr << "Error: Failed to open model file: " << FLAGS_model << "\n";
-                return 1;
-            }
-
-            XLOGF(INFO, "Loading TensorRT engine from: {}", FLAGS_model);
-
-            std::shared_ptr<nv::ICudaEngine> engine;
-            try {
-                engine = load_serialized_engine(*runtime, model_file);
-            } catch (std::exception const& e) {
-                XLOGF(ERR, "Failed to load TensorRT engine: {}", e.what());
-                std::cerr << "Error: Failed to load TensorRT engine: " << e.what() << "\n";
-                return 1;
-            }
-
-            if (!engine) {
-                XLOG(ERR, "Failed to load TensorRT engine");
-                std::cerr << "Error: Failed to load TensorRT engine\n";
+            std::vector<std::unique_ptr<Model>> models;
+            if (is_cpu_model(FLAGS_model)) {
+                // CPU models need no TensorRT runtime.
+                auto cpu_model = load_cpu_resnet(
+                    FLAGS_model, FLAGS_cpu_batch_size,
+                    make_inference_executor(FLAGS_cpu_threads, FLAGS_inference_cpus),
+                    FLAGS_cpu_int8_data,
+                    FLAGS_cpu_winograd ? ConvAlgorithm::Winograd : ConvAlgorithm::Direct);
+                model_rows = cpu_model->rows();
+                model_columns = cpu_model->columns();
+                models.push_back(std::move(cpu_model));
+            } else {
+#ifdef TENSORRT_ENABLED
+                // Create TensorRT runtime
+                Logger logger;
+                std::unique_ptr<nv::IRuntime> runtime{nv::createInferRuntime(logger)};
+
+                if (!runtime) {
+                    XLOG(ERR, "Failed to create TensorRT runtime");
+                    std::cerr << "Error: Failed to create TensorRT runtime. "
+                              << "CUDA may not be available or out of memory.\n";
+                    return 1;
+                }
+
+                // Load TensorRT model
+                std::ifstream model_file(FLAGS_model, std::ios::binary);
+                if (!model_file) {
+                    XLOGF(ERR, "Failed to open model file: {}", FLAGS_model);
+                    std::cerr << "Error: Failed to open model file: " << FLAGS_model << "\n";
+                    return 1;
+                }
+
+                XLOGF(INFO, "Loading TensorRT engine from: {}", FLAGS_model);
+
+                std::shared_ptr<nv::ICudaEngine> engine;
+                try {
+                    engine = load_serialized_engine(*runtime, model_file);
+                } catch (std::exception const& e) {
+                    XLOGF(ERR, "Failed to load TensorRT engine: {}", e.what());
+                    std::cerr << "Error: Failed to load TensorRT engine: " << e.what() << "\n";
+                    return 1;
+                }
+
+                if (!engine) {
+                    XLOG(ERR, "Failed to load TensorRT engine");
+                    std::cerr << "Error: Failed to load TensorRT engine\n";
+                    return 1;
+                }
+
+                auto tensor_model = std::make_unique<TensorRTModel>(engine);
+                model_rows = tensor_model->rows();
+                model_columns = tensor_model->columns();
+                models.push_back(std::move(tensor_model));
+#else
+                XLOGF(ERR, "Cannot load {}: built without TensorRT", FLAGS_model);
+                std::cerr << "Error: This build has no TensorRT support. Pass an .onnx or .wwnet "
+                          << "model to run it on the CPU.\n";
                 return 1;
+#endif
             }
 
-            // Create model (single instance for engine mode)
-            std::vector<std::unique_ptr<Model>> models;
-            auto tensor_model = std::make_unique<TensorRTModel>(engine);
-            model_rows = tensor_model->rows();
-            model_columns = tensor_model->columns();
-            models.push_back(std::move(tensor_model));
-
             constexpr int kBatchedModelQueueSize = 4096;
             auto batched_model = std::make_shared<BatchedModel>(
                 std::move(models),
                 kBatchedModelQueueSize);
 
-            BatchedModelPolicy batched_model_policy(std::move(batched_model));
-            eval_fn = CachedPolicy(std::move(batched_model_policy), FLAGS_cache_size);
+            constexpr bool kBoostMousePriors = false;
+            BatchedModelPolicy batched_model_policy(std::move(batched_model), kBoostMousePriors);
+            eval_fn = CachedPolicy(std::move(batched_model_policy), FLAGS_cache_mb << 20,
+                                   open_evaluation_store(kBoostMousePriors));
         }
 
         // Set up engine config
@@ -0,0 +1,172 @@
+#include "evaluation_cache.hpp"
+
+#include <folly/Hash.h>
+
+#include <algorithm>
+#include <bit>
+#include <memory>
+
+// Number of consecutive slots a position may occupy.
+constexpr std::size_t kProbeWindow = 8;
+// Used to size the table. A little below the size of a typical 8x8 entry, so the table has plenty
+// of free slots before the byte budget kicks in.
+constexpr std::size_t kExpectedEntryBytes = 512;
+
+std::size_t folly::HeterogeneousAccessHash<CacheEntry>::operator()(
+    CacheEntry const& cache_entry) const {
+    return operator()(
+        CacheEntryView{cache_entry.board, cache_entry.turn, cache_entry.previous_position});
+}
+
+std::size_t folly::HeterogeneousAccessHash<CacheEntry>::operator()(CacheEntryView ce_view) const {
+    auto hash = folly::hash::hash_combine(ce_view.board, ce_view.turn.action, ce_view.turn.player);
+    if (ce_view.previous_position) {
+        hash = folly::hash::hash_combine(hash, ce_view.previous_position->pawn,
+                                         ce_view.previous_position->cell);
+    }
+    return hash;
+}
+
+bool folly::HeterogeneousAccessEqualTo<CacheEntry>::operator()(CacheEntry const& lhs,
+                                                               CacheEntry const& rhs) const {
+    return operator()(CacheEntryView{lhs.board, lhs.turn, lhs.previous_position}, rhs);
+}
+
+bool folly::HeterogeneousAccessEqualTo<CacheEntry>::operator()(CacheEntryView lhs,
+                                                               CacheEntry const& rhs) const {
+    if (lhs.turn != rhs.turn) {
+        return false;
+    }
+
+    if (lhs.turn.player != rhs.turn.player) {
+        return false;
+    }
+
+    if (lhs.previous_position != rhs.previous_position) {
+        return false;
+    }
+
+    return lhs.board == rhs.board;
+}
+
+bool folly::HeterogeneousAccessEqualTo<CacheEntry>::operator()(CacheEntry const& lhs,
+                                                               CacheEntryView rhs) const {
+    return operator()(rhs, lhs);
+}
+
+EvaluationCache::EvaluationCache(std::size_t capacity_bytes)
+    : m_capacity_bytes{capacity_bytes},
+      m_mask{std::bit_ceil(std::max(kProbeWindow, capacity_bytes / kExpectedEntryBytes)) - 1},
+      m_slots{std::make_unique<std::atomic<Node*>[]>(m_mask + 1)} {}
+
+EvaluationCache::~EvaluationCache() {
+    // Nobody can be reading anymore, so there is no need to go through retire().
+    for (std::size_t i = 0; i <= m_mask; ++i) {
+        delete m_slots[i].load();
+    }
+}
+
+std::uint64_t EvaluationCache::hash(CacheEntryView key) {
+    return folly::HeterogeneousAccessHash<CacheEntry>{}(key);
+}
+
+std::optional<Evaluation> EvaluationCache::find(CacheEntryView key, std::uint64_t hash) const {
+    auto holder = folly::make_hazard_pointer<>();
+
+    for (std::size_t i = 0; i < kProbeWindow; ++i) {
+        Node const* node = holder.protect(m_slots[(hash + i) & m_mask]);
+        if (!node || node->hash != hash ||
+            !folly::HeterogeneousAccessEqualTo<CacheEntry>{}(key, node->key)) {
+            continue;
+        }
+
+        // Avoid dirtying the cache line if the bit is already set, which it usually is for hot
+        // entries.
+        if (!node->referenced.load(std::memory_order_relaxed)) {
+            node->referenced.store(true, std::memory_order_relaxed);
+        }
+        return Evaluation{node->evaluation->value(), {}, node->evaluation};
+    }
+
+    return std::nullopt;
+}
+
+void EvaluationCache::insert(CacheEntry key, std::uint64_t hash,
+                             CompactEvaluation::Ref evaluation) {
+    std::size_t const bytes =
+        sizeof(Node) + key.board.columns() * key.board.rows() + evaluation->bytes();
+    std::unique_ptr<Node> node{new Node{{}, hash, std::move(key), std::move(evaluation), bytes}};
+
+    auto holder = folly::make_hazard_pointer<>();
+    std::atomic<Node*>* victim_slot = &m_slots[hash & m_mask];
+    Node* victim = nullptr;
+
+    for (std::size_t i = 0; i < kProbeWindow; ++i) {
+        std::atomic<Node*>& slot = m_slots[(hash + i) & m_mask];
+        Node* existing = holder.protect(slot);
+
+        if (!existing) {
+            if (slot.compare_exchange_strong(existing, node.get())) {
+                m_bytes += node.release()->bytes;
+                evict_over_budget();
+                return;
+            }
+            continue;
+        }
+
+        if (existing->hash == hash &&
+            folly::HeterogeneousAccessEqualTo<CacheEntry>{}(node->key, existing->key)) {
+            // Somebody else evaluated the same position concurrently.
+            return;
+        }
+
+        // Second chance: the first unreferenced node in the window is replaced.
+        if (!victim && !existing->referenced.exchange(false, std::memory_order_relaxed)) {
+            victim_slot = &slot;
+            victim = existing;
+        }
+    }
+
+    if (!victim) {
+        victim = holder.protect(*victim_slot);
+    }
+
+    if (victim && victim_slot->compare_exchange_strong(victim, node.get())) {
+        // We unlinked the victim, so we are the only ones that will retire it.
+        m_bytes += node.release()->bytes;
+        m_bytes -= victim->bytes;
+        victim->retire();
+        evict_over_budget();
+    }
+}
+
+void EvaluationCache::evict_over_budget() {
+    auto holder = folly::make_hazard_pointer<>();
+
+    auto over_budget = [&] {
+        return m_bytes.load(std::memory_order_relaxed) > std::int64_t(m_capacity_bytes);
+    };
+
+    // Bounded so we cannot spin forever if everything keeps getting referenced.
+    for (std::size_t steps = 0; steps < 2 * (m_mask + 1) && over_budget(); ++steps) {
+        std::atomic<Node*>& slot =
+            m_slots[m_clock_hand.fetch_add(1, std::memory_order_relaxed) & m_mask];
+        Node* node = holder.protect(slot);
+        if (!node || node->referenced.exchange(false, std::memory_order_relaxed)) {
+            continue;
+        }
+
+        if (slot.compare_exchange_strong(node, nullptr)) {
+            m_bytes -= node->bytes;
+            node->retire();
+        }
+    }
+}
+
+std::size_t EvaluationCache::size_bytes() const {
+    return std::max(m_bytes.load(), std::int64_t{0});
+}
+
+std::size_t EvaluationCache::capacity_bytes() const {
+    return m_capacity_bytes;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <folly/container/HeterogeneousAccess.h>
+#include <folly/synchronization/Hazptr.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "mcts.hpp"
+
+struct CacheEntry {
+    Board board;
+    Turn turn;
+    std::optional<PreviousPosition> previous_position;
+};
+
+struct CacheEntryView {
+    Board const& board;
+    Turn const& turn;
+    std::optional<PreviousPosition> const& previous_position;
+};
+
+template <>
+struct folly::HeterogeneousAccessHash<CacheEntry> {
+    using is_transparent = void;
+    using folly_is_avalanching = std::true_type;
+
+    std::uint64_t operator()(CacheEntry const& cache_entry) const;
+    std::uint64_t operator()(CacheEntryView ce_view) const;
+};
+
+template <>
+struct folly::HeterogeneousAccessEqualTo<CacheEntry> {
+    using is_transparent = void;
+
+    bool operator()(CacheEntry const& lhs, CacheEntry const& rhs) const;
+    bool operator()(CacheEntry const& lhs, CacheEntryView rhs) const;
+    bool operator()(CacheEntryView lhs, CacheEntry const& rhs) const;
+};
+
+// Concurrent cache of evaluations with a memory budget in bytes.
+//
+// Open addressing table where each position hashes to a small window of slots. Lookups never take
+// a lock: they protect the node in each slot with a hazard pointer and verify the full key. Every
+// node has a reference bit that lookups set, which gives evicted nodes a second chance (CLOCK).
+// Inserts replace an unreferenced node in the window if it is full, and a global clock hand evicts
+// nodes until the cache is back within its budget.
+//
+// Hashes are passed in by the caller so that a lookup followed by an insert only computes it once.
+class EvaluationCache {
+public:
+    explicit EvaluationCache(std::size_t capacity_bytes);
+    ~EvaluationCache();
+
+    EvaluationCache(EvaluationCache const& other) = delete;
+    EvaluationCache& operator=(EvaluationCache const& other) = delete;
+
+    static std::uint64_t hash(CacheEntryView key);
+
+    // Hits only hand out a reference to the compact evaluation.
+    std::optional<Evaluation> find(CacheEntryView key, std::uint64_t hash) const;
+    // Best effort: may drop the evaluation if the window is contended.
+    void insert(CacheEntry key, std::uint64_t hash, CompactEvaluation::Ref evaluation);
+
+    std::size_t size_bytes() const;
+    std::size_t capacity_bytes() const;
+
+private:
+    struct Node : folly::hazptr_obj_base<Node> {
+        std::uint64_t hash;
+        CacheEntry key;
+        CompactEvaluation::Ref evaluation;
+        std::size_t bytes;
+        mutable std::atomic<bool> referenced = false;
+    };
+
+    std::size_t m_capacity_bytes;
+    std::size_t m_mask;
+    std::unique_ptr<std::atomic<Node*>[]> m_slots;
+
+    // Signed since concurrent inserts and evictions may briefly drive it below zero.
+    std::atomic<std::int64_t> m_bytes = 0;
+    std::atomic<std::size_t> m_clock_hand = 0;
+
+    void evict_over_budget();
+};
@@ -0,0 +1,428 @@
+#include "evaluation_store.hpp"
+
+#include <fcntl.h>
+#include <folly/hash/Checksum.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <folly/logging/xlog.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+constexpr char kMagic[8] = {'W', 'W', 'E', 'V', 'A', 'L', '0', '1'};
+constexpr std::size_t kPendingRecords = 4096;
+constexpr std::size_t kRecordAlignment = 8;
+// Readers look for new records of the writer at most this often.
+constexpr std::int64_t kCatchUpIntervalUs = 10'000;
+constexpr std::size_t kIdentityChunkBytes = 1 << 20;
+
+struct FileHeader {
+    char magic[8];
+    std::uint64_t model_id;
+};
+
+struct RecordHeader {
+    // crc32c of the record after this field.
+    std::uint32_t checksum;
+    // Size of the whole record including this header and padding.
+    std::uint32_t size;
+    std::uint64_t hash;
+    float value;
+    std::uint16_t key_size;
+    std::uint16_t num_edges;
+};
+
+static_assert(sizeof(RecordHeader) == 24);
+
+// The record is followed by the key, the encoded actions and the encoded priors.
+static std::size_t record_size(std::size_t key_size, std::size_t num_edges) {
+    std::size_t const size =
+        sizeof(RecordHeader) + key_size + 2 * sizeof(std::uint16_t) * num_edges;
+    return (size + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+}
+
+static std::uint32_t record_checksum(char const* record, std::size_t size) {
+    auto const* bytes = reinterpret_cast<std::uint8_t const*>(record);
+    return folly::crc32c(bytes + sizeof(std::uint32_t), size - sizeof(std::uint32_t));
+}
+
+// Canonical byte representation of a position. Stored with every record to verify that it really
+// is for the position we are looking for, and not just for one with the same hash.
+static std::string serialize_key(CacheEntryView key) {
+    Board const& board = key.board;
+    std::string bytes;
+
+    auto push = [&](int value) { bytes.push_back(char(value)); };
+    auto push_cell = [&](Cell cell) {
+        push(cell.column);
+        push(cell.row);
+    };
+
+    push(board.columns());
+    push(board.rows());
+    push(int(board.variant()));
+    for (Player player : {Player::Red, Player::Blue}) {
+        push_cell(board.position(player));
+        push_cell(board.mouse(player));
+    }
+
+    push(int(key.turn.player));
+    push(int(key.turn.action));
+    if (key.previous_position) {
+        push(1 + int(key.previous_position->pawn));
+        push_cell(key.previous_position->cell);
+    } else {
+        push(0);
+    }
+
+    // Two bits per wall: none, red or blue.
+    auto wall_bits = [&](Wall wall) {
+        auto const owner = board.wall_owner(wall);
+        return owner ? 1 + int(*owner) : 0;
+    };
+
+    for (int i = 0; i < board.columns() * board.rows(); ++i) {
+        Cell const cell = board.cell_at_index(i);
+        push(wall_bits(Wall{cell, Wall::Right}) | wall_bits(Wall{cell, Wall::Down}) << 2);
+    }
+
+    return bytes;
+}
+
+static bool write_all(int fd, std::string const& bytes, std::uint64_t offset) {
+    std::size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t const result =
+            ::pwrite(fd, bytes.data() + written, bytes.size() - written, offset + written);
+        if (result <= 0) {
+            return false;
+        }
+        written += result;
+    }
+    return true;
+}
+
+// Opens the store and tries to become its writer. A writer that replaced the file may have renamed
+// a new one over it between our open and our lock, in which case we have to open that one instead.
+static int open_store(std::filesystem::path const& path, bool& locked) {
+    while (true) {
+        int const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            // A store we may not write to can still be read.
+            locked = false;
+            return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+
+        // The lock is released when we close the file (or die).
+        locked = ::flock(fd, LOCK_EX | LOCK_NB) == 0;
+
+        struct stat file_stat;
+        struct stat path_stat;
+        if (!locked || ::fstat(fd, &file_stat) != 0 || ::stat(path.c_str(), &path_stat) != 0 ||
+            (file_stat.st_dev == path_stat.st_dev && file_stat.st_ino == path_stat.st_ino)) {
+            return fd;
+        }
+        ::close(fd);
+    }
+}
+
+EvaluationStore::EvaluationStore(std::filesystem::path const& path, std::uint64_t model_id,
+                                 std::size_t max_bytes)
+    : m_model_id{model_id},
+      m_max_bytes{max_bytes},
+      m_index{std::in_place, Index{{}, sizeof(FileHeader)}},
+      m_pending(kPendingRecords) {
+    m_fd = open_store(path, m_writable);
+    if (m_fd < 0) {
+        throw std::runtime_error("Failed to open evaluation store " + path.string());
+    }
+
+    auto fail = [&](std::string const& reason) {
+        ::close(m_fd);
+        throw std::runtime_error("Evaluation store " + path.string() + ": " + reason);
+    };
+
+    struct stat file_stat;
+    if (::fstat(m_fd, &file_stat) != 0) {
+        fail("fstat failed");
+    }
+
+    FileHeader header;
+    bool const has_header = file_stat.st_size >= std::int64_t(sizeof(header)) &&
+                            ::pread(m_fd, &header, sizeof(header), 0) == sizeof(header);
+    bool const valid_header = has_header &&
+                              std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                              header.model_id == m_model_id;
+
+    if (m_writable && !valid_header) {
+        if (file_stat.st_size > 0) {
+            XLOGF(WARN, "Replacing evaluation store {} which belongs to another model",
+                  path.string());
+        }
+
+        // Readers may have the old file mapped, so it must not be truncated under them.
+        auto const temp_path = path.string() + "." + std::to_string(::getpid()) + ".tmp";
+        int const fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.model_id = m_model_id;
+        bool const replaced =
+            fd >= 0 && ::flock(fd, LOCK_EX | LOCK_NB) == 0 &&
+            write_all(fd, std::string(reinterpret_cast<char const*>(&header), sizeof(header)),
+                      0) &&
+            ::rename(temp_path.c_str(), path.c_str()) == 0;
+        if (!replaced) {
+            if (fd >= 0) {
+                ::close(fd);
+                ::unlink(temp_path.c_str());
+            }
+            fail("failed to write a new store");
+        }
+
+        ::close(m_fd);
+        m_fd = fd;
+        file_stat.st_size = sizeof(header);
+    } else if (!m_writable && has_header && !valid_header) {
+        fail("belongs to another model");
+    }
+
+    // The mapping covers the size limit and therefore usually extends past the end of the file.
+    // Touching a page past the end raises SIGBUS, so every access must stay below a size that
+    // fstat reported (the scan limit, and the index end derived from it). Since the file never
+    // shrinks (see the class comment), such offsets stay valid.
+    void* data = ::mmap(nullptr, m_max_bytes, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED) {
+        fail("mmap failed");
+    }
+    m_data = static_cast<char const*>(data);
+
+    if (!m_writable) {
+        catch_up();
+        XLOGF(INFO, "Opened evaluation store {} read-only with {} evaluations", path.string(),
+              size());
+        return;
+    }
+
+    // A torn append at the end is simply overwritten by the next one.
+    m_index.withWLock([&](Index& index) {
+        index.header_checked = true;
+        scan(index, file_stat.st_size);
+    });
+
+    XLOGF(INFO, "Opened evaluation store {} with {} evaluations", path.string(), size());
+    m_writer = std::jthread{[this] { run_writer(); }};
+}
+
+EvaluationStore::~EvaluationStore() {
+    if (m_writer.joinable()) {
+        // Sentinel after all pending records, so those are still written.
+        m_pending.blockingWrite(PendingRecord{});
+        m_writer.join();
+    }
+
+    ::munmap(const_cast<char*>(m_data), m_max_bytes);
+    ::close(m_fd);
+}
+
+std::optional<CompactEvaluation::Ref> EvaluationStore::find(CacheEntryView key,
+                                                            std::uint64_t hash) {
+    auto lookup = [&]() -> std::optional<std::uint64_t> {
+        auto index = m_index.rlock();
+        auto it = index->offsets.find(hash);
+        if (it == index->offsets.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    };
+
+    auto offset = lookup();
+    if (!offset && !m_writable) {
+        catch_up();
+        offset = lookup();
+    }
+
+    if (!offset) {
+        return std::nullopt;
+    }
+
+    char const* record = m_data + *offset;
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+
+    std::string const key_bytes = serialize_key(key);
+    char const* stored_key = record + sizeof(header);
+    if (header.key_size != key_bytes.size() ||
+        std::memcmp(stored_key, key_bytes.data(), key_bytes.size()) != 0) {
+        return std::nullopt;
+    }
+
+    // The arrays are not necessarily aligned, so they are copied out.
+    std::vector<std::uint16_t> actions(header.num_edges);
+    std::vector<std::uint16_t> priors(header.num_edges);
+    std::size_t const array_bytes = sizeof(std::uint16_t) * header.num_edges;
+    std::memcpy(actions.data(), stored_key + header.key_size, array_bytes);
+    std::memcpy(priors.data(), stored_key + header.key_size + array_bytes, array_bytes);
+
+    return CompactEvaluation::make(header.value, actions, priors);
+}
+
+void EvaluationStore::append(CacheEntryView key, std::uint64_t hash,
+                             CompactEvaluation::Ref evaluation) {
+    if (!m_writable) {
+        return;
+    }
+
+    std::string const key_bytes = serialize_key(key);
+    auto const actions = evaluation->encoded_actions();
+    auto const priors = evaluation->encoded_priors();
+
+    RecordHeader header{0,
+                        std::uint32_t(record_size(key_bytes.size(), actions.size())),
+                        hash,
+                        evaluation->value(),
+                        std::uint16_t(key_bytes.size()),
+                        std::uint16_t(actions.size())};
+
+    std::string bytes(header.size, '\0');
+    char* out = bytes.data() + sizeof(header);
+    out = std::copy(key_bytes.begin(), key_bytes.end(), out);
+    std::memcpy(out, actions.data(), actions.size_bytes());
+    std::memcpy(out + actions.size_bytes(), priors.data(), priors.size_bytes());
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    header.checksum = record_checksum(bytes.data(), bytes.size());
+    std::memcpy(bytes.data(), &header.checksum, sizeof(header.checksum));
+
+    // Write-behind is best effort: if the writer cannot keep up, the evaluation is dropped.
+    m_pending.write(PendingRecord{hash, std::move(bytes)});
+}
+
+bool EvaluationStore::writable() const {
+    return m_writable;
+}
+
+std::size_t EvaluationStore::size_bytes() const {
+    return m_index.rlock()->end;
+}
+
+std::size_t EvaluationStore::size() const {
+    return m_index.rlock()->offsets.size();
+}
+
+void EvaluationStore::scan(Index& index, std::uint64_t file_size) const {
+    std::uint64_t const limit = std::min<std::uint64_t>(file_size, m_max_bytes);
+
+    while (index.end + sizeof(RecordHeader) <= limit) {
+        char const* record = m_data + index.end;
+        RecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+
+        if (header.size != record_size(header.key_size, header.num_edges) ||
+            index.end + header.size > limit ||
+            header.checksum != record_checksum(record, header.size)) {
+            break;
+        }
+
+        index.offsets[header.hash] = index.end;
+        index.end += header.size;
+    }
+}
+
+void EvaluationStore::catch_up() {
+    // Readers miss all the time, so checking the file size on every miss would be a syscall each.
+    auto const now = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+    auto due = m_next_catch_up_us.load(std::memory_order_relaxed);
+    if (now < due || !m_next_catch_up_us.compare_exchange_strong(
+                         due, now + kCatchUpIntervalUs, std::memory_order_relaxed)) {
+        return;
+    }
+
+    struct stat file_stat;
+    if (::fstat(m_fd, &file_stat) != 0 ||
+        std::uint64_t(file_stat.st_size) <= m_index.rlock()->end) {
+        return;
+    }
+
+    m_index.withWLock([&](Index& index) {
+        if (index.foreign) {
+            return;
+        }
+
+        if (!index.header_checked) {
+            FileHeader header;
+            std::memcpy(&header, m_data, sizeof(header));
+            if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+                header.model_id != m_model_id) {
+                XLOG(WARN, "Evaluation store belongs to another model, no longer reading it");
+                index.foreign = true;
+                return;
+            }
+            index.header_checked = true;
+        }
+
+        scan(index, file_stat.st_size);
+    });
+}
+
+void EvaluationStore::run_writer() {
+    bool full = false;
+
+    while (true) {
+        PendingRecord record;
+        m_pending.blockingRead(record);
+        if (record.bytes.empty()) {
+            return;
+        }
+
+        // We are the only ones moving the end in a writable store.
+        std::uint64_t const offset = m_index.rlock()->end;
+        if (offset + record.bytes.size() > m_max_bytes) {
+            if (!full) {
+                XLOG(WARN, "Evaluation store is full, no longer adding evaluations");
+                full = true;
+            }
+            continue;
+        }
+
+        if (!write_all(m_fd, record.bytes, offset)) {
+            XLOG(ERR, "Failed to append to evaluation store");
+            continue;
+        }
+
+        m_index.withWLock([&](Index& index) {
+            index.offsets[record.hash] = offset;
+            index.end = offset + record.bytes.size();
+        });
+    }
+}
+
+std::uint64_t model_identity(std::filesystem::path const& model_file, std::string_view settings) {
+    std::ifstream file{model_file, std::ios::binary};
+    if (!file) {
+        throw std::runtime_error("Failed to open model file " + model_file.string());
+    }
+
+    // Hashed in chunks so that large models are never held in memory twice.
+    folly::hash::SpookyHashV2 hasher;
+    hasher.Init(0, 0);
+    std::vector<char> chunk(kIdentityChunkBytes);
+    while (file.read(chunk.data(), chunk.size()) || file.gcount() > 0) {
+        hasher.Update(chunk.data(), file.gcount());
+    }
+    if (file.bad()) {
+        throw std::runtime_error("Failed to read model file " + model_file.string());
+    }
+    hasher.Update(settings.data(), settings.size());
+
+    std::uint64_t hash1;
+    std::uint64_t hash2;
+    hasher.Final(&hash1, &hash2);
+    return hash1;
+}
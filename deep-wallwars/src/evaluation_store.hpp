@@ -0,0 +1,84 @@
+#pragma once
+
+#include <folly/MPMCQueue.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "compact_evaluation.hpp"
+#include "evaluation_cache.hpp"
+
+// Persistent evaluation store that outlives the process, so restarted (or short-lived) engines do
+// not have to re-infer every opening position.
+//
+// The file is an append-only log of checksummed records behind a header with the model identity.
+// It is memory mapped for lookups. On open, the records are scanned to build an in-memory index
+// from position hash to offset, which stops at the first damaged record. A torn append after a
+// crash therefore just loses that record.
+//
+// Only one process at a time (the first to take the file lock) writes. Everyone else shares the
+// file read-only and picks up new records as they miss (at most every few milliseconds). Writes are
+// queued and performed by a background thread, so appending never blocks the search. Once the file
+// reaches its size limit, new evaluations are dropped.
+//
+// The file never shrinks while it is shared. A writer for a different model writes a new file and
+// renames it over the old one, so readers of the old store keep their (now unlinked) file.
+class EvaluationStore {
+public:
+    // Throws if the store cannot be opened, or if it is read-only and belongs to a different model.
+    EvaluationStore(std::filesystem::path const& path, std::uint64_t model_id,
+                    std::size_t max_bytes);
+    ~EvaluationStore();
+
+    EvaluationStore(EvaluationStore const& other) = delete;
+    EvaluationStore& operator=(EvaluationStore const& other) = delete;
+
+    std::optional<CompactEvaluation::Ref> find(CacheEntryView key, std::uint64_t hash);
+    void append(CacheEntryView key, std::uint64_t hash, CompactEvaluation::Ref evaluation);
+
+    bool writable() const;
+    std::size_t size_bytes() const;
+    std::size_t size() const;
+
+private:
+    struct Index {
+        folly::F14FastMap<std::uint64_t, std::uint64_t> offsets;
+        // End of the last valid record.
+        std::uint64_t end;
+        // Readers may open the file before its header is written, so they check it on catch-up.
+        bool header_checked = false;
+        bool foreign = false;
+    };
+
+    struct PendingRecord {
+        std::uint64_t hash;
+        // The complete serialized record. Empty to stop the writer.
+        std::string bytes;
+    };
+
+    std::uint64_t m_model_id;
+    std::size_t m_max_bytes;
+    int m_fd = -1;
+    bool m_writable = false;
+    char const* m_data = nullptr;
+
+    folly::Synchronized<Index> m_index;
+    std::atomic<std::int64_t> m_next_catch_up_us{0};
+    folly::MPMCQueue<PendingRecord> m_pending;
+    std::jthread m_writer;
+
+    void scan(Index& index, std::uint64_t file_size) const;
+    void catch_up();
+    void run_writer();
+};
+
+// Identifies a model by the contents of its file and by `settings`, which must describe any options
+// that change its evaluations (such as quantization).
+std::uint64_t model_identity(std::filesystem::path const& model_file, std::string_view settings);
@@ -1,6 +1,33 @@
 #include "game_recorder.hpp"
 
+#include <nlohmann/json.hpp>
+
+#include <fstream>
 #include <sstream>
+#include <stdexcept>
+
+// Results in the notation of PGN.
+static char const* result_notation(Winner winner) {
+    switch (winner) {
+        case Winner::Red:
+            return "1-0";
+        case Winner::Blue:
+            return "0-1";
+        case Winner::Draw:
+            return "1/2-1/2";
+        default:
+            return "*";
+    }
+}
+
+static Winner parse_result(std::string const& result) {
+    for (Winner winner : {Winner::Red, Winner::Blue, Winner::Draw}) {
+        if (result == result_notation(winner)) {
+            return winner;
+        }
+    }
+    return Winner::Undecided;
+}
 
 GameRecorder::GameRecorder(Board initial_board, std::string red_name, std::string blue_name)
     : m_red_name{red_name},
@@ -32,6 +59,10 @@ Winner GameRecorder::winner() const {
     return m_outcome;
 }
 
+std::vector<Board> const& GameRecorder::board_states() const {
+    return m_board_states;
+}
+
 std::string GameRecorder::to_json() const {
     std::stringstream result;
 
@@ -54,32 +85,7 @@ std::string GameRecorder::to_json() const {
         }
     }
 
-    result << "\"}";
-    return result.str();
-}
-
-std::string GameRecorder::to_pgn() const {
-    std::stringstream result;
-
-    result << "[White \"" << m_red_name << "\"][Black \"" << m_blue_name << "\"][Result \"";
-
-    switch (m_outcome) {
-        case Winner::Red:
-            result << "1-0";
-            break;
-        case Winner::Blue:
-            result << "0-1";
-            break;
-        case Winner::Draw:
-            result << "1/2-1/2";
-            break;
-        default:
-            result << "*";
-    }
-
-    // Yes, a random chess opening...
-    result << "\"] 1. c4 Nf6";
-
+    result << "\", \"result\": \"" << result_notation(m_outcome) << "\"}";
     return result.str();
 }
 
@@ -123,12 +129,21 @@ std::string all_to_json(std::vector<GameRecorder> const& recorders) {
     return result;
 }
 
-std::string all_to_pgn(std::vector<GameRecorder> const& recorders) {
-    std::string result;
-
-    for (GameRecorder const& recorder : recorders) {
-        result += recorder.to_pgn() + "\n";
+std::vector<GameOutcome> read_game_outcomes(std::filesystem::path const& path) {
+    std::ifstream file{path};
+    if (!file) {
+        throw std::runtime_error("Could not open " + path.string() + ".");
     }
 
-    return result;
+    std::vector<GameOutcome> outcomes;
+    for (std::string line; std::getline(file, line);) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        auto const game = nlohmann::json::parse(line);
+        outcomes.push_back({.red = game.at("creator").get<std::string>(),
+                            .blue = game.at("joiner").get<std::string>(),
+                            .winner = parse_result(game.value("result", "*"))});
+    }
+    return outcomes;
 }
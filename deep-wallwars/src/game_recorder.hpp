@@ -1,5 +1,6 @@
 #pragma once
 
+#include <filesystem>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -16,14 +17,12 @@ public:
     std::string const& red() const;
     std::string const& blue() const;
     Winner winner() const;
+    // The initial board followed by the board after every move. Red moves first.
+    std::vector<Board> const& board_states() const;
 
-    // This is for wallwars.net.
+    // This is for wallwars.net. One line of JSON with the result in the notation of PGN.
     std::string to_json() const;
 
-    // This is for bayeselo. PGN is a chess format and we do not really try to implement it
-    // correctly, this is just the minimal output that is parsed by bayeselo.
-    std::string to_pgn() const;
-
 private:
     std::string m_red_name;
     std::string m_blue_name;
@@ -43,4 +42,13 @@ std::unordered_map<std::string, GameResults> tally_results(
     std::vector<GameRecorder> const& recorders);
 
 std::string all_to_json(std::vector<GameRecorder> const& recorders);
-std::string all_to_pgn(std::vector<GameRecorder> const& recorders);
+
+struct GameOutcome {
+    std::string red;
+    std::string blue;
+    Winner winner;
+};
+
+// Reads who played whom from a file of all_to_json. Games written before the result was part of
+// the JSON are undecided.
+std::vector<GameOutcome> read_game_outcomes(std::filesystem::path const& path);
@@ -0,0 +1,62 @@
+#include "host_buffer.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+void* AlignedHostAllocator::allocate(std::size_t bytes) {
+    std::size_t const alignment = bytes >= kHugePageSize ? kHugePageSize : kAlignment;
+    // aligned_alloc wants a multiple of the alignment, and some memory even for empty buffers.
+    std::size_t const size =
+        std::max<std::size_t>(1, (bytes + alignment - 1) / alignment) * alignment;
+
+    void* data = std::aligned_alloc(alignment, size);
+    if (!data) {
+        throw std::bad_alloc();
+    }
+
+    if (alignment == kHugePageSize) {
+        // Only a hint: it fails harmlessly where transparent huge pages are disabled.
+        ::madvise(data, size, MADV_HUGEPAGE);
+    }
+    return data;
+}
+
+void AlignedHostAllocator::deallocate(void* data, std::size_t) noexcept {
+    std::free(data);
+}
+
+std::shared_ptr<HostAllocator> default_host_allocator() {
+    static auto const allocator = std::make_shared<AlignedHostAllocator>();
+    return allocator;
+}
+
+SlabPool::SlabPool(std::size_t slab_size, std::shared_ptr<HostAllocator> allocator)
+    : m_slab_size{slab_size}, m_allocator{std::move(allocator)} {}
+
+std::shared_ptr<HostBuffer<float>> SlabPool::acquire() {
+    for (std::size_t i = 0; i < m_slabs.size(); ++i) {
+        std::size_t const idx = (m_next + i) % m_slabs.size();
+        if (m_slabs[idx].use_count() == 1) {
+            // Pairs with the release in the shared_ptr destructors of the last results.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            m_next = idx + 1;
+            return m_slabs[idx];
+        }
+    }
+
+    ++m_allocations;
+    auto slab = std::make_shared<HostBuffer<float>>(m_slab_size, m_allocator);
+    if (m_slabs.size() < kMaxPooledSlabs) {
+        m_slabs.push_back(slab);
+        m_next = m_slabs.size();
+    }
+    return slab;
+}
+
+std::size_t SlabPool::allocations() const {
+    return m_allocations;
+}
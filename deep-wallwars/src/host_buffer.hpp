@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Allocates the host memory that inputs and outputs of models are staged in. Backends that benefit
+// from special memory (TensorRT wants page-locked memory for fast transfers to the GPU) provide
+// their own allocator through Model::host_allocator().
+class HostAllocator {
+public:
+    virtual ~HostAllocator() = default;
+
+    // Throws std::bad_alloc (or a backend specific exception) if the memory is not available.
+    virtual void* allocate(std::size_t bytes) = 0;
+    virtual void deallocate(void* data, std::size_t bytes) noexcept = 0;
+};
+
+// Memory aligned to cache lines (and thus to any vector register). Allocations of at least
+// kHugePageSize are aligned to huge pages and advised to be backed by them, which saves TLB misses
+// when large batches are tensorized.
+class AlignedHostAllocator : public HostAllocator {
+public:
+    static constexpr std::size_t kAlignment = 64;
+    static constexpr std::size_t kHugePageSize = std::size_t{2} << 20;
+
+    void* allocate(std::size_t bytes) override;
+    void deallocate(void* data, std::size_t bytes) noexcept override;
+};
+
+// A process-wide AlignedHostAllocator.
+std::shared_ptr<HostAllocator> default_host_allocator();
+
+// Zero-initialized buffer of trivial values in memory of a HostAllocator, which it keeps alive.
+template <typename T>
+class HostBuffer {
+public:
+    explicit HostBuffer(std::size_t size,
+                        std::shared_ptr<HostAllocator> allocator = default_host_allocator())
+        : m_allocator{std::move(allocator)},
+          m_data{static_cast<T*>(m_allocator->allocate(size * sizeof(T)))},
+          m_size{size} {
+        std::fill(m_data, m_data + size, T{});
+    }
+
+    ~HostBuffer() {
+        if (m_data) {
+            m_allocator->deallocate(m_data, m_size * sizeof(T));
+        }
+    }
+
+    HostBuffer(HostBuffer const& other) = delete;
+    HostBuffer(HostBuffer&& other) noexcept
+        : m_allocator{std::move(other.m_allocator)},
+          m_data{std::exchange(other.m_data, nullptr)},
+          m_size{std::exchange(other.m_size, 0)} {}
+
+    HostBuffer& operator=(HostBuffer const& other) = delete;
+    HostBuffer& operator=(HostBuffer&& other) noexcept {
+        std::swap(m_allocator, other.m_allocator);
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    T& operator[](std::size_t idx) {
+        return m_data[idx];
+    }
+
+    T const& operator[](std::size_t idx) const {
+        return m_data[idx];
+    }
+
+    T* data() const {
+        return m_data;
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+    operator std::span<T>() const {
+        return std::span<T>(m_data, m_size);
+    }
+
+private:
+    std::shared_ptr<HostAllocator> m_allocator;
+    T* m_data;
+    std::size_t m_size;
+};
+
+// Recycles the prior slabs of a batch worker, which results of the batch view into. A slab is
+// reused once no result references it anymore. The pool keeps at most kMaxPooledSlabs slabs, so
+// results that callers keep alive pin at most that many. While all of them are busy, it hands out
+// fresh slabs that are freed along with their last result. Not thread-safe, each worker has its
+// own pool.
+class SlabPool {
+public:
+    static constexpr std::size_t kMaxPooledSlabs = 8;
+
+    SlabPool(std::size_t slab_size, std::shared_ptr<HostAllocator> allocator);
+
+    std::shared_ptr<HostBuffer<float>> acquire();
+
+    // Slabs allocated so far, pooled or not.
+    std::size_t allocations() const;
+
+private:
+    std::size_t m_slab_size;
+    std::shared_ptr<HostAllocator> m_allocator;
+    std::vector<std::shared_ptr<HostBuffer<float>>> m_slabs;
+    // Where the next search for a free slab starts, right after the slab handed out last.
+    std::size_t m_next = 0;
+    std::size_t m_allocations = 0;
+};
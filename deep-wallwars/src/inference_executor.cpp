@@ -0,0 +1,164 @@
+#include "inference_executor.hpp"
+
+#include <folly/executors/thread_factory/InitThreadFactory.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/logging/xlog.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <latch>
+#include <stdexcept>
+
+static int parse_cpu(std::string_view text) {
+    int cpu = -1;
+    auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), cpu);
+    if (error != std::errc{} || end != text.data() + text.size() || cpu < 0 ||
+        cpu >= CPU_SETSIZE) {
+        throw std::runtime_error("Invalid CPU: '" + std::string(text) + "'");
+    }
+    return cpu;
+}
+
+std::vector<int> parse_cpu_list(std::string_view list) {
+    std::vector<int> cpus;
+    while (!list.empty()) {
+        std::size_t const comma = list.find(',');
+        std::string_view const range = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+        std::size_t const dash = range.find('-');
+        int const first = parse_cpu(range.substr(0, dash));
+        int const last = dash == std::string_view::npos ? first : parse_cpu(range.substr(dash + 1));
+        if (last < first) {
+            throw std::runtime_error("Invalid CPU range: '" + std::string(range) + "'");
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Checks up front that pinning to `cpus` will work, since threads cannot report errors as nicely.
+static void check_available(std::span<int const> cpus) {
+    cpu_set_t available;
+    if (sched_getaffinity(0, sizeof(available), &available) != 0) {
+        throw std::runtime_error(std::string("sched_getaffinity failed: ") + std::strerror(errno));
+    }
+    for (int cpu : cpus) {
+        if (!CPU_ISSET(cpu, &available)) {
+            throw std::runtime_error("CPU " + std::to_string(cpu) + " is not available");
+        }
+    }
+}
+
+static void pin_thread(pthread_t thread, std::span<int const> cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    // Returns the error rather than setting errno.
+    if (int const error = pthread_setaffinity_np(thread, sizeof(set), &set); error != 0) {
+        throw std::runtime_error(std::string("Failed to pin thread: ") + std::strerror(error));
+    }
+}
+
+void pin_current_thread(std::span<int const> cpus) {
+    pin_thread(pthread_self(), cpus);
+}
+
+std::shared_ptr<folly::ThreadFactory> pinned_thread_factory(std::string const& name,
+                                                            std::vector<int> cpus) {
+    auto factory = std::make_shared<folly::NamedThreadFactory>(name);
+    if (cpus.empty()) {
+        return factory;
+    }
+
+    check_available(cpus);
+    return std::make_shared<folly::InitThreadFactory>(
+        std::move(factory), [cpus = std::move(cpus)] { pin_current_thread(cpus); });
+}
+
+InferenceExecutor::InferenceExecutor(int threads) {
+    for (int i = 0; i < std::max(1, threads); ++i) {
+        m_threads.emplace_back([this](std::stop_token stop) { run_thread(stop); });
+    }
+}
+
+InferenceExecutor::InferenceExecutor(std::vector<int> const& cpus) {
+    if (cpus.empty()) {
+        throw std::runtime_error("No CPUs to run inference on!");
+    }
+    check_available(cpus);
+
+    for (int cpu : cpus) {
+        auto& thread =
+            m_threads.emplace_back([this](std::stop_token stop) { run_thread(stop); });
+        pin_thread(thread.native_handle(), std::span{&cpu, 1});
+    }
+}
+
+int InferenceExecutor::threads() const {
+    return int(m_threads.size());
+}
+
+void InferenceExecutor::parallel_for(int count, std::function<void(int)> const& task) {
+    if (count <= 0) {
+        return;
+    }
+
+    std::latch done{count};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    {
+        std::lock_guard lock{m_mutex};
+        for (int i = 0; i < count; ++i) {
+            m_tasks.push_back([&, i] {
+                try {
+                    task(i);
+                } catch (...) {
+                    std::lock_guard error_lock{error_mutex};
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                done.count_down();
+            });
+        }
+    }
+    m_ready.notify_all();
+
+    done.wait();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void InferenceExecutor::run_thread(std::stop_token stop) {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock{m_mutex};
+            if (!m_ready.wait(lock, stop, [&] { return !m_tasks.empty(); })) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+std::shared_ptr<InferenceExecutor> make_inference_executor(int threads, std::string const& cpus) {
+    if (cpus.empty()) {
+        return std::make_shared<InferenceExecutor>(threads);
+    }
+
+    auto executor = std::make_shared<InferenceExecutor>(parse_cpu_list(cpus));
+    XLOGF(INFO, "Pinned {} inference threads to CPUs {}", executor->threads(), cpus);
+    return executor;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Parses a list of CPUs such as "0-7,16,18-19" (the format of taskset and /sys/devices/system/cpu).
+// An empty string is an empty list. Throws on malformed lists.
+std::vector<int> parse_cpu_list(std::string_view list);
+
+// Restricts the calling thread to `cpus`. Throws if none of them is available.
+void pin_current_thread(std::span<int const> cpus);
+
+// Thread factory for search pools that should stay off the cores used for inference. An empty list
+// leaves the threads unpinned.
+std::shared_ptr<folly::ThreadFactory> pinned_thread_factory(std::string const& name,
+                                                            std::vector<int> cpus);
+
+// Threads dedicated to CPU inference, so that it does not compete with the search for cores and
+// caches. CPU models split each batch into one task per thread and hand all of them to the
+// executor, while the calling thread (the BatchedModel worker) only waits. Several models can share
+// one executor, which then bounds the number of threads running inference in total.
+class InferenceExecutor {
+public:
+    // `threads` threads that may run anywhere.
+    explicit InferenceExecutor(int threads);
+    // One thread pinned to each of `cpus`.
+    explicit InferenceExecutor(std::vector<int> const& cpus);
+
+    int threads() const;
+
+    // Runs task(0) to task(count - 1) on the executor's threads and waits for all of them. The
+    // first exception thrown by a task is rethrown once all tasks are done.
+    void parallel_for(int count, std::function<void(int)> const& task);
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable_any m_ready;
+    std::deque<std::function<void()>> m_tasks;
+
+    // Threads need to come last so the queue is still alive while we join them.
+    std::vector<std::jthread> m_threads;
+
+    void run_thread(std::stop_token stop);
+};
+
+// --cpu_threads and --inference_cpus of the executables: pinned threads if `cpus` is not empty,
+// otherwise `threads` threads.
+std::shared_ptr<InferenceExecutor> make_inference_executor(int threads, std::string const& cpus);
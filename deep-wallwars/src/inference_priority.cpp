@@ -0,0 +1,17 @@
+#include "inference_priority.hpp"
+
+folly::RequestToken const& InferencePriorityData::token() {
+    static folly::RequestToken const token{"deep_wallwars.inference_priority"};
+    return token;
+}
+
+InferencePriority current_inference_priority() {
+    folly::RequestContext* context = folly::RequestContext::try_get();
+    if (!context) {
+        return InferencePriority::Normal;
+    }
+
+    auto const* data = static_cast<InferencePriorityData const*>(
+        context->getContextData(InferencePriorityData::token()));
+    return data ? data->priority : InferencePriority::Normal;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <folly/experimental/coro/Task.h>
+#include <folly/io/async/Request.h>
+
+#include <memory>
+
+// Scheduling class of an inference request. Lower values are served first.
+enum class InferencePriority {
+    Interactive,  // Someone is waiting for the answer, e.g. a live game.
+    Normal,
+    Background,  // Nobody waits for it, e.g. self-play and evaluation matches.
+};
+
+constexpr int kNumInferencePriorities = 3;
+
+// Carries the priority through the folly RequestContext, which follows coroutines across
+// suspension points and executors. This saves us from threading it through every
+// EvaluationFunction.
+class InferencePriorityData : public folly::RequestData {
+public:
+    explicit InferencePriorityData(InferencePriority priority) : priority{priority} {}
+
+    static folly::RequestToken const& token();
+
+    bool hasCallback() override {
+        return false;
+    }
+
+    InferencePriority const priority;
+};
+
+// Priority of the inference requests issued from the current request context. Normal if none was
+// set.
+InferencePriority current_inference_priority();
+
+// Runs `task` such that all inference requests it issues are tagged with `priority`.
+template <typename T>
+folly::coro::Task<T> with_inference_priority(InferencePriority priority,
+                                             folly::coro::Task<T> task) {
+    folly::ShallowCopyRequestContextScopeGuard guard{
+        InferencePriorityData::token(), std::make_unique<InferencePriorityData>(priority)};
+    co_return co_await std::move(task);
+}
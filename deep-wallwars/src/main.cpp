@@ -1,5 +1,7 @@
+#ifdef TENSORRT_ENABLED
 #include <NvInfer.h>
 #include <NvInferRuntime.h>
+#endif
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/experimental/coro/BlockingWait.h>
 #include <folly/logging/xlog.h>
@@ -9,27 +11,66 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <ranges>
 #include <sstream>
 
 #include "batched_model.hpp"
 #include "batched_model_policy.hpp"
 #include "cached_policy.hpp"
+#include "cpu_model.hpp"
+#include "inference_executor.hpp"
 #include "mcts.hpp"
+#include "model_host.hpp"
 #include "play.hpp"
 #include "simple_policy.hpp"
 #include "state_conversions.hpp"
+#ifdef TENSORRT_ENABLED
 #include "tensorrt_model.hpp"
+#endif
 #ifdef GUI_ENABLED
 #include "gui/game_gui.hpp"
 #endif
 
-DEFINE_string(model1, "", "Serialized TensorRT Model 1");
-DEFINE_string(model2, "", "Serialized TensorRT Model 2");
+DEFINE_string(model1, "", "Serialized TensorRT model or ONNX model run on the CPU 1");
+DEFINE_string(model2, "", "Serialized TensorRT model or ONNX model run on the CPU 2");
+DEFINE_string(fast_model1, "",
+              "Cheaper model or 'simple' that expands the deep nodes of the searches of model 1 "
+              "(evaluation only)");
+DEFINE_int32(fast_depth, 4, "Nodes more plies than this below the root use --fast_model1");
+DEFINE_int32(refine_samples, 8,
+             "Samples after which nodes expanded by --fast_model1 are evaluated by model 1");
+DEFINE_bool(sprt, false,
+            "Stop evaluating model 1 against model 2 once a sequential probability ratio test "
+            "concludes. --games is then the maximum number of games");
+DEFINE_double(sprt_elo0, 0, "Elo of model 1 relative to model 2 under the null hypothesis");
+DEFINE_double(sprt_elo1, 10, "Elo of model 1 relative to model 2 under the alternative hypothesis");
+DEFINE_double(sprt_alpha, 0.05, "Probability that the SPRT accepts a model 1 that is not better");
+DEFINE_double(sprt_beta, 0.05, "Probability that the SPRT rejects a model 1 that is better");
+DEFINE_string(openings, "",
+              "File of start positions (BGS configs or notation) for evaluation and ranking games");
+DEFINE_int32(opening_samples, 0,
+             "Samples per opening and model to pre-search into a shared cache (0 to disable)");
 DEFINE_string(output, "data", "Folder to print training data to");
 DEFINE_uint32(seed, 42, "Random seed");
-DEFINE_uint64(cache_size, 100'000, "Size of the internal evaluation cache");
+DEFINE_uint64(cache_mb, 256, "Memory budget of the internal evaluation cache in MiB");
 DEFINE_bool(boost_mouse_priors, false, "Boost mouse move priors to encourage exploration");
+DEFINE_int32(min_batch_fill, 1, "Minimum number of inferences per batch before it is sent");
+DEFINE_int64(max_batch_wait_us, 0,
+             "Maximum time (us) to wait for a batch to reach --min_batch_fill");
+DEFINE_int32(cpu_threads, 1, "Inference threads shared by all models run on the CPU");
+DEFINE_string(inference_cpus, "",
+              "CPUs to pin the inference threads of CPU models to, e.g. 0-7 (one thread per CPU, "
+              "overrides --cpu_threads)");
+DEFINE_string(search_cpus, "", "CPUs to pin the search threads (--j) to, e.g. 8-31");
+DEFINE_int32(cpu_batch_size, 32, "Batch size of ONNX models run on the CPU");
+DEFINE_string(cpu_int8_data, "",
+              "Quantize ONNX models run on the CPU to int8, calibrated with the training data in "
+              "this folder");
+DEFINE_bool(cpu_winograd, false, "Use Winograd convolutions for ONNX models run on the CPU");
+DEFINE_int64(batch_latency_target_us, 0,
+             "If > 0, adaptively wait for full batches as long as inferences are answered within "
+             "this latency (us). Overrides --min_batch_fill and --max_batch_wait_us");
 
 DEFINE_int32(columns, 5, "Number of columns");
 DEFINE_int32(rows, 5, "Number of rows");
@@ -47,15 +88,27 @@ DEFINE_double(bad_move, 0.75, "Bad move bias of simple agent");
 DEFINE_bool(interactive, false, "Enable interactive play against the AI");
 DEFINE_bool(gui, false, "Use GUI instead of console for interactive mode");
 
-DEFINE_string(ranking, "", "Folder of *.trt models to rank against each other");
+DEFINE_string(ranking, "", "Folder of *.trt, *.wwnet or *.onnx models to rank against each other");
 DEFINE_int32(tournaments, 10, "Number of tournaments to run for ranking");
 DEFINE_int32(initial_model, 0, "Index of the initial model to use for ranking");
+DEFINE_int32(max_resident_models, 8, "Maximum number of models loaded at once during ranking");
+DEFINE_bool(incremental, false,
+            "Only rate the models of --ranking without a rating yet, against the rated ones");
+DEFINE_int32(anchors, 6, "Rated models each new model plays per round of --incremental");
+DEFINE_int32(games_per_anchor, 4, "Games against each anchor per round of --incremental");
+DEFINE_double(target_interval, 100, "--incremental stops once a rating interval is this narrow");
+DEFINE_int32(max_games_per_model, 400, "Most games of each new model in --incremental");
 
-namespace nv = nvinfer1;
 namespace views = std::ranges::views;
 
 int const kBatchedModelQueueSize = 4096;
 
+#ifdef TENSORRT_ENABLED
+bool const kTensorRTEnabled = true;
+#else
+bool const kTensorRTEnabled = false;
+#endif
+
 enum class Mode {
     Train,
     Evaluate,
@@ -63,40 +116,101 @@ enum class Mode {
     Ranking
 };
 
-// Creates and validates a model, returning it as an EvaluationFunction
-EvaluationFunction create_and_validate_model(nv::IRuntime& runtime, std::string const& model_flag,
-                                             Mode mode) {
-    if (model_flag == "simple") {
-        return SimplePolicy(FLAGS_move_prior, FLAGS_good_move, FLAGS_bad_move);
+// Shared by all CPU models, so that they never use more than --cpu_threads cores in total.
+std::shared_ptr<InferenceExecutor> cpu_inference_executor() {
+    static auto const executor = make_inference_executor(FLAGS_cpu_threads, FLAGS_inference_cpus);
+    return executor;
+}
+
+std::shared_ptr<folly::ThreadFactory> search_thread_factory() {
+    return pinned_thread_factory("Search", parse_cpu_list(FLAGS_search_cpus));
+}
+
+#ifdef TENSORRT_ENABLED
+namespace nv = nvinfer1;
+
+struct Logger : nv::ILogger {
+    void log(Severity severity, char const* msg) noexcept {
+        switch (severity) {
+            case Severity::kINTERNAL_ERROR:
+            case Severity::kERROR:
+                XLOG(ERR, msg);
+                break;
+            case Severity::kWARNING:
+                XLOG(WARN, msg);
+                break;
+            case Severity::kINFO:
+                XLOG(INFO, msg);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+// Loads `count` models sharing the TensorRT engine at `path`. The runtime is only created for the
+// first engine, so that CPU models also run on hosts without a GPU.
+std::vector<std::unique_ptr<Model>> load_tensorrt_models(std::string const& path, int count) {
+    static Logger logger;
+    static std::unique_ptr<nv::IRuntime> const runtime{nv::createInferRuntime(logger)};
+    if (!runtime) {
+        throw std::runtime_error(
+            "Failed to create TensorRT runtime. CUDA may be not available or out of memory.");
     }
 
-    // Load and validate TensorRT model
-    std::ifstream model_file(model_flag, std::ios::binary);
+    std::ifstream model_file(path, std::ios::binary);
     if (!model_file) {
-        throw std::runtime_error("Failed to open model file: " + model_flag);
+        throw std::runtime_error("Failed to open model file: " + path);
     }
-    XLOGF(INFO, "Loading TensorRT engine from: {}", model_flag);
+    XLOGF(INFO, "Loading TensorRT engine from: {}", path);
     std::shared_ptr<nv::ICudaEngine> engine;
     try {
-        engine = load_serialized_engine(runtime, model_file);
+        engine = load_serialized_engine(*runtime, model_file);
     } catch (std::exception const& e) {
-        throw std::runtime_error("Failed to load TensorRT engine from " + model_flag + ": " +
-                                 e.what());
+        throw std::runtime_error("Failed to load TensorRT engine from " + path + ": " + e.what());
     }
     if (!engine) {
-        throw std::runtime_error("Failed to load TensorRT engine from: " + model_flag);
+        throw std::runtime_error("Failed to load TensorRT engine from: " + path);
+    }
+
+    std::vector<std::unique_ptr<Model>> models;
+    for (int i = 0; i < count; i++) {
+        models.push_back(std::make_unique<TensorRTModel>(engine));
+    }
+    return models;
+}
+#else
+std::vector<std::unique_ptr<Model>> load_tensorrt_models(std::string const& path, int) {
+    throw std::runtime_error("Cannot load " + path +
+                             ": this build has no TensorRT support, use an .onnx or .wwnet model");
+}
+#endif
+
+// Creates and validates a model, returning it as an EvaluationFunction
+EvaluationFunction create_and_validate_model(std::string const& model_flag, Mode mode) {
+    if (model_flag == "simple") {
+        return SimplePolicy(FLAGS_move_prior, FLAGS_good_move, FLAGS_bad_move);
     }
 
-    std::vector<std::unique_ptr<Model>> tensor_rt_models;
-    // Use two models to improve GPU utilization.
-    int num_models = mode == Mode::Train ? 2 : 1;
-    for (int i = 0; i < num_models; i++) {
-        tensor_rt_models.push_back(std::make_unique<TensorRTModel>(engine));
+    std::vector<std::unique_ptr<Model>> models;
+    if (is_cpu_model(model_flag)) {
+        // The CPU model spreads each batch over the inference threads, so one is enough.
+        models.push_back(load_cpu_resnet(
+            model_flag, FLAGS_cpu_batch_size, cpu_inference_executor(), FLAGS_cpu_int8_data,
+            FLAGS_cpu_winograd ? ConvAlgorithm::Winograd : ConvAlgorithm::Direct));
+    } else {
+        // Use two models to improve GPU utilization.
+        models = load_tensorrt_models(model_flag, mode == Mode::Train ? 2 : 1);
+    }
+    BatchingOptions batching{.min_batch_fill = FLAGS_min_batch_fill,
+                             .max_wait = std::chrono::microseconds{FLAGS_max_batch_wait_us}};
+    if (FLAGS_batch_latency_target_us > 0) {
+        batching.latency_target = std::chrono::microseconds{FLAGS_batch_latency_target_us};
     }
     auto batched_model =
-        std::make_shared<BatchedModel>(std::move(tensor_rt_models), kBatchedModelQueueSize);
+        std::make_shared<BatchedModel>(std::move(models), kBatchedModelQueueSize, batching);
     BatchedModelPolicy batched_model_policy(std::move(batched_model), FLAGS_boost_mouse_priors);
-    return CachedPolicy(std::move(batched_model_policy), FLAGS_cache_size);
+    return CachedPolicy(std::move(batched_model_policy), FLAGS_cache_mb << 20);
 }
 
 std::string get_usage_message() {
@@ -107,6 +221,11 @@ std::string get_usage_message() {
         << "  Options:\n"
         << "    --tournaments N    # Number of tournaments to run (default 10)\n"
         << "    --initial_model N  # Index of the initial model to use for ranking (default 0)\n"
+        << "    --max_resident_models N  # Models loaded at once (default 8)\n"
+        << "    --openings FILE    # Start games from these positions (see EVALUATION)\n"
+        << "    --incremental      # Only rate new models against the rated ones (anchors)\n"
+        << "    --anchors N --games_per_anchor N  # Games per --incremental round (default 6x4)\n"
+        << "    --target_interval N  # Stop once the 95% interval is this wide (default 100 Elo)\n"
         << "INTERACTIVE: Play against the AI\n"
         << "    ./deep_ww --interactive --model1 <model.trt | simple>\n"
         << "    ./deep_ww --interactive --model1 <model.trt | simple> --gui  # Use GUI instead of "
@@ -117,14 +236,30 @@ std::string get_usage_message() {
         << "    --output DIR # Output folder (default 'data')\n"
         << "EVALUATION: Evaluate models against each other\n"
         << "    ./deep_ww --model1 <model1.trt | simple> --model2 <model2.trt | simple>\n"
+        << "  Options:\n"
+        << "    --fast_model1 <model.trt | simple>  # Expand deep nodes of model 1 with this\n"
+        << "    --fast_depth N      # Plies below the root still expanded by model 1 (default 4)\n"
+        << "    --refine_samples N  # Samples before model 1 re-evaluates them (default 8)\n"
+        << "    --sprt              # Stop once an SPRT of model 1 against model 2 concludes\n"
+        << "    --sprt_elo0 N --sprt_elo1 N  # Elo bounds of the SPRT (default 0 and 10)\n"
+        << "    --sprt_alpha N --sprt_beta N # Error probabilities of the SPRT (default 0.05)\n"
+        << "    --openings FILE     # Start pairs of games from these positions, one per line\n"
+        << "    --opening_samples N # Pre-search each opening into a shared cache (default 0)\n"
         << "COMMON OPTIONS:\n"
         << "    --games N             # Number of games to play (default 100)\n"
         << "    --samples N           # MCTS samples per action (default 500)\n"
         << "    --columns N --rows N  # Board size (default 5x5)\n"
         << "    --variant NAME        # classic or standard (default classic)\n"
         << "    --j N                 # Thread count (default 8)\n"
+        << "    --search_cpus LIST    # Pin the --j threads to these CPUs, e.g. 8-31\n"
         << "    --seed N              # Random seed (default 42)\n"
-        << "    --cache_size N        # MCTS cache size (default 100k)\n"
+        << "    --cache_mb N          # MCTS cache memory budget in MiB (default 256)\n"
+        << "CPU MODELS: *.onnx and *.wwnet models are run on the CPU instead of the GPU\n"
+        << "    --cpu_threads N     # Inference threads shared by all models (default 1)\n"
+        << "    --inference_cpus LIST  # One inference thread pinned to each CPU, e.g. 0-7\n"
+        << "    --cpu_batch_size N  # Positions per inference batch (default 32)\n"
+        << "    --cpu_int8_data DIR # Quantize to int8, calibrated with training data from DIR\n"
+        << "    --cpu_winograd      # Winograd float convolutions, about 3x faster (default off)\n"
         << "SIMPLE POLICY OPTIONS: policy that primarily tries to move towards the goal\n"
         << "    --move_prior N  # How likely it is to choose a pawn move (default 0.3)\n"
         << "    --good_move N   # Bias for pawn moves that get closer to the goal (default 1.5)\n"
@@ -134,30 +269,47 @@ std::string get_usage_message() {
     return oss.str();
 }
 
-struct Logger : nv::ILogger {
-    void log(Severity severity, char const* msg) noexcept {
-        switch (severity) {
-            case Severity::kINTERNAL_ERROR:
-            case Severity::kERROR:
-                XLOG(ERR, msg);
-                break;
-            case Severity::kWARNING:
-                XLOG(WARN, msg);
-                break;
-            case Severity::kINFO:
-                XLOG(INFO, msg);
-                break;
-            default:
-                break;
-        }
+// Logs cache and batching statistics if the evaluation function is a cached model.
+void log_model_stats(EvaluationFunction const& eval_fn, std::string_view prefix) {
+    auto* cached_policy = eval_fn.target<CachedPolicy>();
+    if (!cached_policy) {
+        return;
     }
-};
+
+    XLOGF(INFO, "{}{} cache hits, {} cache misses, {} coalesced during play ({} MiB cached).",
+          prefix, cached_policy->cache_hits(), cached_policy->cache_misses(),
+          cached_policy->cache_coalesced(), cached_policy->cache_bytes() >> 20);
+
+    auto* policy = cached_policy->underlying_policy().target<BatchedModelPolicy>();
+    if (!policy) {
+        return;
+    }
+
+    auto inferences = policy->total_inferences();
+    auto batches = policy->total_batches();
+    XLOGF(INFO, "{}{} inferences were sent in {} batches ({} per batch)", prefix, inferences,
+          batches, double(inferences) / batches);
+
+    auto const& batched_model = policy->batched_model();
+    XLOGF(INFO, "{}Workers spent {} us per batch, {} output slabs were allocated", prefix,
+          std::chrono::duration_cast<std::chrono::microseconds>(batched_model.total_worker_time())
+                  .count() /
+              double(batches),
+          batched_model.total_output_slabs());
+
+    auto histograms = batched_model.batch_histograms();
+    XLOGF(INFO, "{}Batch fill p10/p50/p90: {}/{}/{}, batch wait p50/p90/p99: {}/{}/{} us", prefix,
+          histograms.fill.getPercentileEstimate(0.1), histograms.fill.getPercentileEstimate(0.5),
+          histograms.fill.getPercentileEstimate(0.9), histograms.wait_us.getPercentileEstimate(0.5),
+          histograms.wait_us.getPercentileEstimate(0.9),
+          histograms.wait_us.getPercentileEstimate(0.99));
+}
 
 void train(EvaluationFunction const& eval_fn, Variant variant) {
     Board board{FLAGS_columns, FLAGS_rows, variant};
     TrainingDataPrinter training_data_printer(FLAGS_output, 0.5);
 
-    folly::CPUThreadPoolExecutor thread_pool(FLAGS_j);
+    folly::CPUThreadPoolExecutor thread_pool(FLAGS_j, search_thread_factory());
 
     XLOGF(INFO, "Created thread pool with {} threads (FLAGS_j = {})", thread_pool.numThreads(),
           FLAGS_j);
@@ -173,58 +325,58 @@ void train(EvaluationFunction const& eval_fn, Variant variant) {
                                             })
                                   .scheduleOn(&thread_pool));
 
-    // Get cache stats if available
-    if (auto* cached_policy = eval_fn.target<CachedPolicy>()) {
-        XLOGF(INFO, "{} cache hits, {} cache misses during play.", cached_policy->cache_hits(),
-              cached_policy->cache_misses());
-
-        // Get batched model stats
-        if (auto* policy = cached_policy->underlying_policy().target<BatchedModelPolicy>()) {
-            auto inferences = policy->total_inferences();
-            auto batches = policy->total_batches();
-            XLOGF(INFO, "{} inferences were sent in {} batches ({} per batch)", inferences, batches,
-                  double(inferences) / batches);
-        }
+    log_model_stats(eval_fn, "");
+}
+
+std::shared_ptr<std::vector<Opening> const> load_openings(Board const& board) {
+    if (FLAGS_openings.empty()) {
+        return nullptr;
     }
+    auto openings = std::make_shared<std::vector<Opening> const>(
+        load_opening_suite(FLAGS_openings, board));
+    XLOGF(INFO, "Loaded {} openings from {}.", openings->size(), FLAGS_openings);
+    return openings;
 }
 
 void evaluate(EvaluationFunction const& eval_fn1, EvaluationFunction const& eval_fn2,
-              Variant variant) {
+              EvaluationFunction const& fast_eval_fn1, Variant variant) {
     Board board{FLAGS_columns, FLAGS_rows, variant};
-    folly::CPUThreadPoolExecutor thread_pool(FLAGS_j);
+    folly::CPUThreadPoolExecutor thread_pool(FLAGS_j, search_thread_factory());
+
+    std::optional<SprtOptions> sprt;
+    if (FLAGS_sprt) {
+        sprt = SprtOptions{.elo0 = FLAGS_sprt_elo0,
+                           .elo1 = FLAGS_sprt_elo1,
+                           .alpha = FLAGS_sprt_alpha,
+                           .beta = FLAGS_sprt_beta};
+    }
 
-    auto recorders = folly::coro::blockingWait(evaluation_play(board, FLAGS_games,
-                                                               {
-                                                                   .model1 = {eval_fn1, "Model1"},
-                                                                   .model2 = {eval_fn2, "Model2"},
-                                                                   .samples = FLAGS_samples,
-                                                                   .seed = FLAGS_seed,
-                                                               })
-                                                   .scheduleOn(&thread_pool));
+    auto recorders = folly::coro::blockingWait(
+        evaluation_play(board, FLAGS_games,
+                        {
+                            .model1 = {eval_fn1, "Model1", fast_eval_fn1},
+                            .model2 = {eval_fn2, "Model2"},
+                            .samples = FLAGS_samples,
+                            .fast_depth = FLAGS_fast_depth,
+                            .refine_samples = FLAGS_refine_samples,
+                            .sprt = sprt,
+                            .openings = load_openings(board),
+                            .opening_samples = FLAGS_opening_samples,
+                            .seed = FLAGS_seed,
+                        })
+            .scheduleOn(&thread_pool));
 
     for (auto const& [player, results] : tally_results(recorders)) {
         XLOGF(INFO, "{} has a W/L/D of {}/{}/{}.", player, results.wins, results.losses,
               results.draws);
     }
 
-    // Get cache stats for first model if available
-    if (auto* cached_policy = eval_fn1.target<CachedPolicy>()) {
-        XLOGF(INFO, "Model1: {} cache hits, {} cache misses during play.",
-              cached_policy->cache_hits(), cached_policy->cache_misses());
-
-        // Get batched model stats for first model
-        if (auto* policy = cached_policy->underlying_policy().target<BatchedModelPolicy>()) {
-            auto inferences = policy->total_inferences();
-            auto batches = policy->total_batches();
-            XLOGF(INFO, "Model1: {} inferences were sent in {} batches ({} per batch)", inferences,
-                  batches, double(inferences) / batches);
-        }
-    }
+    log_model_stats(eval_fn1, "Model1: ");
 }
 
 void interactive(EvaluationFunction const& eval_fn, Variant variant) {
     Board board{FLAGS_columns, FLAGS_rows, variant};
-    folly::CPUThreadPoolExecutor thread_pool(FLAGS_j);
+    folly::CPUThreadPoolExecutor thread_pool(FLAGS_j, search_thread_factory());
     InteractivePlayOptions opts = {
         .model = eval_fn,
         .samples = FLAGS_samples,
@@ -240,37 +392,79 @@ void interactive(EvaluationFunction const& eval_fn, Variant variant) {
     folly::coro::blockingWait(interactive_play(board, opts).scheduleOn(&thread_pool));
 }
 
-void ranking(nv::IRuntime& runtime, Variant variant) {
+void ranking(Variant variant) {
     std::filesystem::path ranking_folder(FLAGS_ranking);
     std::map<std::filesystem::file_time_type, std::filesystem::path> model_paths;
     for (auto const& dir_entry : std::filesystem::directory_iterator{ranking_folder}) {
-        if (dir_entry.path().extension() == ".trt") {
+        auto const& path = dir_entry.path();
+        // Training exports several formats of each model. Use the fastest one: TensorRT engines
+        // (if this build supports them), then .wwnet files (see deep_ww_convert), then ONNX files.
+        auto has_format = [&](char const* extension) {
+            auto other = path;
+            return std::filesystem::exists(other.replace_extension(extension));
+        };
+        bool const has_trt = kTensorRTEnabled && has_format(".trt");
+        auto const extension = path.extension();
+        bool const use = (extension == ".trt" && kTensorRTEnabled) ||
+                         (extension == ".wwnet" && !has_trt) ||
+                         (extension == ".onnx" && !has_trt && !has_format(".wwnet"));
+        if (use) {
             model_paths.insert({dir_entry.last_write_time(), dir_entry.path()});
         }
     }
 
-    std::vector<std::unique_ptr<nv::ICudaEngine>> engines;
-    std::vector<NamedModel> models;
+    // All models share one host, which only keeps the few that are currently playing loaded.
+    auto load_model = [](std::string const& path) -> std::unique_ptr<Model> {
+        if (is_cpu_model(path)) {
+            return load_cpu_resnet(
+                path, FLAGS_cpu_batch_size, cpu_inference_executor(), FLAGS_cpu_int8_data,
+                FLAGS_cpu_winograd ? ConvAlgorithm::Winograd : ConvAlgorithm::Direct);
+        }
+        return std::move(load_tensorrt_models(path, 1).front());
+    };
+    ModelHostOptions host_options{.max_resident_models = FLAGS_max_resident_models,
+                                  .min_batch_fill = FLAGS_min_batch_fill,
+                                  .max_wait = std::chrono::microseconds{FLAGS_max_batch_wait_us}};
+    auto host = std::make_shared<ModelHost>(load_model, host_options);
+
+    auto selected_paths = model_paths | views::drop(FLAGS_initial_model) | views::values;
+    // The cache budget is shared by all models.
+    std::size_t const cache_bytes =
+        (FLAGS_cache_mb << 20) / std::max<std::size_t>(1, std::ranges::distance(selected_paths));
 
-    for (auto const& [_, model_path] : model_paths | views::drop(FLAGS_initial_model)) {
-        auto cached_policy = create_and_validate_model(runtime, model_path.string(), Mode::Ranking);
-        models.push_back(NamedModel{std::move(cached_policy), model_path.filename().string()});
+    std::vector<NamedModel> models;
+    for (auto const& model_path : selected_paths) {
+        HostedModelPolicy policy{host, host->add_model(model_path.string()),
+                                 FLAGS_boost_mouse_priors};
+        models.push_back(NamedModel{CachedPolicy(std::move(policy), cache_bytes),
+                                    model_path.filename().string()});
     }
 
     Board board{FLAGS_columns, FLAGS_rows, variant};
-    folly::CPUThreadPoolExecutor thread_pool(FLAGS_j);
+    folly::CPUThreadPoolExecutor thread_pool(FLAGS_j, search_thread_factory());
     XLOGF(INFO, "Collected {} models. Starting ranking now.", models.size());
 
+    RankingPlayOptions opts{.models = std::move(models),
+                            .output_folder = ranking_folder,
+                            .samples = FLAGS_samples,
+                            .games_per_matchup = FLAGS_games,
+                            .num_tournaments = FLAGS_tournaments,
+                            .openings = load_openings(board),
+                            .opening_samples = FLAGS_opening_samples,
+                            .incremental = FLAGS_incremental,
+                            .anchors = FLAGS_anchors,
+                            .target_interval = FLAGS_target_interval,
+                            .max_games_per_model = FLAGS_max_games_per_model,
+                            .max_models_in_flight = host_options.max_resident_models,
+                            .seed = FLAGS_seed};
+    if (FLAGS_incremental) {
+        opts.games_per_matchup = FLAGS_games_per_anchor;
+    }
     auto recorders =
-        folly::coro::blockingWait(ranking_play(board, {.models = std::move(models),
-                                                       .output_folder = ranking_folder,
-                                                       .samples = FLAGS_samples,
-                                                       .games_per_matchup = FLAGS_games,
-                                                       .num_tournaments = FLAGS_tournaments,
-                                                       .seed = FLAGS_seed})
-                                      .scheduleOn(&thread_pool));
-
-    XLOGF(INFO, "Output written to {}.pgn/json.", (ranking_folder / "games").string());
+        folly::coro::blockingWait(ranking_play(board, std::move(opts)).scheduleOn(&thread_pool));
+
+    XLOGF(INFO, "Games written to {}, ratings to {}.", (ranking_folder / "games.json").string(),
+          (ranking_folder / "elo_ratings.txt").string());
 }
 
 int main(int argc, char** argv) {
@@ -291,14 +485,6 @@ int main(int argc, char** argv) {
     }
     Variant variant = *parsed_variant;
 
-    Logger logger;
-    std::unique_ptr<nv::IRuntime> runtime{nv::createInferRuntime(logger)};
-
-    if (!runtime) {
-        XLOG(ERR, "Failed to create TensorRT runtime. CUDA may be not available or out of memory.");
-        return 1;
-    }
-
     Mode mode;
     if (FLAGS_ranking != "") {
         mode = Mode::Ranking;
@@ -325,6 +511,10 @@ int main(int argc, char** argv) {
             XLOG(ERR, "Specified --interactive and --ranking.");
             return 1;
         }
+        if (FLAGS_incremental && (FLAGS_anchors < 1 || FLAGS_games_per_anchor < 1)) {
+            XLOG(ERR, "Incremental ranking needs --anchors and --games_per_anchor of at least 1.");
+            return 1;
+        }
     } else if (mode == Mode::Interactive) {
         if (FLAGS_model1.empty()) {
             XLOG(ERR, "Interactive mode requires --model1.");
@@ -344,22 +534,30 @@ int main(int argc, char** argv) {
 #endif
     }
 
-    EvaluationFunction eval_fn1, eval_fn2;
+    if (!FLAGS_fast_model1.empty() && mode != Mode::Evaluate) {
+        XLOG(ERR, "--fast_model1 is only supported when evaluating two models.");
+        return 1;
+    }
+
+    EvaluationFunction eval_fn1, eval_fn2, fast_eval_fn1;
     if (!FLAGS_model1.empty()) {
-        eval_fn1 = create_and_validate_model(*runtime, FLAGS_model1, mode);
+        eval_fn1 = create_and_validate_model(FLAGS_model1, mode);
     }
     if (!FLAGS_model2.empty()) {
-        eval_fn2 = create_and_validate_model(*runtime, FLAGS_model2, mode);
+        eval_fn2 = create_and_validate_model(FLAGS_model2, mode);
+    }
+    if (!FLAGS_fast_model1.empty()) {
+        fast_eval_fn1 = create_and_validate_model(FLAGS_fast_model1, mode);
     }
 
     auto start = std::chrono::high_resolution_clock::now();
 
     if (mode == Mode::Ranking) {
-        ranking(*runtime, variant);
+        ranking(variant);
     } else if (mode == Mode::Interactive) {
         interactive(eval_fn1, variant);
     } else if (mode == Mode::Evaluate) {
-        evaluate(eval_fn1, eval_fn2, variant);
+        evaluate(eval_fn1, eval_fn2, fast_eval_fn1, variant);
     } else if (mode == Mode::Train) {
         train(eval_fn1, variant);
     }
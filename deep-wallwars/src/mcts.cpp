@@ -5,6 +5,7 @@
 #include <folly/logging/xlog.h>
 
 #include <algorithm>
+#include <limits>
 #include <random>
 #include <ranges>
 
@@ -16,19 +17,60 @@ TreeEdge::TreeEdge(Action action, float prior) : action{action}, prior{prior} {}
 
 TreeEdge::TreeEdge(TreeEdge const& other)
     : action{other.action},
-      prior{other.prior},
+      prior{other.prior.load(std::memory_order_relaxed)},
       active_samples{other.active_samples.load()},
       child{other.child.load()} {}
 
 TreeEdge& TreeEdge::operator=(TreeEdge const& other) {
     action = other.action;
-    prior = other.prior;
+    prior.store(other.prior.load(std::memory_order_relaxed), std::memory_order_relaxed);
     active_samples = other.active_samples.load();
     child = other.child.load();
 
     return *this;
 }
 
+// Sets the priors of `edges` to those of the same actions in `from`, and to 0 for the actions that
+// `from` does not have.
+static void assign_priors(std::vector<TreeEdge>& edges, std::vector<TreeEdge> const& from) {
+    // Evaluators list the actions in the legal action order, so a single pass usually matches them.
+    std::size_t matched = 0;
+    for (TreeEdge& edge : edges) {
+        float prior = 0;
+        if (matched < from.size() && from[matched].action == edge.action) {
+            prior = from[matched++].prior.load(std::memory_order_relaxed);
+        }
+        edge.prior.store(prior, std::memory_order_relaxed);
+    }
+    if (matched == from.size()) {
+        return;
+    }
+
+    for (TreeEdge& edge : edges) {
+        auto const it = std::ranges::find(from, edge.action, &TreeEdge::action);
+        float const prior = it == from.end() ? 0 : it->prior.load(std::memory_order_relaxed);
+        edge.prior.store(prior, std::memory_order_relaxed);
+    }
+}
+
+// Edges for all legal actions, with the priors of `evaluated` (0 for the actions it does not have).
+static std::vector<TreeEdge> legal_edges(Board const& board, Turn turn,
+                                         std::optional<PreviousPosition> const& previous_position,
+                                         std::vector<TreeEdge> const& evaluated) {
+    std::vector<TreeEdge> edges;
+    for (Action const& action : board.legal_actions(turn.player)) {
+        auto const* pawn_move = std::get_if<PawnMove>(&action);
+        if (pawn_move && previous_position && previous_position->pawn == pawn_move->pawn &&
+            board.pawn_position(turn.player, pawn_move->pawn).step(pawn_move->dir) ==
+                previous_position->cell) {
+            continue;
+        }
+        edges.emplace_back(action, 0.0f);
+    }
+    assign_priors(edges, evaluated);
+    return edges;
+}
+
 void TreeNode::add_sample(float weight) {
     TreeNode::Value old_val = value;
     TreeNode::Value new_val;
@@ -38,6 +80,15 @@ void TreeNode::add_sample(float weight) {
     } while (!value.compare_exchange_weak(old_val, new_val));
 }
 
+void TreeNode::add_weight(float weight) {
+    TreeNode::Value old_val = value;
+    TreeNode::Value new_val;
+
+    do {
+        new_val = {old_val.total_weight + weight, old_val.total_samples};
+    } while (!value.compare_exchange_weak(old_val, new_val));
+}
+
 MCTS::MCTS(EvaluationFunction evaluate, Board board)
     : MCTS{std::move(evaluate), std::move(board), {}} {}
 
@@ -72,8 +123,8 @@ folly::coro::Task<float> MCTS::sample(int samples) {
     co_return val.total_weight / val.total_samples;
 }
 
-TreeEdge& MCTS::get_best_edge(TreeNode& current) const {
-    return *std::ranges::max_element(current.edges, {}, [&](TreeEdge const& te) {
+TreeEdge* MCTS::get_best_edge(TreeNode& current) const {
+    auto const score = [&](TreeEdge const& te) {
         TreeNode::Value root_val = current.value;  // TODO: load this only once maybe?
         TreeNode* child = te.child;
 
@@ -87,7 +138,10 @@ TreeEdge& MCTS::get_best_edge(TreeNode& current) const {
                 return -kWastedInferencePenalty * active_samples;
             }
 
-            return te.prior * p_root;
+            float const prior = te.prior.load(std::memory_order_relaxed);
+            // Actions without prior are not worth trying, e.g. those that only the fast evaluator
+            // or only the main one have (see MCTS::Options::fast_evaluate).
+            return prior > 0 ? prior * p_root : -std::numeric_limits<float>::infinity();
         }
 
         TreeNode::Value child_val = child->value;
@@ -101,8 +155,14 @@ TreeEdge& MCTS::get_best_edge(TreeNode& current) const {
         child_val.total_samples += active_samples;
 
         return child_val.total_weight / child_val.total_samples +
-               te.prior * p_root / (1 + child_val.total_samples);
-    });
+               te.prior.load(std::memory_order_relaxed) * p_root / (1 + child_val.total_samples);
+    };
+
+    auto const best = std::ranges::max_element(current.edges, {}, score);
+    if (best == current.edges.end() || score(*best) == -std::numeric_limits<float>::infinity()) {
+        return nullptr;
+    }
+    return &*best;
 }
 
 folly::coro::Task<float> MCTS::initialize_child(TreeNode& current, TreeEdge& edge) {
@@ -157,15 +217,25 @@ folly::coro::Task<float> MCTS::sample_rec(TreeNode& current) {
         co_return value;
     }
 
+    // Nodes of the fast evaluator that turned out to matter get the opinion of the main one. Only
+    // one sample does the refinement, while the others keep using the fast priors meanwhile.
+    if (current.fast &&
+        (current.value.load().total_samples >= m_opts.refine_samples ||
+         current.depth - m_root->depth <= m_opts.fast_depth) &&
+        current.fast.exchange(false)) {
+        co_await refine(current);
+    }
+
     // This can happen if our first action in the turn is a move and our only possible second action
     // is to undo that move.
-    if (current.edges.empty()) {
+    TreeEdge* best_edge = get_best_edge(current);
+    if (!best_edge) {
         float value = -2;
         current.add_sample(value);
         co_return value;
     }
 
-    TreeEdge& te = get_best_edge(current);
+    TreeEdge& te = *best_edge;
     ++te.active_samples;
     TreeNode* child = te.child;
     float value = co_await (child == nullptr ? initialize_child(current, te) : sample_rec(*child));
@@ -180,6 +250,26 @@ folly::coro::Task<float> MCTS::sample_rec(TreeNode& current) {
     co_return value;
 }
 
+folly::coro::Task<void> MCTS::refine(TreeNode& node) {
+    Evaluation eval =
+        co_await evaluate_with(m_evaluate, node.board, node.turn, node.previous_position);
+    std::vector<TreeEdge> const edges =
+        eval.compact ? eval.compact->edges(node.board) : std::move(eval.edges);
+
+    // Other samples may be below this node, so the edges are updated in place. They cover all legal
+    // actions (see create_tree_node), so afterwards the priors are exactly those of the main
+    // evaluator.
+    assign_priors(node.edges, edges);
+    if (&node == m_root) {
+        add_root_noise();
+    }
+
+    // The fast value was the first sample of the node. The samples its ancestors got from it are
+    // left as they are.
+    node.add_weight(eval.value - node.fast_value);
+    ++m_refined_evaluations;
+}
+
 void MCTS::move_root(TreeEdge const& edge) {
     m_history.push_back(root_info());
 
@@ -232,7 +322,11 @@ std::optional<Action> MCTS::commit_to_action(float temperature) {
     });
 
     std::discrete_distribution<std::size_t> weight_dist(weights.begin(), weights.end());
-    TreeEdge const& te = m_root->edges[weight_dist(m_twister)];
+    std::size_t const chosen = [&] {
+        std::lock_guard lock{m_random_mutex};
+        return weight_dist(m_twister);
+    }();
+    TreeEdge const& te = m_root->edges[chosen];
 
     if (!te.child) {
         XLOG(WARN, "No explored action available!");
@@ -376,13 +470,18 @@ void MCTS::add_root_noise() {
 
     std::vector<float> samples(m_root->edges.size());
 
-    for (float& s : samples) {
-        total += (s = m_gamma_dist(m_twister));
+    {
+        std::lock_guard lock{m_random_mutex};
+        for (float& s : samples) {
+            total += (s = m_gamma_dist(m_twister));
+        }
     }
 
     for (std::size_t i = 0; i < samples.size(); ++i) {
-        m_root->edges[i].prior = (1 - m_opts.noise_factor) * m_root->edges[i].prior +
-                                 m_opts.noise_factor * samples[i] / total;
+        std::atomic<float>& prior = m_root->edges[i].prior;
+        prior.store((1 - m_opts.noise_factor) * prior.load(std::memory_order_relaxed) +
+                        m_opts.noise_factor * samples[i] / total,
+                    std::memory_order_relaxed);
     }
 }
 
@@ -391,17 +490,45 @@ folly::coro::Task<TreeNode*> MCTS::create_tree_node(
     Turn turn,
     std::optional<PreviousPosition> previous_position,
     TreeNode* parent) {
-    Evaluation eval = co_await m_evaluate(board, turn, previous_position);
+    // The root does not exist yet while the constructor creates it.
+    bool const fast = parent && m_opts.fast_evaluate &&
+                      parent->depth + 1 - m_root->depth > m_opts.fast_depth;
+
+    Evaluation eval = co_await evaluate_with(fast ? m_opts.fast_evaluate : m_evaluate, board, turn,
+                                             previous_position);
+    std::vector<TreeEdge> edges = eval.compact ? eval.compact->edges(board) : std::move(eval.edges);
+    // The main evaluator may want actions the fast one left out, but refine() cannot add edges
+    // while other samples use them.
+    if (fast) {
+        edges = legal_edges(board, turn, previous_position, edges);
+    }
     TreeNode* result = new TreeNode{parent,
                                     std::move(board),
                                     turn,
                                     parent ? parent->depth + 1 : 0,
                                     TreeNode::Value{eval.value, 1},
-                                    std::move(eval.edges)};
+                                    std::move(edges)};
+
+    if (fast) {
+        result->fast = true;
+        result->fast_value = eval.value;
+        result->previous_position = previous_position;
+        ++m_fast_evaluations;
+    }
 
     co_return result;
 }
 
+folly::coro::Task<Evaluation> MCTS::evaluate_with(
+    EvaluationFunction const& function, Board const& board, Turn turn,
+    std::optional<PreviousPosition> previous_position) const {
+    folly::coro::Task<Evaluation> evaluation = function(board, turn, previous_position);
+    if (m_opts.priority != InferencePriority::Normal) {
+        evaluation = with_inference_priority(m_opts.priority, std::move(evaluation));
+    }
+    return evaluation;
+}
+
 MCTS::~MCTS() {
     delete_subtree(*m_root);
 }
@@ -460,3 +587,11 @@ std::vector<NodeInfo> const& MCTS::history() const {
 int MCTS::wasted_inferences() const {
     return m_wasted_inferences;
 }
+
+int MCTS::fast_evaluations() const {
+    return m_fast_evaluations;
+}
+
+int MCTS::refined_evaluations() const {
+    return m_refined_evaluations;
+}
@@ -4,15 +4,20 @@
 #include <folly/futures/Future.h>
 
 #include <atomic>
+#include <mutex>
 #include <random>
 
+#include "compact_evaluation.hpp"
 #include "gamestate.hpp"
+#include "inference_priority.hpp"
 
 struct TreeNode;
 
 struct TreeEdge {
     Action action;
-    float prior;
+    // Atomic since refining a node replaces its priors while other samples read them. Accessed
+    // relaxed, any mix of the old and new priors is fine for selection.
+    std::atomic<float> prior;
     std::atomic<int> active_samples = 0;
     std::atomic<TreeNode*> child = nullptr;
 
@@ -36,7 +41,15 @@ struct TreeNode {
     std::atomic<Value> value;
     std::vector<TreeEdge> edges;
 
+    // Set while the node is only evaluated by MCTS::Options::fast_evaluate, which also needs the
+    // position to evaluate it again with the main evaluator.
+    std::atomic<bool> fast = false;
+    float fast_value = 0;
+    std::optional<PreviousPosition> previous_position = {};
+
     void add_sample(float weight);
+    // Adds to the total weight without counting a sample.
+    void add_weight(float weight);
 };
 
 struct EdgeInfo {
@@ -56,6 +69,8 @@ struct NodeInfo {
 struct Evaluation {
     float value;
     std::vector<TreeEdge> edges;
+    // Cached evaluations are handed out as a shared compact block instead of filling in the edges.
+    CompactEvaluation::Ref compact;
 };
 
 // Coroutine that takes the current board and player turn and "evaluates" it, either by some
@@ -76,6 +91,16 @@ public:
         float active_sample_penalty = 1.0;
         Turn starting_turn = {Player::Red, Turn::First};
         std::uint32_t seed = 42;
+        // Priority of the inference requests issued while evaluating new nodes.
+        InferencePriority priority = InferencePriority::Normal;
+
+        // Two-tier search: if set, nodes more than `fast_depth` plies below the root are expanded
+        // with this cheaper evaluator (e.g. a small network or SimplePolicy). Such nodes are
+        // evaluated again with the main evaluator once they have `refine_samples` samples or the
+        // root gets close enough, which replaces all of their priors.
+        EvaluationFunction fast_evaluate = nullptr;
+        int fast_depth = 4;
+        int refine_samples = 8;
     };
 
     MCTS(EvaluationFunction evaluate, Board board);
@@ -87,6 +112,10 @@ public:
     NodeInfo root_info() const;
     std::vector<NodeInfo> const& history() const;
     int wasted_inferences() const;
+    // Nodes that were expanded with the fast evaluator, and how many of them were evaluated again
+    // with the main one.
+    int fast_evaluations() const;
+    int refined_evaluations() const;
 
     folly::coro::Task<float> sample(int iterations);
 
@@ -123,17 +152,26 @@ private:
     EvaluationFunction m_evaluate;
     TreeNode* m_root;
     Options m_opts;
+    // Refining the root adds noise while other samples run, so the random state is guarded.
+    std::mutex m_random_mutex;
     std::gamma_distribution<float> m_gamma_dist;
     std::mt19937_64 m_twister;
     std::atomic<int> m_wasted_inferences = 0;
+    std::atomic<int> m_fast_evaluations = 0;
+    std::atomic<int> m_refined_evaluations = 0;
     std::atomic<int> m_samples_done = 0;
     std::vector<NodeInfo> m_history;
 
     void add_root_noise();
     folly::coro::Task<void> single_sample();
-    TreeEdge& get_best_edge(TreeNode& current) const;
+    // Null if no edge is worth sampling.
+    TreeEdge* get_best_edge(TreeNode& current) const;
     folly::coro::Task<float> initialize_child(TreeNode& current, TreeEdge& edge);
     folly::coro::Task<float> sample_rec(TreeNode& current);
+    folly::coro::Task<void> refine(TreeNode& node);
+    folly::coro::Task<Evaluation> evaluate_with(
+        EvaluationFunction const& function, Board const& board, Turn turn,
+        std::optional<PreviousPosition> previous_position) const;
     void delete_subtree(TreeNode& node);
     void move_root(TreeEdge const& edge);
 
@@ -1,5 +1,9 @@
 #include "model.hpp"
 
+#include <vector>
+
+#include "host_buffer.hpp"
+
 Model::Model(int batch_size, int channels, int columns, int rows, int move_prior_size)
     : m_batch_size{batch_size},
       m_state_size{columns * rows * channels},
@@ -25,3 +29,12 @@ int Model::move_prior_size() const {
 int Model::prior_size() const {
     return m_wall_prior_size + m_move_prior_size;
 }
+
+void Model::value_inference(std::span<float> states, std::span<float> values) {
+    std::vector<float> priors(values.size() * prior_size());
+    inference(states, {priors, values});
+}
+
+std::shared_ptr<HostAllocator> Model::host_allocator() const {
+    return default_host_allocator();
+}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <memory>
 #include <span>
 
+class HostAllocator;
+
 class Model {
 public:
     struct Output {
@@ -9,8 +12,18 @@ public:
         std::span<float> values;
     };
 
+    // `states` holds between one and batch_size() positions, and `out` has room for exactly as many
+    // results. Backends that can should only compute the positions that were passed.
     virtual void inference(std::span<float> states, Output const& out) = 0;
 
+    // Same as inference, but only computes the values, which lets backends skip the policy head.
+    // The default runs the full inference into scratch priors.
+    virtual void value_inference(std::span<float> states, std::span<float> values);
+
+    // Allocator for the buffers that are passed to inference(). Defaults to
+    // default_host_allocator().
+    virtual std::shared_ptr<HostAllocator> host_allocator() const;
+
     int batch_size() const;
     int state_size() const;
     int wall_prior_size() const;
@@ -0,0 +1,262 @@
+#include "model_host.hpp"
+
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "batched_model_policy.hpp"
+#include "host_buffer.hpp"
+#include "model.hpp"
+#include "state_conversions.hpp"
+
+struct ModelHost::Resident {
+    std::unique_ptr<Model> model;
+    HostBuffer<float> states;
+    HostBuffer<float> values;
+    // Same recycling scheme as the BatchedModel workers. Results keep their slab alive even after
+    // the model has been evicted.
+    SlabPool prior_slabs;
+
+    explicit Resident(std::unique_ptr<Model> loaded)
+        : model{std::move(loaded)},
+          states(model->batch_size() * model->state_size(), model->host_allocator()),
+          values(model->batch_size(), model->host_allocator()),
+          prior_slabs(model->batch_size() * model->prior_size(), model->host_allocator()) {}
+};
+
+ModelHost::ModelHost(ModelLoader loader, ModelHostOptions options)
+    : m_loader{std::move(loader)}, m_options{options} {
+    if (m_options.max_resident_models < 1) {
+        throw std::runtime_error("A model host needs room for at least one model!");
+    }
+    m_scheduler = std::jthread{[this] { run_scheduler(); }};
+}
+
+ModelHost::~ModelHost() {
+    {
+        std::lock_guard lock{m_mutex};
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_scheduler.join();
+}
+
+ModelHost::ModelId ModelHost::add_model(std::string name) {
+    std::lock_guard lock{m_mutex};
+    m_models.push_back(std::make_unique<HostedModel>());
+    m_models.back()->name = std::move(name);
+    return ModelId(m_models.size() - 1);
+}
+
+std::string const& ModelHost::model_name(ModelId id) const {
+    std::lock_guard lock{m_mutex};
+    return m_models.at(id)->name;
+}
+
+folly::SemiFuture<InferenceResult> ModelHost::inference(ModelId id, Board board, Turn turn) {
+    folly::Promise<InferenceResult> promise;
+    auto result = promise.getSemiFuture();
+
+    {
+        std::lock_guard lock{m_mutex};
+        m_models.at(id)->pending.push_back(Request{ModelPosition{std::move(board), turn},
+                                                   std::move(promise),
+                                                   std::chrono::steady_clock::now()});
+    }
+    m_wake.notify_one();
+
+    return result;
+}
+
+std::size_t ModelHost::resident_models() const {
+    return m_resident;
+}
+
+std::size_t ModelHost::total_loads() const {
+    return m_loads;
+}
+
+std::size_t ModelHost::total_evictions() const {
+    return m_evictions;
+}
+
+std::size_t ModelHost::total_batches() const {
+    return m_batches;
+}
+
+std::size_t ModelHost::total_inferences() const {
+    return m_inferences;
+}
+
+void ModelHost::run_scheduler() {
+    std::uint64_t tick = 0;
+    std::vector<Request> batch;
+
+    while (true) {
+        HostedModel* chosen = nullptr;
+        {
+            std::unique_lock lock{m_mutex};
+            m_wake.wait(lock, [&] {
+                return m_stop || std::ranges::any_of(m_models, [](auto const& hosted) {
+                           return !hosted->pending.empty();
+                       });
+            });
+            if (m_stop) {
+                return;
+            }
+
+            // Serve the longest waiting request, but prefer models that are already loaded as long
+            // as nobody has been waiting for too long.
+            HostedModel* oldest = nullptr;
+            HostedModel* oldest_resident = nullptr;
+            for (auto const& hosted : m_models) {
+                if (hosted->pending.empty()) {
+                    continue;
+                }
+                auto older = [&](HostedModel* other) {
+                    return !other ||
+                           hosted->pending.front().enqueued < other->pending.front().enqueued;
+                };
+                if (older(oldest)) {
+                    oldest = hosted.get();
+                }
+                if (hosted->resident && older(oldest_resident)) {
+                    oldest_resident = hosted.get();
+                }
+            }
+
+            chosen = oldest;
+            if (oldest_resident && std::chrono::steady_clock::now() -
+                                           oldest->pending.front().enqueued <
+                                       m_options.max_starvation) {
+                chosen = oldest_resident;
+            }
+        }
+
+        Resident* resident = chosen->resident ? chosen->resident.get() : make_resident(*chosen);
+        if (!resident) {
+            continue;
+        }
+        chosen->last_used = ++tick;
+
+        {
+            std::unique_lock lock{m_mutex};
+            int const batch_size = resident->model->batch_size();
+            auto const min_fill = std::size_t(std::min(m_options.min_batch_fill, batch_size));
+            // Only the scheduler removes requests, so the queue cannot have become empty.
+            auto const deadline = chosen->pending.front().enqueued + m_options.max_wait;
+            m_wake.wait_until(lock, deadline,
+                              [&] { return m_stop || chosen->pending.size() >= min_fill; });
+
+            while (int(batch.size()) < batch_size && !chosen->pending.empty()) {
+                batch.push_back(std::move(chosen->pending.front()));
+                chosen->pending.pop_front();
+            }
+        }
+
+        run_batch(*resident, batch);
+        batch.clear();
+    }
+}
+
+ModelHost::Resident* ModelHost::make_resident(HostedModel& hosted) {
+    if (int(m_resident) >= m_options.max_resident_models) {
+        HostedModel* victim = nullptr;
+        {
+            std::lock_guard lock{m_mutex};
+            for (auto const& other : m_models) {
+                if (other->resident && (!victim || other->last_used < victim->last_used)) {
+                    victim = other.get();
+                }
+            }
+        }
+
+        XLOGF(DBG, "Evicting model {} to load {}", victim->name, hosted.name);
+        victim->resident.reset();
+        --m_resident;
+        ++m_evictions;
+    }
+
+    try {
+        XLOGF(INFO, "Loading model {}", hosted.name);
+        hosted.resident = std::make_unique<Resident>(m_loader(hosted.name));
+    } catch (std::exception const&) {
+        XLOGF(ERR, "Failed to load model {}", hosted.name);
+        folly::exception_wrapper error{std::current_exception()};
+
+        std::deque<Request> failed;
+        {
+            std::lock_guard lock{m_mutex};
+            failed.swap(hosted.pending);
+        }
+        for (Request& request : failed) {
+            request.promise.setException(error);
+        }
+        return nullptr;
+    }
+
+    ++m_resident;
+    ++m_loads;
+    return hosted.resident.get();
+}
+
+void ModelHost::run_batch(Resident& resident, std::vector<Request>& batch) {
+    Model& model = *resident.model;
+    std::vector<folly::Promise<InferenceResult>> promises;
+
+    for (Request& request : batch) {
+        std::span<float> slot{resident.states.data() + model.state_size() * promises.size(),
+                              std::size_t(model.state_size())};
+        try {
+            fill_model_input(request.position.board, request.position.turn, slot);
+        } catch (std::exception const&) {
+            request.promise.setException(folly::exception_wrapper{std::current_exception()});
+            continue;
+        }
+        promises.push_back(std::move(request.promise));
+    }
+
+    if (promises.empty()) {
+        return;
+    }
+
+    auto priors = resident.prior_slabs.acquire();
+    try {
+        std::size_t const filled = promises.size();
+        model.inference(std::span<float>(resident.states).first(filled * model.state_size()),
+                        {std::span<float>(*priors).first(filled * model.prior_size()),
+                         std::span<float>(resident.values).first(filled)});
+    } catch (std::exception const&) {
+        folly::exception_wrapper error{std::current_exception()};
+        for (auto& promise : promises) {
+            promise.setException(error);
+        }
+        return;
+    }
+
+    for (std::size_t i = 0; i < promises.size(); ++i) {
+        std::span<float const> prior{priors->data() + model.prior_size() * i,
+                                     std::size_t(model.prior_size())};
+        promises[i].setValue(InferenceResult{priors, prior, resident.values[i]});
+    }
+
+    m_batches += 1;
+    m_inferences += promises.size();
+}
+
+HostedModelPolicy::HostedModelPolicy(std::shared_ptr<ModelHost> host, ModelHost::ModelId id,
+                                     bool boost_mouse_priors)
+    : m_host{std::move(host)}, m_id{id}, m_boost_mouse_priors{boost_mouse_priors} {}
+
+folly::coro::Task<Evaluation> HostedModelPolicy::operator()(
+    Board const& board, Turn turn, std::optional<PreviousPosition> previous_position) {
+    auto inference_result = co_await m_host->inference(m_id, board, turn);
+
+    // The priors hold the walls followed by the moves. Which models are loaded can change at any
+    // time, so the number of move priors is taken from the result itself.
+    int const move_prior_size =
+        int(inference_result.prior.size()) - 2 * board.columns() * board.rows();
+    co_return evaluation_from_inference(board, turn, previous_position, inference_result,
+                                        move_prior_size, m_boost_mouse_priors);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <folly/experimental/coro/Task.h>
+#include <folly/futures/Future.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batched_model.hpp"
+#include "mcts.hpp"
+
+class Model;
+
+// Loads the model with the given name (typically a path). Only ever called on the scheduler thread.
+using ModelLoader = std::function<std::unique_ptr<Model>(std::string const& name)>;
+
+struct ModelHostOptions {
+    // At most this many models are loaded at once. The least recently used one is evicted to make
+    // room for another. Ranking plays several matchups at once and needs two models for each, so
+    // the default fits four matchups or an incremental round against up to seven anchors.
+    int max_resident_models = 8;
+    // Same as in BatchingOptions, but per model.
+    int min_batch_fill = 1;
+    std::chrono::microseconds max_wait{0};
+    // Models that are already loaded are served first, unless a request for another model has been
+    // waiting for longer than this.
+    std::chrono::milliseconds max_starvation{200};
+};
+
+// Serves inference for many models (e.g. all the checkpoints of a ranking) from a single scheduler
+// thread, instead of one BatchedModel with its own workers and queue per model. Models are only
+// loaded while they are in use.
+//
+// Requests are queued per model. The scheduler repeatedly picks a model with waiting requests
+// (loaded ones first, otherwise the one that has waited longest), loads it if necessary and runs
+// one batch of its requests. Loads stay rare as long as at most max_resident_models models play at
+// any time, which is why ranking only starts matchups that fit (see
+// RankingPlayOptions::max_models_in_flight).
+class ModelHost {
+public:
+    using ModelId = int;
+
+    explicit ModelHost(ModelLoader loader, ModelHostOptions options = {});
+    ~ModelHost();
+
+    ModelHost(ModelHost const& other) = delete;
+    ModelHost& operator=(ModelHost const& other) = delete;
+
+    // Registers a model without loading it.
+    ModelId add_model(std::string name);
+    std::string const& model_name(ModelId id) const;
+
+    // Fails the result (rather than the call) if the model cannot be loaded.
+    folly::SemiFuture<InferenceResult> inference(ModelId id, Board board, Turn turn);
+
+    std::size_t resident_models() const;
+    std::size_t total_loads() const;
+    std::size_t total_evictions() const;
+    std::size_t total_batches() const;
+    std::size_t total_inferences() const;
+
+private:
+    struct Request {
+        ModelPosition position;
+        folly::Promise<InferenceResult> promise;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct Resident;
+
+    struct HostedModel {
+        std::string name;
+        std::deque<Request> pending;
+        // Only touched by the scheduler thread.
+        std::unique_ptr<Resident> resident;
+        std::uint64_t last_used = 0;
+    };
+
+    ModelLoader m_loader;
+    ModelHostOptions m_options;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    // Pointers so that models stay put when more are added.
+    std::vector<std::unique_ptr<HostedModel>> m_models;
+    bool m_stop = false;
+
+    std::atomic<std::size_t> m_resident = 0;
+    std::atomic<std::size_t> m_loads = 0;
+    std::atomic<std::size_t> m_evictions = 0;
+    std::atomic<std::size_t> m_batches = 0;
+    std::atomic<std::size_t> m_inferences = 0;
+
+    // Needs to come last so everything else is still alive while we join it.
+    std::jthread m_scheduler;
+
+    void run_scheduler();
+    Resident* make_resident(HostedModel& hosted);
+    void run_batch(Resident& resident, std::vector<Request>& batch);
+};
+
+// Evaluation function for one of the models of a ModelHost.
+class HostedModelPolicy {
+public:
+    HostedModelPolicy(std::shared_ptr<ModelHost> host, ModelHost::ModelId id,
+                      bool boost_mouse_priors = false);
+
+    folly::coro::Task<Evaluation> operator()(Board const& board, Turn turn,
+                                             std::optional<PreviousPosition> previous_position);
+
+private:
+    std::shared_ptr<ModelHost> m_host;
+    ModelHost::ModelId m_id;
+    bool m_boost_mouse_priors;
+};
@@ -0,0 +1,352 @@
+#include "onnx_graph.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+// Protobuf field numbers of the messages we need (see onnx.proto).
+constexpr int kModelGraph = 7;
+constexpr int kGraphNode = 1;
+constexpr int kGraphInitializer = 5;
+constexpr int kGraphInput = 11;
+constexpr int kGraphOutput = 12;
+constexpr int kNodeInput = 1;
+constexpr int kNodeOutput = 2;
+constexpr int kNodeOpType = 4;
+constexpr int kNodeAttribute = 5;
+constexpr int kAttributeName = 1;
+constexpr int kAttributeFloat = 2;
+constexpr int kAttributeInt = 3;
+constexpr int kAttributeInts = 8;
+constexpr int kTensorDims = 1;
+constexpr int kTensorDataType = 2;
+constexpr int kTensorFloatData = 4;
+constexpr int kTensorName = 8;
+constexpr int kTensorRawData = 9;
+constexpr int kTensorDataLocation = 14;
+constexpr int kValueInfoName = 1;
+constexpr int kValueInfoType = 2;
+constexpr int kTypeTensor = 1;
+constexpr int kTensorTypeShape = 2;
+constexpr int kShapeDim = 1;
+constexpr int kDimValue = 1;
+
+constexpr std::int64_t kFloatType = 1;
+
+enum class WireType {
+    Varint = 0,
+    Fixed64 = 1,
+    LengthDelimited = 2,
+    Fixed32 = 5,
+};
+
+struct ProtoField {
+    int number;
+    WireType type;
+    std::uint64_t varint;
+    std::string_view bytes;
+};
+
+// Iterates over the fields of a serialized protobuf message.
+class ProtoReader {
+public:
+    explicit ProtoReader(std::string_view message) : m_message{message} {}
+
+    bool next(ProtoField& field) {
+        if (m_pos == m_message.size()) {
+            return false;
+        }
+
+        std::uint64_t const key = read_varint();
+        field.number = int(key >> 3);
+        field.type = WireType(key & 7);
+
+        switch (field.type) {
+            case WireType::Varint:
+                field.varint = read_varint();
+                break;
+            case WireType::Fixed64:
+                field.bytes = read_bytes(8);
+                break;
+            case WireType::LengthDelimited:
+                field.bytes = read_bytes(read_varint());
+                break;
+            case WireType::Fixed32:
+                field.bytes = read_bytes(4);
+                break;
+            default:
+                throw std::runtime_error("Unsupported protobuf wire type in ONNX file!");
+        }
+
+        return true;
+    }
+
+private:
+    std::string_view m_message;
+    std::size_t m_pos = 0;
+
+    std::uint64_t read_varint() {
+        std::uint64_t result = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_pos == m_message.size()) {
+                break;
+            }
+            auto const byte = std::uint8_t(m_message[m_pos++]);
+            result |= std::uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return result;
+            }
+        }
+        throw std::runtime_error("Truncated varint in ONNX file!");
+    }
+
+    std::string_view read_bytes(std::uint64_t size) {
+        if (size > m_message.size() - m_pos) {
+            throw std::runtime_error("Truncated field in ONNX file!");
+        }
+        auto const bytes = m_message.substr(m_pos, size);
+        m_pos += size;
+        return bytes;
+    }
+};
+
+// Repeated integer fields may or may not be packed.
+static void read_ints(ProtoField const& field, std::vector<std::int64_t>& out) {
+    if (field.type == WireType::Varint) {
+        out.push_back(std::int64_t(field.varint));
+        return;
+    }
+
+    std::string_view rest = field.bytes;
+    while (!rest.empty()) {
+        std::uint64_t value = 0;
+        std::size_t i = 0;
+        for (int shift = 0;; shift += 7, ++i) {
+            if (i == rest.size() || shift >= 64) {
+                throw std::runtime_error("Truncated packed varint in ONNX file!");
+            }
+            auto const byte = std::uint8_t(rest[i]);
+            value |= std::uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        out.push_back(std::int64_t(value));
+        rest.remove_prefix(i + 1);
+    }
+}
+
+// Reads (a run of) little endian floats.
+static void read_floats(ProtoField const& field, std::vector<float>& out) {
+    std::size_t const count = field.bytes.size() / sizeof(float);
+    std::size_t const offset = out.size();
+    out.resize(offset + count);
+    std::memcpy(out.data() + offset, field.bytes.data(), count * sizeof(float));
+}
+
+static std::pair<std::string, OnnxTensor> parse_tensor(std::string_view message) {
+    std::string name;
+    OnnxTensor tensor;
+    std::int64_t data_type = 0;
+
+    ProtoReader reader{message};
+    ProtoField field;
+    while (reader.next(field)) {
+        switch (field.number) {
+            case kTensorDims:
+                read_ints(field, tensor.dims);
+                break;
+            case kTensorDataType:
+                data_type = std::int64_t(field.varint);
+                break;
+            case kTensorFloatData:
+            case kTensorRawData:
+                // Packed or not, these are little endian floats.
+                read_floats(field, tensor.data);
+                break;
+            case kTensorName:
+                name = field.bytes;
+                break;
+            case kTensorDataLocation:
+                if (field.varint != 0) {
+                    throw std::runtime_error("ONNX tensors with external data are not supported!");
+                }
+                break;
+        }
+    }
+
+    if (data_type != kFloatType) {
+        throw std::runtime_error("Unsupported data type of ONNX tensor " + name);
+    }
+
+    std::int64_t expected_size = 1;
+    for (std::int64_t dim : tensor.dims) {
+        expected_size *= dim;
+    }
+    if (std::int64_t(tensor.data.size()) != expected_size) {
+        throw std::runtime_error("Size of ONNX tensor " + name + " does not match its shape!");
+    }
+
+    return {std::move(name), std::move(tensor)};
+}
+
+static std::pair<std::string, OnnxAttribute> parse_attribute(std::string_view message) {
+    std::string name;
+    OnnxAttribute attribute;
+
+    ProtoReader reader{message};
+    ProtoField field;
+    while (reader.next(field)) {
+        switch (field.number) {
+            case kAttributeName:
+                name = field.bytes;
+                break;
+            case kAttributeFloat:
+                std::memcpy(&attribute.f, field.bytes.data(), sizeof(float));
+                break;
+            case kAttributeInt:
+                attribute.i = std::int64_t(field.varint);
+                break;
+            case kAttributeInts:
+                read_ints(field, attribute.ints);
+                break;
+        }
+    }
+
+    return {std::move(name), std::move(attribute)};
+}
+
+static OnnxNode parse_node(std::string_view message) {
+    OnnxNode node;
+
+    ProtoReader reader{message};
+    ProtoField field;
+    while (reader.next(field)) {
+        switch (field.number) {
+            case kNodeInput:
+                node.inputs.emplace_back(field.bytes);
+                break;
+            case kNodeOutput:
+                node.outputs.emplace_back(field.bytes);
+                break;
+            case kNodeOpType:
+                node.op_type = field.bytes;
+                break;
+            case kNodeAttribute:
+                node.attributes.insert(parse_attribute(field.bytes));
+                break;
+        }
+    }
+
+    return node;
+}
+
+// Finds the (only) field with the given number in a message.
+static std::string_view sub_message(std::string_view message, int number) {
+    ProtoReader reader{message};
+    ProtoField field;
+    while (reader.next(field)) {
+        if (field.number == number && field.type == WireType::LengthDelimited) {
+            return field.bytes;
+        }
+    }
+    return {};
+}
+
+static OnnxValueInfo parse_value_info(std::string_view message) {
+    OnnxValueInfo info;
+
+    ProtoReader reader{message};
+    ProtoField field;
+    while (reader.next(field)) {
+        if (field.number == kValueInfoName) {
+            info.name = field.bytes;
+        } else if (field.number == kValueInfoType) {
+            auto const shape = sub_message(sub_message(field.bytes, kTypeTensor), kTensorTypeShape);
+
+            ProtoReader dims{shape};
+            ProtoField dim;
+            while (dims.next(dim)) {
+                if (dim.number != kShapeDim) {
+                    continue;
+                }
+
+                std::int64_t value = -1;
+                ProtoReader dim_reader{dim.bytes};
+                ProtoField dim_field;
+                while (dim_reader.next(dim_field)) {
+                    if (dim_field.number == kDimValue) {
+                        value = std::int64_t(dim_field.varint);
+                    }
+                }
+                info.dims.push_back(value);
+            }
+        }
+    }
+
+    return info;
+}
+
+OnnxTensor const& OnnxGraph::initializer(std::string const& name) const {
+    auto it = initializers.find(name);
+    if (it == initializers.end()) {
+        throw std::runtime_error("Missing ONNX initializer " + name);
+    }
+    return it->second;
+}
+
+OnnxNode const* OnnxGraph::producer(std::string const& tensor) const {
+    for (OnnxNode const& node : nodes) {
+        if (std::ranges::find(node.outputs, tensor) != node.outputs.end()) {
+            return &node;
+        }
+    }
+    return nullptr;
+}
+
+OnnxGraph parse_onnx_graph(std::string_view model_proto) {
+    auto const graph_message = sub_message(model_proto, kModelGraph);
+    if (graph_message.empty()) {
+        throw std::runtime_error("ONNX file does not contain a graph!");
+    }
+
+    OnnxGraph graph;
+    ProtoReader reader{graph_message};
+    ProtoField field;
+    while (reader.next(field)) {
+        switch (field.number) {
+            case kGraphNode:
+                graph.nodes.push_back(parse_node(field.bytes));
+                break;
+            case kGraphInitializer:
+                graph.initializers.insert(parse_tensor(field.bytes));
+                break;
+            case kGraphInput:
+                graph.inputs.push_back(parse_value_info(field.bytes));
+                break;
+            case kGraphOutput:
+                graph.outputs.push_back(parse_value_info(field.bytes));
+                break;
+        }
+    }
+
+    // Older exporters also list the initializers as graph inputs.
+    std::erase_if(graph.inputs, [&](OnnxValueInfo const& input) {
+        return graph.initializers.contains(input.name);
+    });
+
+    return graph;
+}
+
+OnnxGraph read_onnx_graph(std::filesystem::path const& path) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
+        throw std::runtime_error("Failed to open ONNX file " + path.string());
+    }
+
+    std::string const contents{std::istreambuf_iterator<char>{file}, {}};
+    return parse_onnx_graph(contents);
+}
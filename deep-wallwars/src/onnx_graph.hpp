@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Just enough of the ONNX format to load the networks exported by scripts/training.py without
+// depending on protobuf: float initializers, the nodes with their attributes and the shapes of the
+// graph inputs and outputs.
+
+struct OnnxTensor {
+    std::vector<std::int64_t> dims;
+    std::vector<float> data;
+};
+
+struct OnnxAttribute {
+    float f = 0.0f;
+    std::int64_t i = 0;
+    std::vector<std::int64_t> ints;
+};
+
+struct OnnxNode {
+    std::string op_type;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    std::unordered_map<std::string, OnnxAttribute> attributes;
+};
+
+struct OnnxValueInfo {
+    std::string name;
+    // Symbolic dimensions are -1.
+    std::vector<std::int64_t> dims;
+};
+
+struct OnnxGraph {
+    // In topological order.
+    std::vector<OnnxNode> nodes;
+    std::unordered_map<std::string, OnnxTensor> initializers;
+    std::vector<OnnxValueInfo> inputs;
+    std::vector<OnnxValueInfo> outputs;
+
+    // Throws if the tensor is missing.
+    OnnxTensor const& initializer(std::string const& name) const;
+    // The node producing the given tensor, or nullptr for graph inputs and initializers.
+    OnnxNode const* producer(std::string const& tensor) const;
+};
+
+OnnxGraph read_onnx_graph(std::filesystem::path const& path);
+OnnxGraph parse_onnx_graph(std::string_view model_proto);
@@ -0,0 +1,197 @@
+#include "opening_suite.hpp"
+
+#include <folly/Synchronized.h>
+#include <folly/experimental/coro/Collect.h>
+#include <folly/logging/xlog.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <ranges>
+#include <sstream>
+#include <stdexcept>
+
+#include "engine_adapter.hpp"
+
+using json = nlohmann::json;
+
+namespace views = std::ranges::views;
+
+static void play_moves(Board& board, engine_adapter::PaddingConfig const& padding,
+                       std::vector<std::string> const& moves, std::string const& name) {
+    if (moves.size() % 2 != 0) {
+        throw std::runtime_error("Opening " + name + " has an odd number of moves.");
+    }
+
+    for (std::size_t i = 0; i < moves.size(); ++i) {
+        Player const player = i % 2 == 0 ? Player::Red : Player::Blue;
+        auto move = engine_adapter::parse_move_notation(moves[i], board, {player, Turn::First},
+                                                        padding);
+        if (!move) {
+            throw std::runtime_error("Opening " + name + " has an invalid move: " + moves[i]);
+        }
+
+        for (Action action : {move->first, move->second}) {
+            auto const legal_actions = board.legal_actions(player);
+            if (std::ranges::find(legal_actions, action) == legal_actions.end()) {
+                throw std::runtime_error("Opening " + name + " has an illegal move: " + moves[i]);
+            }
+            board.do_action(player, action);
+        }
+        if (board.winner() != Winner::Undecided) {
+            throw std::runtime_error("Opening " + name + " ends the game.");
+        }
+    }
+}
+
+static Opening notation_opening(std::string const& notation, Board const& board) {
+    std::istringstream stream{notation};
+    std::vector<std::string> moves;
+    for (std::string move; stream >> move;) {
+        moves.push_back(move);
+    }
+
+    Opening opening{notation, board};
+    auto const padding = engine_adapter::create_padding_config(
+        board.rows(), board.columns(), board.rows(), board.columns(), board.variant());
+    play_moves(opening.board, padding, moves, opening.name);
+    return opening;
+}
+
+static Opening parse_opening(json const& entry, Board const& board, std::string name) {
+    if (entry.is_string()) {
+        return notation_opening(entry.get<std::string>(), board);
+    }
+    if (!entry.is_object()) {
+        throw std::runtime_error("Opening " + name + " is neither a BGS config nor notation.");
+    }
+
+    name = entry.value("name", name);
+    auto const validation =
+        engine_adapter::validate_bgs_config(entry, board.rows(), board.columns());
+    if (!validation.valid) {
+        throw std::runtime_error("Opening " + name + ": " + validation.error_message);
+    }
+
+    auto [opening_board, turn, padding] =
+        engine_adapter::convert_bgs_config_to_board(entry, board.rows(), board.columns());
+    if (opening_board.variant() != board.variant()) {
+        throw std::runtime_error("Opening " + name + " is for a different variant.");
+    }
+
+    play_moves(opening_board, padding, entry.value("moves", std::vector<std::string>{}), name);
+    return {name, opening_board};
+}
+
+std::vector<Opening> load_opening_suite(std::filesystem::path const& path, Board const& board) {
+    std::ifstream file{path};
+    if (!file) {
+        throw std::runtime_error("Could not open opening suite " + path.string() + ".");
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string const text = contents.str();
+
+    std::vector<Opening> openings;
+    auto const first = text.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && text[first] == '[') {
+        json const entries = json::parse(text);
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            openings.push_back(parse_opening(entries[i], board, "#" + std::to_string(i + 1)));
+        }
+    } else {
+        std::istringstream lines{text};
+        int line_number = 0;
+        for (std::string line; std::getline(lines, line);) {
+            ++line_number;
+            auto const start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#') {
+                continue;
+            }
+
+            std::string const name = "line " + std::to_string(line_number);
+            if (line[start] == '{') {
+                openings.push_back(parse_opening(json::parse(line), board, name));
+            } else {
+                auto const end = line.find_last_not_of(" \t\r");
+                openings.push_back(notation_opening(line.substr(start, end - start + 1), board));
+            }
+        }
+    }
+
+    if (openings.empty()) {
+        throw std::runtime_error("Opening suite " + path.string() + " has no openings.");
+    }
+    return openings;
+}
+
+static folly::coro::Task<> search_opening(EvaluationFunction model, Board board, int samples,
+                                          int max_parallel_samples) {
+    MCTS mcts{std::move(model),
+              std::move(board),
+              {.max_parallelism = max_parallel_samples, .priority = InferencePriority::Background}};
+    co_await mcts.sample(samples);
+}
+
+OpeningCache::OpeningCache(Map evaluations) : m_evaluations{std::move(evaluations)} {}
+
+folly::coro::Task<std::shared_ptr<OpeningCache const>> OpeningCache::build(
+    EvaluationFunction model, std::vector<Opening> const& openings, int samples,
+    int max_parallel_samples) {
+    folly::Synchronized<Map> evaluations;
+
+    // Keeps everything the searches ask for.
+    EvaluationFunction recording_model =
+        [&](Board const& board, Turn turn,
+            std::optional<PreviousPosition> previous_position) -> folly::coro::Task<Evaluation> {
+        Evaluation eval = co_await model(board, turn, previous_position);
+        CompactEvaluation::Ref compact =
+            eval.compact ? eval.compact : CompactEvaluation::make(board, eval.value, eval.edges);
+        evaluations.wlock()->try_emplace(CacheEntry{board, turn, previous_position},
+                                         std::move(compact));
+        co_return eval;
+    };
+
+    auto* executor = co_await folly::coro::co_current_executor;
+    co_await folly::coro::collectAllRange(
+        openings | views::transform([&](Opening const& opening) {
+            return search_opening(recording_model, opening.board, samples, max_parallel_samples)
+                .scheduleOn(executor);
+        }));
+
+    auto cache = std::shared_ptr<OpeningCache const>(
+        new OpeningCache{std::move(*evaluations.wlock())});
+    XLOGF(INFO, "Cached {} evaluations from the search trees of {} openings.", cache->size(),
+          openings.size());
+    co_return cache;
+}
+
+std::optional<Evaluation> OpeningCache::find(
+    Board const& board, Turn turn, std::optional<PreviousPosition> const& previous_position) const {
+    auto it = m_evaluations.find(CacheEntryView{board, turn, previous_position});
+    if (it == m_evaluations.end()) {
+        return std::nullopt;
+    }
+    ++m_hits;
+    return Evaluation{it->second->value(), {}, it->second};
+}
+
+std::size_t OpeningCache::size() const {
+    return m_evaluations.size();
+}
+
+int OpeningCache::hits() const {
+    return m_hits;
+}
+
+OpeningCachePolicy::OpeningCachePolicy(EvaluationFunction evaluate,
+                                       std::shared_ptr<OpeningCache const> cache)
+    : m_evaluate{std::move(evaluate)}, m_cache{std::move(cache)} {}
+
+folly::coro::Task<Evaluation> OpeningCachePolicy::operator()(
+    Board const& board, Turn turn, std::optional<PreviousPosition> previous_position) {
+    if (auto cached = m_cache->find(board, turn, previous_position)) {
+        co_return std::move(*cached);
+    }
+    co_return co_await m_evaluate(board, turn, previous_position);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <folly/experimental/coro/Task.h>
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "evaluation_cache.hpp"
+#include "mcts.hpp"
+
+// A start position for evaluation and ranking games. Red is always to move.
+struct Opening {
+    std::string name;
+    Board board;
+};
+
+// Reads a suite of openings for games on `board` (which gives the dimensions and the variant).
+// Each line of the file is one opening, either
+// - a BGS config in JSON ({"variant", "boardWidth", "boardHeight", "initialState"}), which may be
+//   smaller than the board and is then padded like in the engine, with optional "moves" played
+//   from it and an optional "name", or
+// - moves separated by spaces (e.g. "Cb2.Mh7 Cg7.>d4"), played from `board`.
+// Moves use the notation of BGS sessions, where row 1 is the top row.
+// Alternatively, the whole file is a JSON array of such configs and notation strings. Empty lines
+// and lines starting with # are skipped. Openings need an even number of moves, so that Red moves
+// next. Throws if the file cannot be read or an opening is invalid.
+std::vector<Opening> load_opening_suite(std::filesystem::path const& path, Board const& board);
+
+// The evaluations of a model in the search trees of a set of openings. It is built once before the
+// games and read-only afterwards, so all games share it without locks and without the evictions
+// of a CachedPolicy.
+class OpeningCache {
+public:
+    // Searches each opening with `samples` samples and keeps every evaluation of the model.
+    static folly::coro::Task<std::shared_ptr<OpeningCache const>> build(
+        EvaluationFunction model, std::vector<Opening> const& openings, int samples,
+        int max_parallel_samples);
+
+    std::optional<Evaluation> find(Board const& board, Turn turn,
+                                   std::optional<PreviousPosition> const& previous_position) const;
+
+    std::size_t size() const;
+    int hits() const;
+
+private:
+    using Map = folly::F14FastMap<CacheEntry, CompactEvaluation::Ref,
+                                  folly::HeterogeneousAccessHash<CacheEntry>,
+                                  folly::HeterogeneousAccessEqualTo<CacheEntry>>;
+
+    explicit OpeningCache(Map evaluations);
+
+    Map m_evaluations;
+    mutable std::atomic<int> m_hits = 0;
+};
+
+// Answers from an opening cache and asks the model about everything else.
+class OpeningCachePolicy {
+public:
+    OpeningCachePolicy(EvaluationFunction evaluate, std::shared_ptr<OpeningCache const> cache);
+
+    folly::coro::Task<Evaluation> operator()(Board const& board, Turn turn,
+                                             std::optional<PreviousPosition> previous_position);
+
+private:
+    EvaluationFunction m_evaluate;
+    std::shared_ptr<OpeningCache const> m_cache;
+};
@@ -2,16 +2,25 @@
 
 #include <folly/experimental/coro/Collect.h>
 #include <folly/experimental/coro/Task.h>
+#include <folly/futures/SharedPromise.h>
 #include <folly/logging/xlog.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <random>
 #include <ranges>
 
+#include "elo.hpp"
 #include "game_recorder.hpp"
 #include "mcts.hpp"
+#include "opening_suite.hpp"
+#include "sprt.hpp"
 
 namespace views = std::ranges::views;
 
@@ -97,12 +106,14 @@ folly::coro::Task<GameResult> training_play_single(Board const& board, Evaluatio
     MCTS mcts1{evaluate1,
                board,
                {.max_parallelism = opts.max_parallel_samples,
-                .seed = opts.seed * static_cast<std::uint32_t>(index)}};
+                .seed = opts.seed * static_cast<std::uint32_t>(index),
+                .priority = InferencePriority::Background}};
 
     MCTS mcts2{evaluate2,
                board,
                {.max_parallelism = opts.max_parallel_samples,
-                .seed = opts.seed * static_cast<std::uint32_t>(index)}};
+                .seed = opts.seed * static_cast<std::uint32_t>(index),
+                .priority = InferencePriority::Background}};
 
     XLOGF(INFO, "Starting game {}.", index);
 
@@ -158,25 +169,45 @@ folly::coro::Task<GameResult> training_play_single(Board const& board, Evaluatio
     co_return {Winner::Undecided, mcts1.wasted_inferences() + mcts2.wasted_inferences()};
 }
 
-folly::coro::Task<GameRecorder> evaluation_play_single(Board const& board, int index,
-                                                       EvaluationPlayOptions opts) {
+// The opening of game `index`, which it shares with the other game of its pair.
+static Opening const* game_opening(int index, EvaluationPlayOptions const& opts) {
+    if (!opts.openings) {
+        return nullptr;
+    }
+    std::size_t const pair = opts.first_opening + (index - 1) / 2;
+    return &(*opts.openings)[pair % opts.openings->size()];
+}
+
+// Returns nothing if the game is cancelled before it is over.
+folly::coro::Task<std::optional<GameRecorder>> evaluation_play_single(
+    Board const& initial_board, int index, EvaluationPlayOptions opts,
+    std::atomic<bool> const* cancelled = nullptr) {
     auto const& red = index % 2 == 0 ? opts.model1 : opts.model2;
     auto const& blue = index % 2 == 0 ? opts.model2 : opts.model1;
-
-    MCTS mcts1{red.model,
-               board,
-               {.max_parallelism = opts.max_parallel_samples,
-                .seed = opts.seed * static_cast<std::uint32_t>(index)}};
-
-    MCTS mcts2{blue.model,
-               board,
-               {.max_parallelism = opts.max_parallel_samples,
-                .seed = opts.seed * static_cast<std::uint32_t>(index)}};
-
-    XLOGF(INFO, "Starting game {} with {} as red and {} as blue.", index, red.name, blue.name);
+    Opening const* opening = game_opening(index, opts);
+    Board const& board = opening ? opening->board : initial_board;
+
+    auto mcts_options = [&](NamedModel const& model) {
+        return MCTS::Options{.max_parallelism = opts.max_parallel_samples,
+                             .seed = opts.seed * static_cast<std::uint32_t>(index),
+                             .priority = InferencePriority::Background,
+                             .fast_evaluate = model.fast_model,
+                             .fast_depth = opts.fast_depth,
+                             .refine_samples = opts.refine_samples};
+    };
+    MCTS mcts1{red.model, board, mcts_options(red)};
+    MCTS mcts2{blue.model, board, mcts_options(blue)};
+
+    XLOGF(INFO, "Starting game {} with {} as red and {} as blue{}.", index, red.name, blue.name,
+          opening ? " from opening " + opening->name : "");
     GameRecorder recorder(board, red.name, blue.name);
 
     for (int num_moves = 1; opts.move_limit == 0 || num_moves <= opts.move_limit; ++num_moves) {
+        if (cancelled && *cancelled) {
+            XLOGF(INFO, "Game {} was cancelled.", index);
+            co_return std::nullopt;
+        }
+
         auto move1 = co_await mcts1.sample_and_commit_to_move(opts.samples);
         if (!move1) {
             recorder.record_winner(Winner::Blue);
@@ -210,16 +241,149 @@ folly::coro::Task<GameRecorder> evaluation_play_single(Board const& board, int i
     co_return recorder;
 }
 
+// State of an evaluation with a sequential probability ratio test, shared by its pairs of games.
+struct SprtMatch {
+    explicit SprtMatch(SprtOptions const& opts) : sprt{opts} {}
+
+    Sprt sprt;
+    std::mutex mutex;
+    // Set once the test is over, which cancels the games that are still running.
+    std::atomic<bool> concluded = false;
+};
+
+// Points of model1 in half points, as counted by Sprt::add_pair. Games that hit the move limit
+// count as draws.
+static int half_points(GameRecorder const& recorder, bool model1_red) {
+    switch (recorder.winner()) {
+        case Winner::Red:
+            return model1_red ? 2 : 0;
+        case Winner::Blue:
+            return model1_red ? 0 : 2;
+        default:
+            return 1;
+    }
+}
+
+// Plays games 2 * pair - 1 and 2 * pair, which start from the same position with swapped colors.
+folly::coro::Task<std::vector<GameRecorder>> evaluation_play_pair(
+    Board const& board, int pair, EvaluationPlayOptions const& opts, SprtMatch& match) {
+    if (match.concluded) {
+        co_return {};
+    }
+
+    auto* executor = co_await folly::coro::co_current_executor;
+    auto [first, second] = co_await folly::coro::collectAll(
+        evaluation_play_single(board, 2 * pair - 1, opts, &match.concluded).scheduleOn(executor),
+        evaluation_play_single(board, 2 * pair, opts, &match.concluded).scheduleOn(executor));
+    if (!first || !second) {
+        co_return {};
+    }
+
+    // evaluation_play_single lets model1 start the even games.
+    int const points = half_points(*first, false) + half_points(*second, true);
+    {
+        std::lock_guard lock{match.mutex};
+        // Pairs that finish after the verdict do not change it.
+        if (!match.concluded) {
+            match.sprt.add_pair(points);
+            if (match.sprt.result() != SprtResult::Continue) {
+                match.concluded = true;
+            }
+        }
+    }
+
+    std::vector<GameRecorder> recorders;
+    recorders.push_back(std::move(*first));
+    recorders.push_back(std::move(*second));
+    co_return recorders;
+}
+
+folly::coro::Task<std::vector<GameRecorder>> sprt_evaluation_play(
+    Board const& board, int games, EvaluationPlayOptions const& opts) {
+    auto* executor = co_await folly::coro::co_current_executor;
+    SprtMatch match{*opts.sprt};
+
+    // Games are played in pairs with swapped colors, and `games` is the maximum.
+    int const pairs = games / 2;
+    if (games % 2 != 0) {
+        XLOGF(WARN, "SPRT plays whole pairs of games, so it plays at most {} games instead of {}.",
+              2 * pairs, games);
+    }
+    auto pair_tasks =
+        views::iota(1, pairs + 1) | views::transform([&](int pair) {
+            return evaluation_play_pair(board, pair, opts, match).scheduleOn(executor);
+        });
+    auto results = co_await folly::coro::collectAllWindowed(
+        pair_tasks, std::max(1, opts.max_parallel_games / 2));
+
+    std::vector<GameRecorder> recorders;
+    for (auto& pair_recorders : results) {
+        recorders.insert(recorders.end(), std::make_move_iterator(pair_recorders.begin()),
+                         std::make_move_iterator(pair_recorders.end()));
+    }
+
+    Sprt const& sprt = match.sprt;
+    auto const& pentanomial = sprt.pentanomial();
+    SprtResult const result = sprt.result();
+    XLOGF(INFO, "SPRT of {} against {} with Elo bounds [{}, {}]: {} after {} of {} pairs.",
+          opts.model1.name, opts.model2.name, opts.sprt->elo0, opts.sprt->elo1,
+          result == SprtResult::AcceptH1   ? "accepted H1"
+          : result == SprtResult::AcceptH0 ? "accepted H0"
+                                           : "inconclusive",
+          sprt.pairs(), pairs);
+    XLOGF(INFO, "Pentanomial {}/{}/{}/{}/{}, LLR {:.2f} in [{:.2f}, {:.2f}], {:.1f} Elo.",
+          pentanomial[0], pentanomial[1], pentanomial[2], pentanomial[3], pentanomial[4],
+          sprt.llr(), sprt.lower_bound(), sprt.upper_bound(), sprt.elo());
+    co_return recorders;
+}
+
+// Lets the model answer from a cache of its evaluations in the search trees of the openings.
+static folly::coro::Task<std::shared_ptr<OpeningCache const>> warm_opening_cache(
+    NamedModel& model, std::vector<Opening> const& openings, int samples,
+    int max_parallel_samples) {
+    XLOGF(INFO, "Searching {} openings with {}.", openings.size(), model.name);
+    auto cache = co_await OpeningCache::build(model.model, openings, samples, max_parallel_samples);
+    model.model = OpeningCachePolicy{std::move(model.model), cache};
+    co_return cache;
+}
+
+static void log_opening_cache_hits(std::shared_ptr<OpeningCache const> const& cache,
+                                   std::string const& name) {
+    XLOGF(INFO, "The opening cache of {} answered {} evaluations.", name, cache->hits());
+}
+
 folly::coro::Task<std::vector<GameRecorder>> evaluation_play(Board board, int games,
                                                              EvaluationPlayOptions opts) {
-    auto* executor = co_await folly::coro::co_current_executor;
-    auto game_tasks = views::iota(1, games + 1) | views::transform([&](int i) {
-                          return evaluation_play_single(board, i, opts).scheduleOn(executor);
-                      });
+    std::shared_ptr<OpeningCache const> cache1;
+    std::shared_ptr<OpeningCache const> cache2;
+    if (opts.openings && opts.opening_samples > 0) {
+        cache1 = co_await warm_opening_cache(opts.model1, *opts.openings, opts.opening_samples,
+                                             opts.max_parallel_samples);
+        cache2 = co_await warm_opening_cache(opts.model2, *opts.openings, opts.opening_samples,
+                                             opts.max_parallel_samples);
+    }
 
-    auto results = co_await folly::coro::collectAllWindowed(game_tasks, opts.max_parallel_games);
+    std::vector<GameRecorder> recorders;
+    if (opts.sprt) {
+        recorders = co_await sprt_evaluation_play(board, games, opts);
+    } else {
+        auto* executor = co_await folly::coro::co_current_executor;
+        auto game_tasks = views::iota(1, games + 1) | views::transform([&](int i) {
+                              return evaluation_play_single(board, i, opts).scheduleOn(executor);
+                          });
+
+        auto results =
+            co_await folly::coro::collectAllWindowed(game_tasks, opts.max_parallel_games);
+        for (auto& recorder : results) {
+            recorders.push_back(std::move(*recorder));
+        }
+    }
 
-    co_return results;
+    if (cache1) {
+        log_opening_cache_hits(cache1, opts.model1.name);
+        log_opening_cache_hits(cache2, opts.model2.name);
+    }
+    co_return recorders;
 }
 
 folly::coro::Task<> training_play(Board board, int games, TrainingPlayOptions opts) {
@@ -257,44 +421,163 @@ folly::coro::Task<> training_play(Board board, int games, TrainingPlayOptions op
     XLOGF(INFO, "{} inferences were wasted.", wasted_inferences);
 }
 
-folly::coro::Task<std::pair<std::vector<size_t>, std::vector<GameRecorder>>> run_tournament_round(
-    Board const& board, std::vector<size_t> const& model_indices, RankingPlayOptions const& opts) {
-    auto* executor = co_await folly::coro::co_current_executor;
-    std::vector<size_t> next_round;
-    std::vector<GameRecorder> round_recorders;
+// Results of one matchup of a tournament round, tallied as its games complete.
+struct Matchup {
+    size_t model1_idx = 0;
+    size_t model2_idx = 0;
+    EvaluationPlayOptions eval_opts;
 
-    for (size_t i = 0; i < model_indices.size() - 1; i += 2) {
-        size_t model1_idx = model_indices[i];
-        size_t model2_idx = model_indices[i + 1];
+    std::atomic<int> model1_wins = 0;
+    std::atomic<int> model2_wins = 0;
+    std::atomic<int> draws = 0;
+    std::atomic<int> remaining_games = 0;
+};
 
-        XLOGF(INFO, "Starting matchup between {} and {}", opts.models[model1_idx].name,
-              opts.models[model2_idx].name);
+// Lets the matchups of a round start in order, but only while the models of all matchups in play
+// number at most max_models_in_flight. The ModelHost serving them only keeps a few models loaded,
+// and games of any further models would stall while it reloads engines back and forth.
+class MatchupAdmission {
+public:
+    MatchupAdmission(std::vector<Matchup> const& matchups, int max_models)
+        : m_matchups{matchups}, m_max_models{max_models}, m_started(matchups.size()) {
+        start_next();
+    }
 
-        EvaluationPlayOptions eval_opts{
-            .model1 = opts.models[model1_idx],
-            .model2 = opts.models[model2_idx],
-            .samples = opts.samples,
-            .max_parallel_samples = opts.max_parallel_samples,
-            .move_limit = opts.move_limit,
-            .seed = static_cast<std::uint32_t>(opts.seed * (model1_idx + 1) * (model2_idx + 1))};
+    folly::coro::Task<> wait(size_t matchup_idx) {
+        co_await m_started[matchup_idx].getSemiFuture();
+    }
 
-        auto game_tasks =
-            views::iota(0, opts.games_per_matchup) | views::transform([&](int game_idx) {
-                return evaluation_play_single(board, game_idx, eval_opts).scheduleOn(executor);
-            });
-        auto matchup_recorders = co_await folly::coro::collectAllWindowed(std::move(game_tasks),
-                                                                          opts.max_parallel_games);
+    void finish(size_t matchup_idx) {
+        {
+            std::lock_guard lock{m_mutex};
+            Matchup const& matchup = m_matchups[matchup_idx];
+            for (size_t model_idx : {matchup.model1_idx, matchup.model2_idx}) {
+                if (--m_in_flight[model_idx] == 0) {
+                    m_in_flight.erase(model_idx);
+                }
+            }
+        }
+        start_next();
+    }
 
-        auto results = tally_results(matchup_recorders);
-        auto const& model1_results = results[opts.models[model1_idx].name];
-        auto const& model2_results = results[opts.models[model2_idx].name];
+private:
+    std::vector<Matchup> const& m_matchups;
+    int m_max_models;
+    std::vector<folly::SharedPromise<folly::Unit>> m_started;
+
+    std::mutex m_mutex;
+    size_t m_next = 0;
+    // Number of matchups in play for each model.
+    std::map<size_t, int> m_in_flight;
+
+    void start_next() {
+        std::vector<size_t> started;
+        {
+            std::lock_guard lock{m_mutex};
+            for (; m_next < m_matchups.size(); ++m_next) {
+                Matchup const& matchup = m_matchups[m_next];
+                size_t const models = m_in_flight.size() +
+                                      !m_in_flight.contains(matchup.model1_idx) +
+                                      !m_in_flight.contains(matchup.model2_idx);
+                // A matchup always starts if nothing else is in play, even if the limit is tiny.
+                if (m_max_models > 0 && !m_in_flight.empty() && int(models) > m_max_models) {
+                    break;
+                }
+                ++m_in_flight[matchup.model1_idx];
+                ++m_in_flight[matchup.model2_idx];
+                started.push_back(m_next);
+            }
+        }
 
-        int model1_score = model1_results.wins + model1_results.draws / 2;
-        int model2_score = model2_results.wins + model2_results.draws / 2;
+        for (size_t matchup_idx : started) {
+            XLOGF(INFO, "Starting matchup between {} and {}",
+                  m_matchups[matchup_idx].eval_opts.model1.name,
+                  m_matchups[matchup_idx].eval_opts.model2.name);
+            m_started[matchup_idx].setValue();
+        }
+    }
+};
 
-        next_round.push_back(model1_score >= model2_score ? model1_idx : model2_idx);
-        round_recorders.insert(round_recorders.end(), matchup_recorders.begin(),
-                               matchup_recorders.end());
+folly::coro::Task<GameRecorder> play_matchup_game(Board const& board, Matchup& matchup,
+                                                  MatchupAdmission& admission, size_t matchup_idx,
+                                                  int game_idx) {
+    co_await admission.wait(matchup_idx);
+    auto recorder = *co_await evaluation_play_single(board, game_idx, matchup.eval_opts);
+
+    // evaluation_play_single lets model1 start the even games.
+    bool const model1_red = game_idx % 2 == 0;
+    if (recorder.winner() == Winner::Draw) {
+        ++matchup.draws;
+    } else if (recorder.winner() == Winner::Red) {
+        ++(model1_red ? matchup.model1_wins : matchup.model2_wins);
+    } else if (recorder.winner() == Winner::Blue) {
+        ++(model1_red ? matchup.model2_wins : matchup.model1_wins);
+    }
+
+    if (--matchup.remaining_games == 0) {
+        XLOGF(INFO, "Finished matchup between {} and {}: {} / {} / {}",
+              matchup.eval_opts.model1.name, matchup.eval_opts.model2.name,
+              matchup.model1_wins.load(), matchup.model2_wins.load(), matchup.draws.load());
+        admission.finish(matchup_idx);
+    }
+    co_return recorder;
+}
+
+static void start_matchup(Matchup& matchup, size_t model1_idx, size_t model2_idx,
+                          RankingPlayOptions const& opts) {
+    matchup.model1_idx = model1_idx;
+    matchup.model2_idx = model2_idx;
+    auto const seed = static_cast<std::uint32_t>(opts.seed * (model1_idx + 1) * (model2_idx + 1));
+    matchup.eval_opts = EvaluationPlayOptions{
+        .model1 = opts.models[model1_idx],
+        .model2 = opts.models[model2_idx],
+        .samples = opts.samples,
+        .max_parallel_samples = opts.max_parallel_samples,
+        .move_limit = opts.move_limit,
+        .openings = opts.openings,
+        .first_opening = opts.openings ? int(seed % opts.openings->size()) : 0,
+        .seed = seed};
+    matchup.remaining_games = opts.games_per_matchup;
+}
+
+// The games of all matchups share one window, so that max_parallel_games games stay in flight
+// rather than only the games of one matchup. Matchups are admitted into the window in order while
+// their models fit into max_models_in_flight (see MatchupAdmission). Games of matchups that have
+// not started yet wait in the window, which cannot hold up the earlier matchups since their games
+// all entered the window before.
+folly::coro::Task<std::vector<GameRecorder>> play_matchups(Board const& board,
+                                                           std::vector<Matchup>& matchups,
+                                                           RankingPlayOptions const& opts) {
+    auto* executor = co_await folly::coro::co_current_executor;
+    MatchupAdmission admission{matchups, opts.max_models_in_flight};
+
+    // Games are numbered from 1 like in evaluation_play, so that pairs share their opening.
+    int const games = int(matchups.size()) * opts.games_per_matchup;
+    auto game_tasks = views::iota(0, games) | views::transform([&](int i) {
+                          size_t const matchup_idx = i / opts.games_per_matchup;
+                          return play_matchup_game(board, matchups[matchup_idx], admission,
+                                                   matchup_idx, i % opts.games_per_matchup + 1)
+                              .scheduleOn(executor);
+                      });
+    co_return co_await folly::coro::collectAllWindowed(std::move(game_tasks),
+                                                       opts.max_parallel_games);
+}
+
+folly::coro::Task<std::pair<std::vector<size_t>, std::vector<GameRecorder>>> run_tournament_round(
+    Board const& board, std::vector<size_t> const& model_indices, RankingPlayOptions const& opts) {
+    std::vector<Matchup> matchups(model_indices.size() / 2);
+    for (size_t i = 0; i < matchups.size(); ++i) {
+        start_matchup(matchups[i], model_indices[2 * i], model_indices[2 * i + 1], opts);
+    }
+    auto round_recorders = co_await play_matchups(board, matchups, opts);
+
+    std::vector<size_t> next_round;
+    for (Matchup const& matchup : matchups) {
+        int model1_score = matchup.model1_wins + matchup.draws / 2;
+        int model2_score = matchup.model2_wins + matchup.draws / 2;
+
+        next_round.push_back(model1_score >= model2_score ? matchup.model1_idx
+                                                          : matchup.model2_idx);
     }
 
     if (model_indices.size() % 2 == 1) {
@@ -327,8 +610,10 @@ folly::coro::Task<std::vector<GameRecorder>> run_tournament(Board const& board,
     co_return recorders;
 }
 
-folly::coro::Task<std::vector<GameRecorder>> ranking_play(Board board, RankingPlayOptions opts) {
+static folly::coro::Task<std::vector<GameRecorder>> rank_in_tournaments(Board const& board,
+                                                                        RankingPlayOptions opts) {
     std::vector<GameRecorder> all_recorders;
+    BayesElo elo;
 
     for (int i = 0; i < opts.num_tournaments; ++i) {
         XLOGF(INFO, "Starting tournament {}/{}", i + 1, opts.num_tournaments);
@@ -340,9 +625,16 @@ folly::coro::Task<std::vector<GameRecorder>> ranking_play(Board board, RankingPl
         std::ofstream json_file{opts.output_folder / "games.json", std::ios_base::app};
         json_file << json;
 
-        std::string pgn = all_to_pgn(tournament_recorders);
-        std::ofstream pgn_file{opts.output_folder / "games.pgn", std::ios_base::app};
-        pgn_file << pgn;
+        // Re-rate after every tournament, so the ratings are usable while the ranking goes on.
+        elo.add_games(tournament_recorders);
+        EloRatings const ratings = elo.estimate();
+        write_ratings(ratings, opts.output_folder / "elo_ratings.txt");
+        XLOGF(INFO, "Rated {} games, Red advantage {:.0f} Elo, draw Elo {:.0f}", elo.rated_games(),
+              ratings.advantage, ratings.draw_elo);
+        for (PlayerRating const& player : ratings.players | views::take(3)) {
+            XLOGF(INFO, "{}: {:.0f} Elo (-{:.0f}/+{:.0f})", player.name, player.elo,
+                  player.elo - player.lower, player.upper - player.elo);
+        }
 
         all_recorders.insert(all_recorders.end(), tournament_recorders.begin(),
                              tournament_recorders.end());
@@ -350,3 +642,149 @@ folly::coro::Task<std::vector<GameRecorder>> ranking_play(Board board, RankingPl
 
     co_return all_recorders;
 }
+
+// Anchors for a new model are picked with ratings up to this far from its current estimate.
+constexpr double kAnchorSpread = 200;
+
+// Picks `count` of the rated models (model index and rating) with ratings spread evenly around
+// `elo`.
+static std::vector<size_t> spread_anchors(std::vector<std::pair<size_t, double>> const& rated,
+                                          double elo, int count) {
+    std::vector<size_t> anchors;
+    std::vector<bool> taken(rated.size(), false);
+    for (int i = 0; i < std::min(count, int(rated.size())); ++i) {
+        double const target = count == 1 ? elo : elo + kAnchorSpread * (2.0 * i / (count - 1) - 1);
+        std::size_t best = rated.size();
+        for (std::size_t j = 0; j < rated.size(); ++j) {
+            if (!taken[j] && (best == rated.size() || std::abs(rated[j].second - target) <
+                                                          std::abs(rated[best].second - target))) {
+                best = j;
+            }
+        }
+        taken[best] = true;
+        anchors.push_back(rated[best].first);
+    }
+    return anchors;
+}
+
+static folly::coro::Task<std::vector<GameRecorder>> rank_new_models(Board const& board,
+                                                                    RankingPlayOptions opts) {
+    auto const ratings_path = opts.output_folder / "elo_ratings.txt";
+    auto const games_path = opts.output_folder / "games.json";
+    if (!std::filesystem::exists(ratings_path)) {
+        throw std::runtime_error("Incremental ranking needs the ratings of an earlier ranking in " +
+                                 ratings_path.string() + ".");
+    }
+
+    // The earlier ratings stay fixed, the earlier games still count for the advantage of Red, the
+    // draw rate and models that already played some games.
+    std::vector<PlayerRating> ratings = read_ratings(ratings_path);
+    BayesElo elo;
+    for (PlayerRating const& rating : ratings) {
+        elo.fix_rating(rating.name, rating.elo);
+    }
+    if (std::filesystem::exists(games_path)) {
+        for (GameOutcome const& game : read_game_outcomes(games_path)) {
+            elo.add_game(game.red, game.blue, game.winner);
+        }
+    }
+
+    std::vector<std::pair<size_t, double>> rated;
+    std::vector<size_t> new_models;
+    for (size_t i = 0; i < opts.models.size(); ++i) {
+        auto it = std::ranges::find(ratings, opts.models[i].name, &PlayerRating::name);
+        if (it == ratings.end()) {
+            new_models.push_back(i);
+        } else {
+            rated.push_back({i, it->elo});
+        }
+    }
+    XLOGF(INFO, "Read {} ratings and {} rated games. Rating {} new models against {} anchors.",
+          ratings.size(), elo.rated_games(), new_models.size(), rated.size());
+    if (rated.empty() && !new_models.empty()) {
+        throw std::runtime_error("None of the rated models is there to play the new ones.");
+    }
+
+    std::vector<GameRecorder> all_recorders;
+    std::uint32_t const seed = opts.seed;
+    int round = 0;
+    for (size_t model_idx : new_models) {
+        std::string const& name = opts.models[model_idx].name;
+        // The latest rated model is usually the previous generation, which is a good first guess.
+        double estimate = rated.back().second;
+        std::optional<PlayerRating> rating;
+        EloRatings estimated{.players = {}, .advantage = 0, .draw_elo = 0, .iterations = 0};
+        int games = 0;
+
+        while (games < opts.max_games_per_model) {
+            opts.seed = seed + ++round;
+            auto const anchors = spread_anchors(rated, estimate, opts.anchors);
+            std::vector<Matchup> matchups(anchors.size());
+            for (size_t i = 0; i < anchors.size(); ++i) {
+                start_matchup(matchups[i], model_idx, anchors[i], opts);
+            }
+            auto recorders = co_await play_matchups(board, matchups, opts);
+            if (recorders.empty()) {
+                // Nothing will change in the next round either.
+                break;
+            }
+            games += int(recorders.size());
+
+            std::ofstream json_file{games_path, std::ios_base::app};
+            json_file << all_to_json(recorders);
+            elo.add_games(recorders);
+            all_recorders.insert(all_recorders.end(), recorders.begin(), recorders.end());
+
+            estimated = elo.estimate();
+            auto it = std::ranges::find(estimated.players, name, &PlayerRating::name);
+            if (it == estimated.players.end()) {
+                // No decided games yet.
+                continue;
+            }
+            rating = *it;
+            estimate = rating->elo;
+            XLOGF(INFO, "{}: {:.0f} Elo (-{:.0f}/+{:.0f}) after {} games", name, rating->elo,
+                  rating->elo - rating->lower, rating->upper - rating->elo, games);
+            if (rating->upper - rating->lower < opts.target_interval) {
+                break;
+            }
+        }
+
+        if (!rating) {
+            XLOGF(WARN, "{} has no decided games after {} games and stays unrated.", name, games);
+            continue;
+        }
+
+        // Later new models play against this one with its rating fixed as well.
+        elo.fix_rating(name, rating->elo);
+        rated.push_back({model_idx, rating->elo});
+        ratings.push_back(*rating);
+        std::ranges::sort(ratings, std::greater{}, &PlayerRating::elo);
+        write_ratings({.players = ratings,
+                       .advantage = estimated.advantage,
+                       .draw_elo = estimated.draw_elo,
+                       .iterations = estimated.iterations},
+                      ratings_path);
+    }
+
+    co_return all_recorders;
+}
+
+folly::coro::Task<std::vector<GameRecorder>> ranking_play(Board board, RankingPlayOptions opts) {
+    std::vector<std::shared_ptr<OpeningCache const>> caches;
+    if (opts.openings && opts.opening_samples > 0) {
+        for (NamedModel& model : opts.models) {
+            caches.push_back(co_await warm_opening_cache(model, *opts.openings,
+                                                         opts.opening_samples,
+                                                         opts.max_parallel_samples));
+        }
+    }
+
+    auto all_recorders = opts.incremental ? co_await rank_new_models(board, opts)
+                                          : co_await rank_in_tournaments(board, opts);
+
+    for (std::size_t i = 0; i < caches.size(); ++i) {
+        log_opening_cache_hits(caches[i], opts.models[i].name);
+    }
+    co_return all_recorders;
+}
@@ -4,10 +4,14 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <optional>
 
 #include "game_recorder.hpp"
 #include "gamestate.hpp"
 #include "mcts.hpp"
+#include "opening_suite.hpp"
+#include "sprt.hpp"
 
 // Called once for each game with the winner after the MCTS has finished. Can be used to output
 // training data.
@@ -16,6 +20,8 @@ using CompletionCallback = std::function<void(MCTS const&, int)>;
 struct NamedModel {
     EvaluationFunction model;
     std::string name;
+    // Two-tier search (see MCTS::Options::fast_evaluate).
+    EvaluationFunction fast_model = nullptr;
 };
 
 struct InteractivePlayOptions {
@@ -51,6 +57,19 @@ struct EvaluationPlayOptions {
     int max_parallel_games = 128;
     int max_parallel_samples = 16;
     int move_limit = 100;
+    // For models with a fast_model.
+    int fast_depth = 4;
+    int refine_samples = 8;
+    // Test model1 against model2 over pairs of games with swapped colors, and stop as soon as the
+    // test concludes. The number of games is then only the maximum.
+    std::optional<SprtOptions> sprt = std::nullopt;
+    // Start positions instead of the board. Games 2k - 1 and 2k start from opening
+    // first_opening + k - 1 (wrapping around) with swapped colors.
+    std::shared_ptr<std::vector<Opening> const> openings = nullptr;
+    int first_opening = 0;
+    // Searches each opening with this many samples per model before the games and shares the
+    // evaluations between all games (see OpeningCache). 0 turns this off.
+    int opening_samples = 0;
 
     std::uint32_t seed = 42;
 };
@@ -65,6 +84,21 @@ struct RankingPlayOptions {
     int max_parallel_games = 128;
     int max_parallel_samples = 32;
     int move_limit = 100;
+    // As in EvaluationPlayOptions. Each matchup starts at a random opening, and the caches are
+    // built once for all tournaments.
+    std::shared_ptr<std::vector<Opening> const> openings = nullptr;
+    int opening_samples = 0;
+    // Instead of tournaments, only rate the models that have no rating in elo_ratings.txt yet,
+    // against rated models whose ratings stay fixed. Each round plays games_per_matchup games
+    // against each of `anchors` rated models spread around the current estimate, until the
+    // rating interval of the new model is narrower than target_interval.
+    bool incremental = false;
+    int anchors = 6;
+    double target_interval = 100;
+    int max_games_per_model = 400;
+    // Matchups only start while the models of all matchups in play number at most this many. Set
+    // it to the resident limit of the ModelHost serving the models (0 for no limit).
+    int max_models_in_flight = 0;
 
     std::uint32_t seed = 42;
 };
@@ -76,5 +110,7 @@ folly::coro::Task<> training_play(Board board, int games, TrainingPlayOptions op
 folly::coro::Task<std::vector<GameRecorder>> evaluation_play(Board board, int games,
                                                              EvaluationPlayOptions opts);
 
-// Generates random tournaments between the models to generate ranking games for bayeselo.
+// Plays random tournaments between the models (or rates new models, see
+// RankingPlayOptions::incremental). Appends the games to games.json in the output folder and keeps
+// elo_ratings.txt there up to date with the ratings of all games so far.
 folly::coro::Task<std::vector<GameRecorder>> ranking_play(Board board, RankingPlayOptions opts);
\ No newline at end of file
@@ -80,7 +80,7 @@ folly::coro::Task<Evaluation> SimplePolicy::operator()(Board const& board, Turn
 
     if (total_prior > 0.0f) {
         for (TreeEdge& te : edges) {
-            te.prior *= m_move_prior / total_prior;
+            te.prior = te.prior * m_move_prior / total_prior;
         }
     }
 
@@ -0,0 +1,104 @@
+#include "sprt.hpp"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Added to the count of each outcome when estimating the distribution of pairs. Without it, the
+// first few pairs would seem to have (almost) no variance and end the test right away.
+constexpr double kPseudoPairs = 0.5;
+
+static double expected_score(double elo) {
+    return 1 / (1 + std::pow(10.0, -elo / 400));
+}
+
+Sprt::Sprt(SprtOptions opts) : m_opts{opts} {
+    if (!(opts.alpha > 0 && opts.alpha < 1 && opts.beta > 0 && opts.beta < 1)) {
+        throw std::runtime_error("SPRT alpha and beta have to be between 0 and 1.");
+    }
+    if (!(opts.elo0 < opts.elo1)) {
+        throw std::runtime_error("SPRT elo0 has to be less than elo1.");
+    }
+}
+
+void Sprt::add_pair(int half_points) {
+    if (half_points < 0 || half_points > 4) {
+        throw std::runtime_error("A pair of games has between 0 and 4 half points.");
+    }
+    ++m_pentanomial[half_points];
+    ++m_pairs;
+}
+
+int Sprt::pairs() const {
+    return m_pairs;
+}
+
+std::array<int, 5> const& Sprt::pentanomial() const {
+    return m_pentanomial;
+}
+
+double Sprt::score() const {
+    if (m_pairs == 0) {
+        return 0.5;
+    }
+    double points = 0;
+    for (int i = 0; i < 5; ++i) {
+        points += m_pentanomial[i] * i * 0.25;
+    }
+    return points / m_pairs;
+}
+
+double Sprt::elo() const {
+    double const s = score();
+    if (s <= 0 || s >= 1) {
+        return s <= 0 ? -std::numeric_limits<double>::infinity()
+                      : std::numeric_limits<double>::infinity();
+    }
+    return -400 * std::log10(1 / s - 1);
+}
+
+double Sprt::llr() const {
+    if (m_pairs == 0) {
+        return 0;
+    }
+
+    std::array<double, 5> frequencies;
+    double total = 0;
+    for (int i = 0; i < 5; ++i) {
+        frequencies[i] = m_pentanomial[i] + kPseudoPairs;
+        total += frequencies[i];
+    }
+
+    double mean = 0;
+    for (int i = 0; i < 5; ++i) {
+        frequencies[i] /= total;
+        mean += frequencies[i] * i * 0.25;
+    }
+    double variance = 0;
+    for (int i = 0; i < 5; ++i) {
+        variance += frequencies[i] * (i * 0.25 - mean) * (i * 0.25 - mean);
+    }
+
+    double const score0 = expected_score(m_opts.elo0);
+    double const score1 = expected_score(m_opts.elo1);
+    return m_pairs * (score1 - score0) * (2 * mean - score0 - score1) / (2 * variance);
+}
+
+double Sprt::lower_bound() const {
+    return std::log(m_opts.beta / (1 - m_opts.alpha));
+}
+
+double Sprt::upper_bound() const {
+    return std::log((1 - m_opts.beta) / m_opts.alpha);
+}
+
+SprtResult Sprt::result() const {
+    double const ratio = llr();
+    if (ratio >= upper_bound()) {
+        return SprtResult::AcceptH1;
+    }
+    if (ratio <= lower_bound()) {
+        return SprtResult::AcceptH0;
+    }
+    return SprtResult::Continue;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+
+struct SprtOptions {
+    // Elo of the tested model relative to its opponent under the null hypothesis and under the
+    // alternative hypothesis.
+    double elo0 = 0;
+    double elo1 = 10;
+    // Probability of accepting the alternative when the null hypothesis holds, and vice versa.
+    double alpha = 0.05;
+    double beta = 0.05;
+};
+
+enum class SprtResult { Continue, AcceptH0, AcceptH1 };
+
+// Sequential probability ratio test of the Elo of a model over pairs of games with swapped colors.
+// Pairs are counted in a pentanomial (0 to 4 half points for the model) instead of counting single
+// games, which takes the correlation of the games of a pair (such as the advantage of moving
+// first) into account and lets the test conclude after fewer games. The log-likelihood ratio is the
+// usual normal approximation of the generalized SPRT.
+class Sprt {
+public:
+    explicit Sprt(SprtOptions opts = {});
+
+    // The points of the tested model in both games of a pair in half points: 2 for a win, 1 for a
+    // draw and 0 for a loss, so between 0 and 4.
+    void add_pair(int half_points);
+
+    int pairs() const;
+    std::array<int, 5> const& pentanomial() const;
+
+    // Average points per game of the tested model, and the Elo difference that corresponds to.
+    double score() const;
+    double elo() const;
+
+    double llr() const;
+    // The test accepts the null hypothesis below the lower bound and the alternative above the
+    // upper bound.
+    double lower_bound() const;
+    double upper_bound() const;
+    SprtResult result() const;
+
+private:
+    SprtOptions m_opts;
+    std::array<int, 5> m_pentanomial{};
+    int m_pairs = 0;
+};
@@ -2,8 +2,12 @@
 
 #include <folly/Overload.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 ModelOutput convert_to_model_output(NodeInfo const& node_info, float score_for_red,
                                     float winner_contribution) {
@@ -46,24 +50,32 @@ ModelOutput convert_to_model_output(NodeInfo const& node_info, float score_for_r
 }
 
 std::vector<float> convert_to_model_input(Board const& board, Turn turn) {
+    std::vector<float> state(kModelInputChannels * board.columns() * board.rows());
+    fill_model_input(board, turn, state);
+    return state;
+}
+
+void fill_model_input(Board const& board, Turn turn, std::span<float> state) {
     std::size_t board_size = board.columns() * board.rows();
-    std::vector<float> state(9 * board_size);
+    if (state.size() != kModelInputChannels * board_size) {
+        throw std::runtime_error("Model input size does not match board size!");
+    }
+
+    auto plane = [&](int channel) { return state.subspan(channel * board_size, board_size); };
 
     auto blocked_directions = board.blocked_directions();
     std::vector<std::pair<Cell, int>> queue_vec;
     std::fill(state.begin(), state.begin() + 4 * board_size, 1.0f);
-    board.fill_relative_distances(board.position(turn.player), {state.begin(), board_size},
-                                  blocked_directions, queue_vec);
-    board.fill_relative_distances(board.goal(turn.player), {state.begin() + board_size, board_size},
-                                  blocked_directions, queue_vec);
-
-    board.fill_relative_distances(board.position(other_player(turn.player)),
-                                  {state.begin() + 2 * board_size, board_size}, blocked_directions,
+    board.fill_relative_distances(board.position(turn.player), plane(0), blocked_directions,
                                   queue_vec);
-    board.fill_relative_distances(board.goal(other_player(turn.player)),
-                                  {state.begin() + 3 * board_size, board_size}, blocked_directions,
+    board.fill_relative_distances(board.goal(turn.player), plane(1), blocked_directions,
                                   queue_vec);
 
+    board.fill_relative_distances(board.position(other_player(turn.player)), plane(2),
+                                  blocked_directions, queue_vec);
+    board.fill_relative_distances(board.goal(other_player(turn.player)), plane(3),
+                                  blocked_directions, queue_vec);
+
     for (int column = 0; column < board.columns(); ++column) {
         for (int row = 0; row < board.rows(); ++row) {
             Cell cell{column, row};
@@ -74,20 +86,33 @@ std::vector<float> convert_to_model_input(Board const& board, Turn turn) {
         }
     }
 
-    if (turn.action == Turn::Second) {
-        std::fill(state.begin() + 6 * board_size, state.begin() + 7 * board_size, 1.0);
-    }
+    std::ranges::fill(plane(6), turn.action == Turn::Second ? 1.0f : 0.0f);
 
     // Model needs to know if it is red because of draws
-    if (turn.player == Player::Red) {
-        std::fill(state.begin() + 7 * board_size, state.begin() + 8 * board_size, 1.0);
+    std::ranges::fill(plane(7), turn.player == Player::Red ? 1.0f : 0.0f);
+
+    std::ranges::fill(plane(8), board.allows_mouse_moves() ? 1.0f : 0.0f);
+}
+
+void fill_legal_actions(Board const& board, Turn turn, std::span<std::uint8_t> legal) {
+    int const board_size = board.columns() * board.rows();
+    int const wall_prior_size = 2 * board_size;
+    if (int(legal.size()) < wall_prior_size + board.move_prior_size()) {
+        throw std::runtime_error("Legal action buffer is too small for the board!");
     }
 
+    std::ranges::fill(legal, 0);
+    for (Wall wall : board.legal_walls()) {
+        legal[int(wall.type) * board_size + board.index_from_cell(wall.cell)] = 1;
+    }
+    for (Direction dir : board.legal_directions(turn.player, Pawn::Cat)) {
+        legal[wall_prior_size + int(dir)] = 1;
+    }
     if (board.allows_mouse_moves()) {
-        std::fill(state.begin() + 8 * board_size, state.end(), 1.0);
+        for (Direction dir : board.legal_directions(turn.player, Pawn::Mouse)) {
+            legal[wall_prior_size + 4 + int(dir)] = 1;
+        }
     }
-
-    return state;
 }
 
 void print_training_data_point(std::ostream& out_stream, ModelInput const& model_input,
@@ -101,6 +126,30 @@ void print_training_data_point(std::ostream& out_stream, ModelInput const& model
     out_stream << model_output.value << "\n\n";
 }
 
+std::vector<ModelInput> read_training_inputs(std::istream& in_stream) {
+    std::vector<ModelInput> inputs;
+    std::string line;
+    // Each data point is an input line, a prior line and a value line, followed by an empty line.
+    int line_in_point = 0;
+    while (std::getline(in_stream, line)) {
+        if (line.empty()) {
+            line_in_point = 0;
+            continue;
+        }
+
+        if (line_in_point++ == 0) {
+            std::istringstream line_stream{line};
+            ModelInput& input = inputs.emplace_back();
+            float value;
+            while (line_stream >> value) {
+                input.push_back(value);
+                line_stream.ignore(1, ',');
+            }
+        }
+    }
+    return inputs;
+}
+
 TrainingDataPrinter::TrainingDataPrinter(std::filesystem::path directory, float winner_contribution)
     : m_directory{std::move(directory)}, m_winner_contribution{winner_contribution} {
     std::filesystem::create_directory(m_directory);
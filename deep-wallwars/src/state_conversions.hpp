@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <iosfwd>
+#include <span>
 #include <vector>
 
 #include "gamestate.hpp"
@@ -14,6 +16,9 @@ struct ModelOutput {
 
 using ModelInput = std::vector<float>;
 
+// Number of planes (each of size columns * rows) in the model input.
+constexpr int kModelInputChannels = 9;
+
 // Converts current position in the MCTS tree into the output that we would have expected from the
 // ML model. This is used for training. The expected output value is a convex combination of the
 // actual winner and the MCTS value.
@@ -23,11 +28,23 @@ ModelOutput convert_to_model_output(NodeInfo const& node_info, float score_for_r
 // Converts current board state into a vector of [0, 1] floats so it can be used for ML models.
 ModelInput convert_to_model_input(Board const& board, Turn turn);
 
+// Same as above but writes into an existing buffer of exactly kModelInputChannels * columns * rows
+// floats (e.g. a slot of a batch buffer). Every entry is overwritten so buffers can be reused.
+void fill_model_input(Board const& board, Turn turn, std::span<float> state);
+
+// Flags the legal actions for `turn` in `legal`, which has one entry per model prior (walls, then
+// cat moves, then mouse moves, as read by evaluation_from_inference). Legal actions are set to 1,
+// all others to 0.
+void fill_legal_actions(Board const& board, Turn turn, std::span<std::uint8_t> legal);
+
 // Print a single training data point (input, expected output) to `out_stream`. These will be read
 // in from Python for training.
 void print_training_data_point(std::ostream& out_stream, ModelInput const& input,
                                ModelOutput const& model_output);
 
+// Reads back the inputs of the data points printed by print_training_data_point.
+std::vector<ModelInput> read_training_inputs(std::istream& in_stream);
+
 class TrainingDataPrinter {
 public:
     TrainingDataPrinter(std::filesystem::path directory, float winner_contribution = 0.5);
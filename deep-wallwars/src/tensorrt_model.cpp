@@ -58,6 +58,17 @@ void TensorRTModel::inference(std::span<float> states, Output const& out) {
     m_stream.synchronize();
 }
 
+void TensorRTModel::value_inference(std::span<float> states, std::span<float> values) {
+    m_states.to_device(states, m_stream);
+    m_context->enqueueV3(m_stream.get());
+    m_values.to_host(values, m_stream);
+    m_stream.synchronize();
+}
+
+std::shared_ptr<HostAllocator> TensorRTModel::host_allocator() const {
+    return pinned_host_allocator();
+}
+
 int TensorRTModel::rows() const {
     return m_rows;
 }
@@ -17,6 +17,10 @@ public:
     TensorRTModel(std::shared_ptr<nvinfer1::ICudaEngine> engine);
 
     void inference(std::span<float> states, Output const& out) override;
+    // The engine always computes both heads, but only the values are downloaded.
+    void value_inference(std::span<float> states, std::span<float> values) override;
+    // Pinned memory, which substantially improves the transfer times to and from the GPU.
+    std::shared_ptr<HostAllocator> host_allocator() const override;
     int rows() const;
     int columns() const;
 
@@ -0,0 +1,173 @@
+#include "wwnet.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static_assert(std::endian::native == std::endian::little, ".wwnet files are little endian");
+
+constexpr char kWwnetMagic[8] = {'W', 'W', 'N', 'E', 'T', '\0', '\0', '\0'};
+constexpr std::uint32_t kWwnetVersion = 1;
+
+// Anything larger is a corrupt header rather than a network. This also keeps the layer sizes far
+// from overflowing.
+constexpr std::int32_t kMaxDimension = 1 << 10;
+
+static std::size_t align(std::size_t offset) {
+    return (offset + kWwnetAlignment - 1) / kWwnetAlignment * kWwnetAlignment;
+}
+
+struct ConvShape {
+    int in_channels;
+    int out_channels;
+};
+
+static std::vector<ConvShape> conv_shapes(WwnetHeader const& header) {
+    std::vector<ConvShape> shapes{{header.input_channels, header.hidden_channels}};
+    for (int i = 0; i < 2 * header.residual_blocks; ++i) {
+        shapes.push_back({header.hidden_channels, header.hidden_channels});
+    }
+    shapes.push_back({header.hidden_channels, header.head_channels});
+    shapes.push_back({header.hidden_channels, header.head_channels});
+    return shapes;
+}
+
+static int prior_size(WwnetHeader const& header) {
+    return 2 * header.columns * header.rows + header.move_prior_size;
+}
+
+void write_wwnet(PackedResNet const& network, std::filesystem::path const& path) {
+    if (network.convs.size() < 3 || network.convs.size() % 2 == 0) {
+        throw std::runtime_error("Unexpected number of convolutions in the network!");
+    }
+
+    WwnetHeader header{};
+    std::memcpy(header.magic, kWwnetMagic, sizeof(kWwnetMagic));
+    header.version = kWwnetVersion;
+    header.conv_block = kConvBlock;
+    header.columns = network.columns;
+    header.rows = network.rows;
+    header.input_channels = network.input_channels;
+    header.hidden_channels = network.convs.front().out_channels;
+    header.head_channels = network.convs.back().out_channels;
+    header.residual_blocks = int(network.convs.size() - 3) / 2;
+    header.move_prior_size = network.move_prior_size;
+    header.log_priors = network.log_priors;
+
+    std::vector<std::span<float const>> blobs;
+    for (PackedConv const& conv : network.convs) {
+        blobs.push_back(conv.weights);
+        blobs.push_back(conv.bias);
+    }
+    for (PackedLinear const* linear : {&network.prior_linear, &network.value_linear}) {
+        blobs.push_back(linear->weights);
+        blobs.push_back(linear->bias);
+    }
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    std::size_t offset = sizeof(header);
+    for (std::span<float const> blob : blobs) {
+        std::size_t const start = align(offset);
+        std::string const padding(start - offset, '\0');
+        file.write(padding.data(), std::streamsize(padding.size()));
+        file.write(reinterpret_cast<char const*>(blob.data()), std::streamsize(blob.size_bytes()));
+        offset = start + blob.size_bytes();
+    }
+
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+PackedResNet map_wwnet(std::filesystem::path const& path) {
+    auto fail = [&](std::string const& reason) {
+        throw std::runtime_error("Cannot load " + path.string() + ": " + reason);
+    };
+
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fail("open failed");
+    }
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0) {
+        ::close(fd);
+        fail("fstat failed");
+    }
+    std::size_t const size = file_stat.st_size;
+    void* data = size > 0 ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    // The mapping stays valid without the file descriptor.
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        fail("mmap failed");
+    }
+    // All weights are read by the first inference anyway.
+    ::madvise(data, size, MADV_WILLNEED);
+
+    std::shared_ptr<void const> const mapping{
+        data, [size](void const* mapped) { ::munmap(const_cast<void*>(mapped), size); }};
+    char const* bytes = static_cast<char const*>(data);
+
+    WwnetHeader header;
+    if (size < sizeof(header)) {
+        fail("file is too small");
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, kWwnetMagic, sizeof(kWwnetMagic)) != 0) {
+        fail("not a .wwnet file");
+    }
+    if (header.version != kWwnetVersion) {
+        fail("unsupported version " + std::to_string(header.version));
+    }
+    if (header.conv_block != std::uint32_t(kConvBlock)) {
+        fail("weights are packed in blocks of " + std::to_string(header.conv_block) +
+             " channels, but this build uses " + std::to_string(kConvBlock));
+    }
+    for (std::int32_t dimension :
+         {header.columns, header.rows, header.input_channels, header.hidden_channels,
+          header.head_channels, header.residual_blocks + 1, header.move_prior_size}) {
+        if (dimension <= 0 || dimension > kMaxDimension) {
+            fail("invalid header");
+        }
+    }
+
+    std::size_t offset = sizeof(header);
+    auto next_blob = [&](std::size_t floats) {
+        offset = align(offset);
+        if (floats > (size - std::min(offset, size)) / sizeof(float)) {
+            fail("file is truncated");
+        }
+        std::span<float const> const blob{reinterpret_cast<float const*>(bytes + offset), floats};
+        offset += blob.size_bytes();
+        return blob;
+    };
+
+    PackedResNet network{header.columns, header.rows, header.input_channels,
+                         header.move_prior_size, header.log_priors != 0};
+    for (ConvShape shape : conv_shapes(header)) {
+        auto const weights = next_blob(std::size_t(9) * shape.in_channels * shape.out_channels);
+        auto const bias = next_blob(shape.out_channels);
+        network.convs.push_back({shape.in_channels, shape.out_channels, weights, bias, mapping});
+    }
+
+    int const head_size = header.head_channels * header.columns * header.rows;
+    for (auto [linear, out_size] : {std::pair{&network.prior_linear, prior_size(header)},
+                                    std::pair{&network.value_linear, 1}}) {
+        auto const weights = next_blob(std::size_t(head_size) * out_size);
+        auto const bias = next_blob(out_size);
+        *linear = {head_size, out_size, weights, bias, mapping};
+    }
+
+    // A header that was changed after writing usually still describes a consistent network, but
+    // not one of the size of the file.
+    if (offset != size) {
+        fail("file size does not match the header");
+    }
+    return network;
+}
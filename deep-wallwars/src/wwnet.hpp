@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+
+#include "cpu_model.hpp"
+
+// The .wwnet format stores a PackedResNet exactly as the CPU kernels use it, so that loading a
+// model is just mapping the file: no parsing, packing or copying of weights.
+//
+// The file starts with a WwnetHeader, followed by the weight blobs in this order:
+//   - for each convolution (start, two per residual block, prior head, value head): the packed
+//     weights, then the bias
+//   - the weights and the bias of the prior head's linear layer, then those of the value head's
+// Each blob is an array of floats starting at a multiple of kWwnetAlignment bytes. All values are
+// in little endian byte order.
+
+constexpr std::size_t kWwnetAlignment = 64;
+
+struct WwnetHeader {
+    char magic[8];
+    std::uint32_t version;
+    // The weight layout depends on the convolution block size the kernels were compiled with.
+    std::uint32_t conv_block;
+    std::int32_t columns;
+    std::int32_t rows;
+    std::int32_t input_channels;
+    std::int32_t hidden_channels;
+    std::int32_t head_channels;
+    std::int32_t residual_blocks;
+    std::int32_t move_prior_size;
+    std::int32_t log_priors;
+};
+
+void write_wwnet(PackedResNet const& network, std::filesystem::path const& path);
+
+// Maps the file read-only. The returned weights point into the mapping, which stays alive as long
+// as any of them. Throws if the file is not a valid .wwnet file for this build.
+PackedResNet map_wwnet(std::filesystem::path const& path);
@@ -1,16 +1,30 @@
 #include "batched_model.hpp"
 
 #include <catch2/catch_test_macros.hpp>
+#include <folly/executors/InlineExecutor.h>
+#include <folly/experimental/coro/BlockingWait.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <ranges>
+#include <thread>
+
+#include "batched_model_policy.hpp"
 #include "model.hpp"
 
+// The priors of each position repeat its inputs.
 struct MockModel : Model {
     MockModel(int batch_size, int channels, int columns, int rows)
         : Model{batch_size, channels, columns, rows} {}
 
     void inference(std::span<float> states, Output const& out) override {
-        for (int i = 0; i < m_batch_size; ++i) {
-            out.priors[prior_size() * i] = states[m_state_size * i];
+        for (int i = 0; i < int(out.values.size()); ++i) {
+            for (int j = 0; j < prior_size(); ++j) {
+                out.priors[prior_size() * i + j] = states[m_state_size * i + j % m_state_size];
+            }
             out.values[i] = i;
         }
     }
@@ -22,3 +36,300 @@ TEST_CASE("Initialization", "[Batched Model]") {
     // Compiler bug?
     auto bm = std::make_unique<BatchedModel>(std::move(model), 12);
 }
+
+TEST_CASE("Inference from position", "[Batched Model]") {
+    auto model = std::make_unique<MockModel>(4, kModelInputChannels, 3, 3);
+    auto bm = std::make_unique<BatchedModel>(std::move(model), 12);
+
+    Board board{3, 3};
+    Turn turn{Player::Blue, Turn::First};
+    auto state = convert_to_model_input(board, turn);
+    std::vector<float> expected_prior(bm->prior_size());
+    for (std::size_t i = 0; i < expected_prior.size(); ++i) {
+        expected_prior[i] = state[i % state.size()];
+    }
+
+    SECTION("Matches pre-tensorized input") {
+        auto from_position = bm->inference(board, turn).get();
+        auto from_state = bm->inference(state).get();
+
+        CHECK(std::ranges::equal(from_position.prior, expected_prior));
+        CHECK(std::ranges::equal(from_state.prior, expected_prior));
+        CHECK(from_position.value == from_state.value);
+    }
+
+    SECTION("Awaitable matches future") {
+        auto from_awaitable = folly::coro::blockingWait(
+            [&]() -> folly::coro::Task<InferenceResult> {
+                co_return co_await bm->co_inference(board, turn);
+            }());
+        auto from_future = bm->inference(board, turn).get();
+
+        CHECK(std::ranges::equal(from_awaitable.prior, expected_prior));
+        CHECK(from_awaitable.value == from_future.value);
+    }
+
+    SECTION("Awaitable resumes in the request context it suspended in") {
+        auto priority = folly::coro::blockingWait(with_inference_priority(
+            InferencePriority::Background, [&]() -> folly::coro::Task<InferencePriority> {
+                co_await bm->co_inference(board, turn);
+                co_return current_inference_priority();
+            }()));
+
+        CHECK(priority == InferencePriority::Background);
+    }
+
+    SECTION("Rejects boards that do not fit the model") {
+        CHECK_THROWS(bm->inference(Board{4, 4}, turn).get());
+        CHECK_THROWS(folly::coro::blockingWait(
+            [&]() -> folly::coro::Task<InferenceResult> {
+                co_return co_await bm->co_inference(Board{4, 4}, turn);
+            }()));
+    }
+}
+
+TEST_CASE("Partial batches are sent after the maximum wait", "[Batched Model]") {
+    std::vector<std::unique_ptr<Model>> models;
+    models.push_back(std::make_unique<MockModel>(4, 1, 3, 6));
+    auto bm = std::make_unique<BatchedModel>(
+        std::move(models), 12,
+        BatchingOptions{.min_batch_fill = 4, .max_wait = std::chrono::milliseconds{20}});
+
+    auto result = bm->inference(std::vector<float>(18, 0.5f)).get();
+    CHECK(result.prior[0] == 0.5f);
+
+    auto histograms = bm->batch_histograms();
+    CHECK(histograms.fill.computeTotalCount() == 1);
+    CHECK(histograms.fill.getPercentileEstimate(0.5) <= 1);
+}
+
+// Takes a fixed time per batch, like a real model that is far from its batch size.
+struct SlowModel : MockModel {
+    static constexpr auto kInferenceTime = std::chrono::milliseconds{20};
+
+    SlowModel() : MockModel{4, 1, 3, 6} {}
+
+    void inference(std::span<float> states, Output const& out) override {
+        std::this_thread::sleep_for(kInferenceTime);
+        MockModel::inference(states, out);
+    }
+};
+
+TEST_CASE("Batches are cut at the latency target", "[Batched Model]") {
+    constexpr auto kLatencyTarget = std::chrono::milliseconds{60};
+    std::vector<std::unique_ptr<Model>> models;
+    models.push_back(std::make_unique<SlowModel>());
+    auto bm = std::make_unique<BatchedModel>(std::move(models), 12,
+                                             BatchingOptions{.latency_target = kLatencyTarget});
+
+    auto time_batch = [&](int requests) {
+        auto const start = std::chrono::steady_clock::now();
+        std::vector<folly::SemiFuture<InferenceResult>> futures;
+        for (int i = 0; i < requests; ++i) {
+            futures.push_back(bm->inference(std::vector<float>(18, 0.5f)));
+        }
+        for (auto& future : futures) {
+            CHECK(std::move(future).get().prior[0] == 0.5f);
+        }
+        return std::chrono::steady_clock::now() - start;
+    };
+
+    SECTION("A lone request waits out the target before the first measurement") {
+        CHECK(time_batch(1) >= kLatencyTarget);
+        CHECK(bm->batch_histograms().fill.getPercentileEstimate(0.5) <= 1);
+    }
+
+    SECTION("The wait leaves room for the measured inference time") {
+        for (int i = 0; i < 30; ++i) {
+            time_batch(1);
+        }
+        // Without the measurement this would take the target plus the inference time.
+        CHECK(time_batch(1) < kLatencyTarget + SlowModel::kInferenceTime / 2);
+    }
+
+    SECTION("Full batches are sent right away") {
+        CHECK(time_batch(4) < kLatencyTarget);
+        CHECK(bm->batch_histograms().fill.computeTotalCount() == 1);
+    }
+}
+
+// Holds the first batch until the test opens the gate, so the following batches can be composed
+// from a full queue.
+struct GatedModel : MockModel {
+    std::promise<void> entered;
+    std::shared_future<void> gate;
+    bool first = true;
+
+    GatedModel(std::shared_future<void> gate, int channels = 1)
+        : MockModel{4, channels, 3, 6}, gate{std::move(gate)} {}
+
+    void inference(std::span<float> states, Output const& out) override {
+        if (first) {
+            first = false;
+            entered.set_value();
+            gate.wait();
+        }
+        MockModel::inference(states, out);
+    }
+};
+
+TEST_CASE("Priority lanes", "[Batched Model]") {
+    std::promise<void> open_gate;
+    auto model = std::make_unique<GatedModel>(open_gate.get_future().share());
+    auto entered = model->entered.get_future();
+    auto bm = std::make_unique<BatchedModel>(std::move(model), 64);
+
+    auto blocker = bm->inference(std::vector<float>(18, 0.0f));
+    entered.wait();
+
+    std::vector<folly::SemiFuture<InferenceResult>> background;
+    std::vector<folly::SemiFuture<InferenceResult>> interactive;
+    for (int i = 0; i < 6; ++i) {
+        background.push_back(
+            bm->inference(std::vector<float>(18, 1.0f), InferencePriority::Background));
+        interactive.push_back(
+            bm->inference(std::vector<float>(18, 2.0f), InferencePriority::Interactive));
+    }
+    open_gate.set_value();
+
+    // Results keep their output slab alive, so each batch ends up with its own slab.
+    std::map<HostBuffer<float> const*, std::vector<float>> batches;
+    std::vector<InferenceResult> results{std::move(blocker).get()};
+    for (auto& future : interactive) {
+        results.push_back(std::move(future).get());
+    }
+    for (auto& future : background) {
+        results.push_back(std::move(future).get());
+    }
+    for (auto const& result : results | std::views::drop(1)) {
+        batches[result.slab.get()].push_back(result.prior[0]);
+    }
+
+    SECTION("Interactive requests are served first, but not exclusively") {
+        for (auto const& [_, batch] : batches) {
+            if (std::ranges::count(batch, 2.0f) > 0) {
+                CHECK(std::ranges::count(batch, 2.0f) == 3);
+                CHECK(std::ranges::count(batch, 1.0f) == 1);
+            } else {
+                CHECK(std::ranges::count(batch, 1.0f) == 4);
+            }
+        }
+    }
+
+    SECTION("Priority is inherited from the request context") {
+        auto priority_of = [](InferencePriority priority) {
+            return folly::coro::blockingWait(with_inference_priority(
+                priority, []() -> folly::coro::Task<InferencePriority> {
+                    co_return current_inference_priority();
+                }()));
+        };
+
+        CHECK(current_inference_priority() == InferencePriority::Normal);
+        CHECK(priority_of(InferencePriority::Background) == InferencePriority::Background);
+        CHECK(priority_of(InferencePriority::Interactive) == InferencePriority::Interactive);
+    }
+}
+
+// The value of each position is its first input, and value-only batches are counted.
+struct ValueModel : MockModel {
+    std::atomic<int> value_batches = 0;
+
+    ValueModel() : MockModel{4, kModelInputChannels, 3, 3} {}
+
+    void inference(std::span<float> states, Output const& out) override {
+        MockModel::inference(states, out);
+        for (int i = 0; i < int(out.values.size()); ++i) {
+            out.values[i] = states[m_state_size * i];
+        }
+    }
+
+    void value_inference(std::span<float> states, std::span<float> values) override {
+        ++value_batches;
+        for (int i = 0; i < int(values.size()); ++i) {
+            values[i] = states[m_state_size * i];
+        }
+    }
+};
+
+TEST_CASE("Value-only inference", "[Batched Model]") {
+    auto model = std::make_unique<ValueModel>();
+    ValueModel& value_model = *model;
+    auto bm = std::make_unique<BatchedModel>(std::move(model), 12);
+
+    Board board{3, 3};
+    Turn const red{Player::Red, Turn::First};
+    Turn const blue{Player::Blue, Turn::First};
+    float const red_value = convert_to_model_input(board, red)[0];
+    float const blue_value = convert_to_model_input(board, blue)[0];
+
+    SECTION("Single positions skip the priors") {
+        CHECK(bm->value_inference(board, red).get() == red_value);
+        CHECK(value_model.value_batches == 1);
+        CHECK(bm->total_value_batches() == 1);
+        CHECK(bm->total_output_slabs() == 0);
+    }
+
+    SECTION("Many positions at once") {
+        std::vector<ModelPosition> positions;
+        for (int i = 0; i < 10; ++i) {
+            positions.push_back({board, i % 2 == 0 ? red : blue});
+        }
+
+        auto values = bm->value_inference(std::move(positions)).get();
+        REQUIRE(values.size() == 10);
+        for (int i = 0; i < 10; ++i) {
+            CHECK(values[i] == (i % 2 == 0 ? red_value : blue_value));
+        }
+        CHECK(bm->total_inferences() == 10);
+        CHECK(bm->total_value_batches() == bm->total_batches());
+    }
+
+    SECTION("Recorded games are evaluated from Red's perspective") {
+        GameRecorder game{board};
+        game.record_move(Player::Red,
+                         {Wall{{0, 0}, Direction::Right}, Wall{{1, 1}, Direction::Down}});
+        game.record_move(Player::Blue,
+                         {Wall{{2, 0}, Direction::Down}, Wall{{0, 2}, Direction::Right}});
+        REQUIRE(game.board_states().size() == 3);
+
+        auto values = game_values(*bm, game).get();
+        REQUIRE(values.size() == 3);
+        CHECK(values[0] == convert_to_model_input(game.board_states()[0], red)[0]);
+        CHECK(values[1] == -convert_to_model_input(game.board_states()[1], blue)[0]);
+        CHECK(values[2] == convert_to_model_input(game.board_states()[2], red)[0]);
+    }
+}
+
+static folly::coro::Task<InferenceResult> await_inference(BatchedModel& bm, Board board,
+                                                          Turn turn) {
+    co_return co_await bm.co_inference(std::move(board), turn);
+}
+
+TEST_CASE("Pending awaiters fail when the model is destroyed", "[Batched Model]") {
+    std::promise<void> open_gate;
+    auto model = std::make_unique<GatedModel>(open_gate.get_future().share(), kModelInputChannels);
+    auto entered = model->entered.get_future();
+    int const state_size = model->state_size();
+    auto bm = std::make_unique<BatchedModel>(std::move(model), 64);
+
+    auto blocker = bm->inference(std::vector<float>(state_size, 0.0f));
+    entered.wait();
+
+    // On the inline executor, each search runs until it waits for the model.
+    std::vector<folly::SemiFuture<InferenceResult>> searches;
+    for (int i = 0; i < 6; ++i) {
+        searches.push_back(await_inference(*bm, Board{3, 6}, {Player::Red, Turn::First})
+                               .scheduleOn(&folly::InlineExecutor::instance())
+                               .start());
+    }
+
+    // The destructor waits for the worker, which is still stuck in the first batch.
+    std::thread destroy{[&] { bm.reset(); }};
+    open_gate.set_value();
+    destroy.join();
+
+    CHECK(std::move(blocker).get().prior[0] == 0.0f);
+    for (auto& search : searches) {
+        CHECK_THROWS(std::move(search).get());
+    }
+}
@@ -0,0 +1,64 @@
+#include "cached_policy.hpp"
+
+#include <folly/experimental/coro/BlockingWait.h>
+#include <folly/experimental/coro/Collect.h>
+#include <folly/experimental/coro/Sleep.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <memory>
+
+// Takes a while to answer so that concurrent requests overlap.
+struct SlowPolicy {
+    std::shared_ptr<int> evaluations = std::make_shared<int>(0);
+
+    folly::coro::Task<Evaluation> operator()(Board const&, Turn, std::optional<PreviousPosition>) {
+        ++*evaluations;
+        co_await folly::coro::sleep(std::chrono::milliseconds{10});
+        co_return Evaluation{0.5, {TreeEdge(PawnMove{Pawn::Cat, Direction::Down}, 1.0)}};
+    }
+};
+
+TEST_CASE("Concurrent misses are coalesced", "[Cached Policy]") {
+    SlowPolicy slow_policy;
+    CachedPolicy cached_policy{slow_policy, 1 << 20};
+
+    Board board{4, 4};
+    Turn turn{Player::Red, Turn::First};
+
+    auto [first, second] = folly::coro::blockingWait(folly::coro::collectAll(
+        cached_policy(board, turn, std::nullopt), cached_policy(board, turn, std::nullopt)));
+
+    CHECK(*slow_policy.evaluations == 1);
+    CHECK(cached_policy.cache_misses() == 1);
+    CHECK(cached_policy.cache_coalesced() == 1);
+    CHECK(first.value == second.value);
+    // Waiters get the cached (compact) form of the evaluation.
+    REQUIRE(second.compact);
+    CHECK(second.compact->size() == 1);
+
+    folly::coro::blockingWait(cached_policy(board, turn, std::nullopt));
+
+    CHECK(*slow_policy.evaluations == 1);
+    CHECK(cached_policy.cache_hits() == 1);
+}
+
+TEST_CASE("Compact-only evaluations are cached as they are", "[Cached Policy]") {
+    Board board{4, 4};
+    Turn turn{Player::Red, Turn::First};
+    std::vector<TreeEdge> const edges{TreeEdge(PawnMove{Pawn::Cat, Direction::Down}, 1.0)};
+    auto const compact = CompactEvaluation::make(board, 0.25f, edges);
+
+    CachedPolicy cached_policy{
+        [&](Board const&, Turn, std::optional<PreviousPosition>) -> folly::coro::Task<Evaluation> {
+            co_return Evaluation{compact->value(), {}, compact};
+        },
+        1 << 20};
+
+    folly::coro::blockingWait(cached_policy(board, turn, std::nullopt));
+    auto const cached = folly::coro::blockingWait(cached_policy(board, turn, std::nullopt));
+
+    CHECK(cached_policy.cache_hits() == 1);
+    REQUIRE(cached.compact);
+    CHECK(cached.compact->size() == 1);
+}
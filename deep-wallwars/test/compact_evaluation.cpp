@@ -0,0 +1,47 @@
+#include "compact_evaluation.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <limits>
+
+#include "mcts.hpp"
+
+TEST_CASE("Half precision conversion", "[Compact Evaluation]") {
+    CHECK(half_to_float(float_to_half(0.0f)) == 0.0f);
+    CHECK(half_to_float(float_to_half(1.0f)) == 1.0f);
+    CHECK(half_to_float(float_to_half(0.5f)) == 0.5f);
+    CHECK(half_to_float(float_to_half(-2.0f)) == -2.0f);
+    CHECK(half_to_float(float_to_half(1e-6f)) > 0.0f);
+    CHECK(half_to_float(float_to_half(1e6f)) == std::numeric_limits<float>::infinity());
+
+    for (float prior : {0.001f, 0.0123f, 0.3333f, 0.9f}) {
+        CHECK(std::abs(half_to_float(float_to_half(prior)) - prior) <= prior / 1024);
+    }
+}
+
+TEST_CASE("Compact evaluations preserve edges", "[Compact Evaluation]") {
+    Board board{6, 5, Variant::Standard};
+    std::vector<TreeEdge> edges;
+    edges.emplace_back(PawnMove{Pawn::Cat, Direction::Down}, 0.25f);
+    edges.emplace_back(PawnMove{Pawn::Mouse, Direction::Left}, 0.125f);
+    edges.emplace_back(Wall{{5, 0}, Wall::Down}, 0.5f);
+    edges.emplace_back(Wall{{2, 4}, Wall::Right}, 0.125f);
+
+    auto compact = CompactEvaluation::make(board, -0.75f, edges);
+    REQUIRE(compact);
+    CHECK(compact->value() == -0.75f);
+    REQUIRE(compact->size() == edges.size());
+
+    auto expanded = compact->edges(board);
+    REQUIRE(expanded.size() == edges.size());
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+        CHECK(expanded[i].action == edges[i].action);
+        CHECK(expanded[i].prior == edges[i].prior);
+    }
+
+    SECTION("References share the block") {
+        CompactEvaluation::Ref copy = compact;
+        compact = {};
+        CHECK(copy->size() == edges.size());
+    }
+}
@@ -0,0 +1,643 @@
+#include "cpu_model.hpp"
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "cpu_kernels.hpp"
+#include "onnx_graph.hpp"
+#include "state_conversions.hpp"
+
+static std::vector<float> random_values(std::size_t size, std::mt19937& twister) {
+    std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+    std::vector<float> values(size);
+    std::ranges::generate(values, [&] { return dist(twister); });
+    return values;
+}
+
+// The synthetic inputs used to compute the expected outputs below with onnxruntime.
+static std::vector<float> reference_states(int state_size, int count) {
+    std::vector<float> states(std::size_t(state_size) * count);
+    for (int k = 0; k < count; ++k) {
+        for (int i = 0; i < state_size; ++i) {
+            states[k * state_size + i] = float((i * 37 + k * 11) % 101) / 100.0f;
+        }
+    }
+    return states;
+}
+
+// `count` images with random inside and zero border.
+static std::vector<float> random_images(ImageShape shape, int count, std::mt19937& twister) {
+    std::vector<float> images(shape.size() * count, 0.0f);
+    for (int n = 0; n < count; ++n) {
+        for (int y = 1; y <= shape.height; ++y) {
+            auto const row = random_values(std::size_t(shape.width) * shape.channels, twister);
+            std::ranges::copy(row, images.begin() + n * shape.size() +
+                                       (std::size_t(y) * (shape.width + 2) + 1) * shape.channels);
+        }
+    }
+    return images;
+}
+
+TEST_CASE("Packed convolution matches the definition", "[CPU Model]") {
+    int const height = 5;
+    int const width = 7;
+    int const in_channels = 3;
+    int const out_channels = 2 * kConvBlock;
+    int const count = 2;
+
+    std::mt19937 twister{42};
+    auto const weights = random_values(out_channels * in_channels * 9, twister);
+    auto const bias = random_values(out_channels, twister);
+    auto const inputs = random_values(std::size_t(count) * in_channels * height * width, twister);
+
+    ImageShape const in_shape{height, width, in_channels};
+    ImageShape const out_shape{height, width, out_channels};
+    std::vector<float> padded(in_shape.size() * count, 0.0f);
+    for (int n = 0; n < count; ++n) {
+        for (int c = 0; c < in_channels; ++c) {
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    std::size_t const pixel = (y + 1) * (width + 2) + x + 1;
+                    padded[n * in_shape.size() + pixel * in_channels + c] =
+                        inputs[((n * in_channels + c) * height + y) * width + x];
+                }
+            }
+        }
+    }
+
+    std::vector<float> out(out_shape.size() * count, 0.0f);
+    conv3x3(pack_conv3x3(weights, bias, out_channels, in_channels), height, width, padded.data(),
+            out.data(), count);
+
+    for (int n = 0; n < count; ++n) {
+        for (int o = 0; o < out_channels; ++o) {
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    float expected = bias[o];
+                    for (int c = 0; c < in_channels; ++c) {
+                        for (int dy = -1; dy <= 1; ++dy) {
+                            for (int dx = -1; dx <= 1; ++dx) {
+                                if (y + dy < 0 || y + dy >= height || x + dx < 0 ||
+                                    x + dx >= width) {
+                                    continue;
+                                }
+                                expected +=
+                                    weights[((o * in_channels + c) * 3 + dy + 1) * 3 + dx + 1] *
+                                    inputs[((n * in_channels + c) * height + y + dy) * width + x +
+                                           dx];
+                            }
+                        }
+                    }
+
+                    float const actual =
+                        out[n * out_shape.size() + ((y + 1) * (width + 2) + x + 1) * out_channels +
+                            o];
+                    CHECK(actual == Catch::Approx(expected).margin(1e-5));
+                }
+            }
+        }
+    }
+
+    SECTION("The border stays zero") {
+        for (int x = 0; x < (width + 2) * out_channels; ++x) {
+            CHECK(out[x] == 0.0f);
+        }
+    }
+}
+
+TEST_CASE("Winograd convolution matches the direct one", "[CPU Model]") {
+    // Odd sizes have partial tiles, and channel counts that are not a multiple of the vector width
+    // take the scalar path of the input transform.
+    auto const [height, width] = GENERATE(std::pair{8, 8}, std::pair{5, 7}, std::pair{6, 3});
+    int const in_channels = GENERATE(3, 21);
+    int const out_channels = 2 * kConvBlock;
+    int const count = 3;
+
+    std::mt19937 twister{42};
+    auto const weights = random_values(out_channels * in_channels * 9, twister);
+    auto const bias = random_values(out_channels, twister);
+    auto const conv = pack_conv3x3(weights, bias, out_channels, in_channels);
+    auto const winograd = winograd_conv3x3(conv);
+
+    ImageShape const out_shape{height, width, out_channels};
+    auto const in = random_images({height, width, in_channels}, count, twister);
+    std::vector<float> expected(out_shape.size() * count, 0.0f);
+    std::vector<float> actual(out_shape.size() * count, 0.0f);
+    std::vector<float> scratch(winograd_scratch_size(winograd, height, width, count));
+    conv3x3(conv, height, width, in.data(), expected.data(), count);
+    conv3x3_winograd(winograd, height, width, in.data(), actual.data(), count, scratch.data());
+
+    // Also checks that the border stays zero.
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        CHECK(actual[i] == Catch::Approx(expected[i]).margin(1e-4));
+    }
+}
+
+TEST_CASE("Convolution epilogues match separate passes", "[CPU Model]") {
+    int const height = 5;
+    int const width = 6;
+    int const channels = kConvBlock;
+    int const count = 2;
+
+    std::mt19937 twister{42};
+    auto const conv = pack_conv3x3(random_values(channels * channels * 9, twister),
+                                   random_values(channels, twister), channels, channels);
+    auto const winograd = winograd_conv3x3(conv);
+    auto const quantized = quantize_conv3x3(conv, 1.0f / kMaxQuantizedActivation);
+
+    ImageShape const shape{height, width, channels};
+    auto in = random_images(shape, count, twister);
+    relu(in);
+    auto const residual = random_images(shape, count, twister);
+    std::vector<std::uint8_t> quantized_in(shape.size() * count);
+    quantize_images(shape, in.data(), quantized_in.data(), quantized.input_scale, count);
+    std::vector<float> scratch(winograd_scratch_size(winograd, height, width, count));
+
+    auto convolve = [&](int algorithm, float* out, ConvEpilogue epilogue) {
+        if (algorithm == 0) {
+            conv3x3(conv, height, width, in.data(), out, count, epilogue);
+        } else if (algorithm == 1) {
+            conv3x3_winograd(winograd, height, width, in.data(), out, count, scratch.data(),
+                             epilogue);
+        } else {
+            conv3x3_int8(quantized, height, width, quantized_in.data(), out, count, epilogue);
+        }
+    };
+
+    int const algorithm = GENERATE(0, 1, 2);
+    bool const with_residual = GENERATE(false, true);
+    std::vector<float> expected(shape.size() * count, 0.0f);
+    std::vector<float> actual(shape.size() * count, 0.0f);
+    convolve(algorithm, expected.data(), {});
+    if (with_residual) {
+        add_relu(expected, residual);
+        convolve(algorithm, actual.data(), {.residual = residual.data(), .relu = true});
+    } else {
+        relu(expected);
+        convolve(algorithm, actual.data(), {.relu = true});
+    }
+
+    // The residual is random everywhere, but the border of the output must stay zero.
+    for (int x = 0; x < (width + 2) * channels; ++x) {
+        expected[x] = 0.0f;
+    }
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        CHECK(actual[i] == Catch::Approx(expected[i]).margin(1e-5));
+    }
+}
+
+TEST_CASE("Int8 convolution approximates the float one", "[CPU Model]") {
+    int const height = 5;
+    int const width = 9;
+    int const in_channels = 6;
+    int const out_channels = kConvBlock;
+    int const count = 3;
+
+    std::mt19937 twister{42};
+    auto const weights = random_values(out_channels * in_channels * 9, twister);
+    auto const bias = random_values(out_channels, twister);
+    auto const conv = pack_conv3x3(weights, bias, out_channels, in_channels);
+
+    // Inputs are between 0 and 2, with zero borders.
+    ImageShape const in_shape{height, width, in_channels};
+    ImageShape const out_shape{height, width, out_channels};
+    std::vector<float> in(in_shape.size() * count, 0.0f);
+    for (int n = 0; n < count; ++n) {
+        for (int y = 1; y <= height; ++y) {
+            for (int x = 1; x <= width; ++x) {
+                for (int c = 0; c < in_channels; ++c) {
+                    std::size_t const pixel = y * (width + 2) + x;
+                    in[n * in_shape.size() + pixel * in_channels + c] =
+                        1.0f + random_values(1, twister)[0];
+                }
+            }
+        }
+    }
+
+    auto const quantized = quantize_conv3x3(conv, 2.0f / kMaxQuantizedActivation);
+    REQUIRE(quantized.in_channels == quantized_channels(in_channels));
+    REQUIRE(quantized.in_channels % kChannelGroup == 0);
+
+    std::vector<std::uint8_t> quantized_in(
+        ImageShape{height, width, quantized.in_channels}.size() * count);
+    quantize_images(in_shape, in.data(), quantized_in.data(), quantized.input_scale, count);
+
+    std::vector<float> expected(out_shape.size() * count, 0.0f);
+    std::vector<float> actual(out_shape.size() * count, 0.0f);
+    conv3x3(conv, height, width, in.data(), expected.data(), count);
+    conv3x3_int8(quantized, height, width, quantized_in.data(), actual.data(), count);
+
+    // Each of the 54 products is off by at most about half a quantization step of each factor.
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        CHECK(actual[i] == Catch::Approx(expected[i]).margin(0.25));
+    }
+}
+
+TEST_CASE("Convolution output channels must fill whole blocks", "[CPU Model]") {
+    std::vector<float> weights(kConvBlock / 2 * 9);
+    CHECK_THROWS(pack_conv3x3(weights, {}, kConvBlock / 2, 1));
+}
+
+TEST_CASE("Softmax", "[CPU Model]") {
+    std::vector<float> values{1.0f, 2.0f, 3.0f};
+    std::vector<float> logs = values;
+
+    softmax(values);
+    log_softmax(logs);
+
+    CHECK(values[0] + values[1] + values[2] == Catch::Approx(1.0f));
+    CHECK(values[2] == Catch::Approx(0.66524096f));
+    for (int i = 0; i < 3; ++i) {
+        CHECK(std::exp(logs[i]) == Catch::Approx(values[i]));
+    }
+
+    std::vector<float> empty;
+    softmax(empty);
+    log_softmax(empty);
+    CHECK(empty.empty());
+}
+
+TEST_CASE("CPU 8x8 model matches onnxruntime", "[CPU Model]") {
+    auto const weights =
+        resnet_from_onnx(read_onnx_graph(DEEP_WW_MODELS_DIR "/8x8_750000.onnx"));
+    CHECK(weights.columns == 8);
+    CHECK(weights.rows == 8);
+    CHECK(weights.move_prior_size == 4);
+    CHECK_FALSE(weights.log_priors);
+
+    int const threads = GENERATE(1, 2);
+    auto const algorithm = GENERATE(ConvAlgorithm::Direct, ConvAlgorithm::Winograd);
+    CpuResNetModel model{weights, 4, std::make_shared<InferenceExecutor>(threads), algorithm};
+    REQUIRE(model.prior_size() == 132);
+
+    // Only the first three positions are passed; the model must not touch the rest of the batch.
+    int const count = 3;
+    auto states = reference_states(model.state_size(), count);
+    std::vector<float> priors(model.prior_size() * count);
+    std::vector<float> values(count);
+    model.inference(states, {priors, values});
+
+    auto prior = [&](int sample, int action) {
+        return priors[sample * model.prior_size() + action];
+    };
+    auto argmax = [&](int sample) {
+        auto const begin = priors.begin() + sample * model.prior_size();
+        return std::max_element(begin, begin + model.prior_size()) - begin;
+    };
+
+    CHECK(values[0] == Catch::Approx(-0.48673186f).margin(1e-4));
+    CHECK(prior(0, 17) == Catch::Approx(0.00989569f).margin(1e-5));
+    CHECK(argmax(0) == 47);
+    CHECK(prior(0, 47) == Catch::Approx(0.33075956f).margin(1e-4));
+
+    CHECK(values[1] == Catch::Approx(0.81526673f).margin(1e-4));
+    CHECK(prior(1, 17) == Catch::Approx(0.03834951f).margin(1e-5));
+    CHECK(argmax(1) == 14);
+
+    CHECK(values[2] == Catch::Approx(0.58612734f).margin(1e-4));
+    CHECK(prior(2, 0) == Catch::Approx(0.00690433f).margin(1e-5));
+    CHECK(argmax(2) == 41);
+}
+
+// Splits every convolution into a convolution and a batch normalization that together compute the
+// same, like exports without constant folding.
+static void unfold_batch_norms(OnnxGraph& graph, std::mt19937& twister) {
+    std::uniform_real_distribution<float> dist{0.5f, 2.0f};
+    float const epsilon = 1e-3f;
+
+    std::vector<OnnxNode> nodes;
+    for (OnnxNode const& node : graph.nodes) {
+        nodes.push_back(node);
+        if (node.op_type != "Conv") {
+            continue;
+        }
+
+        OnnxNode& conv = nodes.back();
+        REQUIRE(conv.inputs.size() == 3);
+        auto& weights = graph.initializers.at(conv.inputs[1]).data;
+        auto& bias = graph.initializers.at(conv.inputs[2]).data;
+        std::size_t const channels = bias.size();
+        std::size_t const filter_size = weights.size() / channels;
+
+        std::string const output = conv.outputs.at(0);
+        conv.outputs[0] = output + "_conv";
+        OnnxNode batch_norm{"BatchNormalization", {conv.outputs[0]}, {output}, {}};
+        batch_norm.attributes["epsilon"].f = epsilon;
+
+        std::vector<float> parameters[4];  // scale, shift, mean, var
+        for (auto& parameter : parameters) {
+            std::ranges::generate_n(std::back_inserter(parameter), channels,
+                                    [&] { return dist(twister); });
+        }
+        for (std::size_t o = 0; o < channels; ++o) {
+            auto const& [scale, shift, mean, var] = parameters;
+            float const factor = scale[o] / std::sqrt(var[o] + epsilon);
+            for (std::size_t i = 0; i < filter_size; ++i) {
+                weights[o * filter_size + i] /= factor;
+            }
+            bias[o] = (bias[o] - shift[o]) / factor + mean[o];
+        }
+
+        for (int p = 0; p < 4; ++p) {
+            std::string const name = output + "_bn" + std::to_string(p);
+            graph.initializers[name] = {{std::int64_t(channels)}, parameters[p]};
+            batch_norm.inputs.push_back(name);
+        }
+        nodes.push_back(batch_norm);
+    }
+    graph.nodes = std::move(nodes);
+}
+
+TEST_CASE("Batch normalization is folded into convolutions", "[CPU Model]") {
+    auto graph = read_onnx_graph(DEEP_WW_MODELS_DIR "/8x8_750000.onnx");
+    CpuResNetModel reference{resnet_from_onnx(graph), 4};
+
+    std::mt19937 twister{42};
+    unfold_batch_norms(graph, twister);
+    REQUIRE(std::ranges::count(graph.nodes, "BatchNormalization", &OnnxNode::op_type) ==
+            std::ranges::count(graph.nodes, "Conv", &OnnxNode::op_type));
+    CpuResNetModel model{resnet_from_onnx(graph), 4};
+
+    auto states = reference_states(model.state_size(), 4);
+    std::vector<float> expected_priors(model.prior_size() * 4);
+    std::vector<float> expected_values(4);
+    std::vector<float> priors(expected_priors.size());
+    std::vector<float> values(expected_values.size());
+    reference.inference(states, {expected_priors, expected_values});
+    model.inference(states, {priors, values});
+
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        CHECK(values[i] == Catch::Approx(expected_values[i]).margin(1e-4));
+    }
+    for (std::size_t i = 0; i < priors.size(); ++i) {
+        CHECK(priors[i] == Catch::Approx(expected_priors[i]).margin(1e-5));
+    }
+}
+
+TEST_CASE("Legal inference matches the dense priors", "[CPU Model]") {
+    auto const weights =
+        resnet_from_onnx(read_onnx_graph(DEEP_WW_MODELS_DIR "/8x8_750000.onnx"));
+    int const threads = GENERATE(1, 2);
+    CpuResNetModel model{weights, 4, std::make_shared<InferenceExecutor>(threads)};
+
+    Board board{8, 8};
+    board.place_wall(Player::Red, {{1, 3}, Direction::Right});
+    board.place_wall(Player::Red, {{4, 4}, Direction::Down});
+    board.place_wall(Player::Blue, {{0, 0}, Direction::Down});
+
+    // The first position only allows the actions of the board, the second one everything and the
+    // third one nothing.
+    int const count = 3;
+    std::size_t const prior_size = model.prior_size();
+    std::vector<std::uint8_t> legal(prior_size * count, 0);
+    fill_legal_actions(board, {Player::Red, Turn::First}, std::span(legal).first(prior_size));
+    std::fill_n(legal.begin() + prior_size, prior_size, 1);
+    REQUIRE(std::count(legal.begin(), legal.begin() + prior_size, 1) ==
+            int(board.legal_walls().size() +
+                board.legal_directions(Player::Red, Pawn::Cat).size()));
+
+    auto states = reference_states(model.state_size(), count);
+    std::vector<float> dense(prior_size * count);
+    std::vector<float> sparse(prior_size * count);
+    std::vector<float> dense_values(count);
+    std::vector<float> values(count);
+    model.inference(states, {dense, dense_values});
+    model.legal_inference(states, legal, {sparse, values});
+
+    CHECK(values == dense_values);
+    for (int image = 0; image < count; ++image) {
+        float legal_total = 0.0f;
+        for (std::size_t i = 0; i < prior_size; ++i) {
+            legal_total += legal[image * prior_size + i] ? dense[image * prior_size + i] : 0.0f;
+        }
+        for (std::size_t i = 0; i < prior_size; ++i) {
+            std::size_t const index = image * prior_size + i;
+            float const expected = legal[index] ? dense[index] / legal_total : 0.0f;
+            CHECK(sparse[index] == Catch::Approx(expected).margin(1e-6));
+        }
+    }
+    // Without legal actions there is nothing to normalize.
+    CHECK(std::ranges::all_of(std::span(sparse).last(prior_size), [](float p) { return p == 0; }));
+
+    auto const too_few = std::span(legal).first(prior_size);
+    CHECK_THROWS(model.legal_inference(states, too_few, {sparse, values}));
+}
+
+TEST_CASE("Value-only inference matches the full inference", "[CPU Model]") {
+    auto const weights =
+        resnet_from_onnx(read_onnx_graph(DEEP_WW_MODELS_DIR "/8x8_750000.onnx"));
+    int const threads = GENERATE(1, 2);
+    CpuResNetModel model{weights, 4, std::make_shared<InferenceExecutor>(threads)};
+
+    int const count = 3;
+    auto states = reference_states(model.state_size(), count);
+    std::vector<float> priors(model.prior_size() * count);
+    std::vector<float> expected(count);
+    std::vector<float> values(count);
+    model.inference(states, {priors, expected});
+    model.value_inference(states, values);
+
+    CHECK(values == expected);
+}
+
+TEST_CASE("Quantized CPU model follows the float model", "[CPU Model]") {
+    auto const weights =
+        resnet_from_onnx(read_onnx_graph(DEEP_WW_MODELS_DIR "/8x8_750000.onnx"));
+    CpuResNetModel reference{weights, 8};
+    CpuResNetModel model{weights, 8};
+    CHECK_FALSE(model.quantized());
+
+    auto const states = reference_states(model.state_size(), 16);
+    model.quantize(states);
+    CHECK(model.quantized());
+
+    // The synthetic positions are nothing like real ones, which agree much more closely (see the
+    // report logged by load_cpu_resnet).
+    auto const report = compare_models(reference, model, states);
+    CHECK(report.positions == 16);
+    CHECK(report.top1_agreement >= 0.75);
+    CHECK(report.value_mae < 0.05);
+}
+
+TEST_CASE("Calibration data is split by game", "[CPU Model]") {
+    auto const folder = std::filesystem::temp_directory_path() / "deep_ww_calibration_test";
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directory(folder);
+
+    // Game i has i + 1 positions whose inputs are all equal to the game number. Game 4 is of
+    // another board size.
+    for (int game = 0; game < 5; ++game) {
+        std::ofstream file{folder / ("game_" + std::to_string(game) + ".csv")};
+        for (int position = 0; position <= game; ++position) {
+            print_training_data_point(file, ModelInput(game == 4 ? 3 : 2, float(game)),
+                                      {{0.5f, 0.5f}, 0.0f});
+        }
+    }
+
+    auto const data = read_calibration_data(folder, 2, 3);
+    CHECK(data.calibration == std::vector<float>{0, 0, 2, 2, 2, 2});
+    CHECK(data.held_out == std::vector<float>{1, 1, 1, 1, 3, 3});
+
+    CHECK_THROWS(read_calibration_data(folder, 4, 3));
+    std::filesystem::remove_all(folder);
+}
+
+TEST_CASE("CPU 5x5 model matches onnxruntime", "[CPU Model]") {
+    auto model = load_cpu_resnet(DEEP_WW_MODELS_DIR "/5x5_60000.onnx", 2);
+    REQUIRE(model->columns() == 5);
+    REQUIRE(model->rows() == 5);
+    REQUIRE(model->prior_size() == 54);
+
+    auto states = reference_states(model->state_size(), 1);
+    std::vector<float> priors(model->prior_size());
+    std::vector<float> values(1);
+    model->inference(states, {priors, values});
+
+    CHECK(values[0] == Catch::Approx(-0.94093913f).margin(1e-4));
+    CHECK(priors[0] == Catch::Approx(1.7724436e-05f).margin(1e-6));
+    CHECK(priors[53] == Catch::Approx(0.05530742f).margin(1e-5));
+    CHECK(std::ranges::max_element(priors) - priors.begin() == 37);
+
+    SECTION("Buffers that do not fit the model are rejected") {
+        std::vector<float> too_many(model->state_size() * 3);
+        std::vector<float> more_priors(model->prior_size() * 3);
+        std::vector<float> more_values(3);
+        CHECK_THROWS(model->inference(too_many, {more_priors, more_values}));
+    }
+}
+
+TEST_CASE("Benchmark Winograd against direct convolutions", "[.benchmark][CPU Model]") {
+    auto const weights =
+        resnet_from_onnx(read_onnx_graph(DEEP_WW_MODELS_DIR "/8x8_750000.onnx"));
+    int const height = weights.columns;
+    int const width = weights.rows;
+
+    struct Layer {
+        char const* name;
+        ResNetWeights::Conv const& conv;
+    };
+    std::vector<Layer> const layers{{"start", weights.start},
+                                    {"block", weights.blocks.at(0)[0]},
+                                    {"prior head", weights.prior_conv}};
+
+    std::mt19937 twister{42};
+    std::cout << "Layer       Batch  Direct (us)  Winograd (us)  Speedup\n";
+    for (Layer const& layer : layers) {
+        auto const conv = pack_conv3x3(layer.conv.weights, layer.conv.bias,
+                                       layer.conv.out_channels, layer.conv.in_channels);
+        auto const winograd = winograd_conv3x3(conv);
+
+        for (int batch : {1, 16, 128}) {
+            auto const in = random_images({height, width, conv.in_channels}, batch, twister);
+            std::vector<float> out(ImageShape{height, width, conv.out_channels}.size() * batch);
+            std::vector<float> scratch(winograd_scratch_size(winograd, height, width, batch));
+
+            // Runs for at least 0.2 s, after a warm up call.
+            auto time = [&](auto const& convolve) {
+                convolve();
+                int runs = 0;
+                auto const start = std::chrono::steady_clock::now();
+                std::chrono::duration<double, std::micro> elapsed{};
+                do {
+                    convolve();
+                    ++runs;
+                    elapsed = std::chrono::steady_clock::now() - start;
+                } while (elapsed.count() < 2e5);
+                return elapsed.count() / runs;
+            };
+
+            double const direct =
+                time([&] { conv3x3(conv, height, width, in.data(), out.data(), batch); });
+            double const fast = time([&] {
+                conv3x3_winograd(winograd, height, width, in.data(), out.data(), batch,
+                                 scratch.data());
+            });
+
+            std::cout << std::left << std::setw(12) << layer.name << std::right << std::setw(5)
+                      << batch << std::fixed << std::setprecision(1) << std::setw(13) << direct
+                      << std::setw(15) << fast << std::setprecision(2) << std::setw(9)
+                      << direct / fast << "\n";
+        }
+    }
+}
+
+TEST_CASE("Benchmark fused convolution epilogues", "[.benchmark][CPU Model]") {
+    auto const weights =
+        resnet_from_onnx(read_onnx_graph(DEEP_WW_MODELS_DIR "/8x8_750000.onnx"));
+    int const height = weights.columns;
+    int const width = weights.rows;
+    auto const& [conv1, conv2] = weights.blocks.at(0);
+    auto const first = pack_conv3x3(conv1.weights, conv1.bias, conv1.out_channels,
+                                    conv1.in_channels);
+    auto const second = pack_conv3x3(conv2.weights, conv2.bias, conv2.out_channels,
+                                     conv2.in_channels);
+    auto const winograd_first = winograd_conv3x3(first);
+    auto const winograd_second = winograd_conv3x3(second);
+    ImageShape const shape{height, width, first.out_channels};
+
+    std::mt19937 twister{42};
+    std::cout << "Residual block  Batch  Unfused (us)  Fused (us)  Speedup\n";
+    for (bool winograd : {false, true}) {
+        for (int batch : {1, 16, 128}) {
+            auto x = random_images(shape, batch, twister);
+            relu(x);
+            std::vector<float> t(x.size());
+            std::vector<float> y(x.size());
+            std::vector<float> scratch(
+                winograd_scratch_size(winograd_first, height, width, batch));
+            std::span<float> const all_t{t};
+            std::span<float> const all_y{y};
+
+            auto convolve = [&](int layer, float const* in, float* out, ConvEpilogue epilogue) {
+                if (winograd) {
+                    conv3x3_winograd(layer == 0 ? winograd_first : winograd_second, height,
+                                     width, in, out, batch, scratch.data(), epilogue);
+                } else {
+                    conv3x3(layer == 0 ? first : second, height, width, in, out, batch,
+                            epilogue);
+                }
+            };
+
+            auto time = [&](auto const& block) {
+                block();
+                int runs = 0;
+                auto const start = std::chrono::steady_clock::now();
+                std::chrono::duration<double, std::micro> elapsed{};
+                do {
+                    block();
+                    ++runs;
+                    elapsed = std::chrono::steady_clock::now() - start;
+                } while (elapsed.count() < 2e5);
+                return elapsed.count() / runs;
+            };
+
+            double const unfused = time([&] {
+                convolve(0, x.data(), t.data(), {});
+                relu(all_t);
+                convolve(1, t.data(), y.data(), {});
+                add_relu(all_y, x);
+            });
+            double const fused = time([&] {
+                convolve(0, x.data(), t.data(), {.relu = true});
+                convolve(1, t.data(), y.data(), {.residual = x.data(), .relu = true});
+            });
+
+            std::cout << std::left << std::setw(16) << (winograd ? "winograd" : "direct")
+                      << std::right << std::setw(5) << batch << std::fixed
+                      << std::setprecision(1) << std::setw(14) << unfused << std::setw(12)
+                      << fused << std::setprecision(2) << std::setw(9) << unfused / fused
+                      << "\n";
+        }
+    }
+}
@@ -0,0 +1,260 @@
+#include "elo.hpp"
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+struct SimulatedPlayer {
+    std::string name;
+    double elo;
+};
+
+// Plays games between random pairs of players in the model of BayesElo.
+static void simulate_games(BayesElo& elo, std::vector<SimulatedPlayer> const& players, int games,
+                           double advantage, double draw_elo, std::uint32_t seed) {
+    std::mt19937 rng{seed};
+    std::uniform_int_distribution<int> pick(0, int(players.size()) - 1);
+    std::uniform_real_distribution<double> outcome(0, 1);
+
+    for (int i = 0; i < games; ++i) {
+        int const red = pick(rng);
+        int blue = pick(rng);
+        while (blue == red) {
+            blue = pick(rng);
+        }
+
+        double const x = players[red].elo - players[blue].elo + advantage;
+        double const red_wins = 1 / (1 + std::pow(10, -(x - draw_elo) / 400));
+        double const blue_wins = 1 / (1 + std::pow(10, -(-x - draw_elo) / 400));
+        double const roll = outcome(rng);
+        Winner const winner = roll < red_wins               ? Winner::Red
+                              : roll < red_wins + blue_wins ? Winner::Blue
+                                                            : Winner::Draw;
+        elo.add_game(players[red].name, players[blue].name, winner);
+    }
+}
+
+TEST_CASE("Recover simulated ratings", "[Elo]") {
+    std::vector<SimulatedPlayer> const players{{"a", -200}, {"b", -50}, {"c", 50}, {"d", 200}};
+    BayesElo elo;
+    simulate_games(elo, players, 20000, 40, 80, 1);
+    REQUIRE(elo.rated_games() == 20000);
+
+    EloRatings const ratings = elo.estimate();
+    REQUIRE(ratings.players.size() == 4);
+    CHECK(ratings.players[0].name == "d");
+    CHECK(ratings.players[3].name == "a");
+    CHECK(ratings.advantage == Catch::Approx(40).margin(10));
+    CHECK(ratings.draw_elo == Catch::Approx(80).margin(10));
+
+    for (SimulatedPlayer const& player : players) {
+        PlayerRating const& rating = ratings.at(player.name);
+        CHECK(rating.elo == Catch::Approx(player.elo).margin(20));
+        CHECK(rating.lower < rating.elo);
+        CHECK(rating.upper > rating.elo);
+        CHECK(rating.upper - rating.lower < 30);
+        CHECK(rating.games > 9000);
+    }
+    CHECK(ratings.at("d").score > 0.5);
+    CHECK(ratings.at("a").score < 0.5);
+}
+
+TEST_CASE("Rate lopsided and undecided games", "[Elo]") {
+    BayesElo elo;
+    for (int i = 0; i < 10; ++i) {
+        elo.add_game("strong", "weak", Winner::Red);
+        elo.add_game("weak", "strong", Winner::Blue);
+    }
+    elo.add_game("strong", "weak", Winner::Undecided);
+    elo.add_game("other", "weak", Winner::Undecided);
+    CHECK(elo.rated_games() == 20);
+
+    // Never losing does not make the rating infinite.
+    EloRatings const ratings = elo.estimate();
+    REQUIRE(ratings.players.size() == 2);
+    CHECK(ratings.players[0].name == "strong");
+    CHECK(std::isfinite(ratings.players[0].elo));
+    CHECK(ratings.players[0].elo > 200);
+    CHECK(ratings.players[0].elo == Catch::Approx(-ratings.players[1].elo));
+    CHECK(ratings.players[0].score == 1);
+    // Without draws and with balanced colors there is nothing to fit.
+    CHECK(ratings.draw_elo == 0);
+    CHECK(ratings.advantage == Catch::Approx(0).margin(1e-6));
+}
+
+TEST_CASE("Update ratings as games come in", "[Elo]") {
+    std::vector<SimulatedPlayer> const players{
+        {"a", 0}, {"b", 100}, {"c", 150}, {"d", 300}, {"e", -100}};
+    EloOptions const opts{.offset = 1500};
+
+    BayesElo incremental{opts};
+    simulate_games(incremental, players, 2000, 30, 60, 2);
+    EloRatings const first = incremental.estimate();
+    simulate_games(incremental, players, 200, 30, 60, 3);
+    EloRatings const second = incremental.estimate();
+    // Warm started from the first estimate.
+    CHECK(second.iterations < first.iterations);
+
+    BayesElo batch{opts};
+    simulate_games(batch, players, 2000, 30, 60, 2);
+    simulate_games(batch, players, 200, 30, 60, 3);
+    EloRatings const expected = batch.estimate();
+
+    double sum = 0;
+    for (SimulatedPlayer const& player : players) {
+        CHECK(second.at(player.name).elo ==
+              Catch::Approx(expected.at(player.name).elo).margin(1e-3));
+        sum += second.at(player.name).elo;
+    }
+    CHECK(sum / players.size() == Catch::Approx(1500));
+    CHECK(second.advantage == Catch::Approx(expected.advantage).margin(1e-3));
+}
+
+TEST_CASE("Fixed advantage and draw Elo", "[Elo]") {
+    BayesElo elo{{.fit_advantage = false, .fit_draw_elo = false, .advantage = 50}};
+    elo.add_game("a", "b", Winner::Draw);
+    elo.add_game("b", "a", Winner::Draw);
+
+    EloRatings const ratings = elo.estimate();
+    CHECK(ratings.advantage == 50);
+    CHECK(ratings.draw_elo == 100);
+    CHECK(ratings.at("a").elo == Catch::Approx(0).margin(1e-6));
+    CHECK(ratings.at("a").draw_rate == 1);
+}
+
+TEST_CASE("Write rating tables", "[Elo]") {
+    BayesElo elo;
+    elo.add_game("model_1.trt", "model_2.trt", Winner::Red);
+    elo.add_game("model_2.trt", "model_1.trt", Winner::Draw);
+
+    auto const path = std::filesystem::temp_directory_path() / "deep_ww_elo_ratings.txt";
+    write_ratings(elo.estimate(), path);
+
+    std::ifstream file{path};
+    std::vector<std::string> words;
+    for (std::string word; file >> word && words.size() < 18;) {
+        words.push_back(word);
+    }
+    std::filesystem::remove(path);
+
+    REQUIRE(words.size() == 18);
+    CHECK(words[0] == "Rank");
+    CHECK(words[1] == "Name");
+    CHECK(words[2] == "Elo");
+    CHECK(words[9] == "1");
+    CHECK(words[10] == "model_1.trt");
+    CHECK(words[14] == "2");
+    CHECK(words[15] == "75%");
+}
+
+TEST_CASE("Read rating tables", "[Elo]") {
+    BayesElo elo;
+    simulate_games(elo, {{"a", -100}, {"b", 0}, {"c", 100}}, 300, 30, 60, 6);
+    EloRatings const ratings = elo.estimate();
+
+    auto const path = std::filesystem::temp_directory_path() / "deep_ww_read_elo_ratings.txt";
+    write_ratings(ratings, path);
+    auto const read = read_ratings(path);
+    std::filesystem::remove(path);
+
+    REQUIRE(read.size() == 3);
+    for (std::size_t i = 0; i < read.size(); ++i) {
+        CHECK(read[i].name == ratings.players[i].name);
+        CHECK(read[i].elo == Catch::Approx(ratings.players[i].elo).margin(0.5));
+        CHECK(read[i].upper - read[i].lower ==
+              Catch::Approx(ratings.players[i].upper - ratings.players[i].lower).margin(1));
+        CHECK(read[i].games == ratings.players[i].games);
+        CHECK(read[i].score == Catch::Approx(ratings.players[i].score).margin(0.005));
+    }
+    CHECK_THROWS(read_ratings(path));
+}
+
+TEST_CASE("Rate a new player against fixed ratings", "[Elo]") {
+    std::vector<SimulatedPlayer> const anchors{{"a", 1300}, {"b", 1500}, {"c", 1700}};
+    std::vector<SimulatedPlayer> players = anchors;
+    players.push_back({"new", 1600});
+
+    BayesElo elo;
+    for (SimulatedPlayer const& anchor : anchors) {
+        elo.fix_rating(anchor.name, anchor.elo);
+    }
+    simulate_games(elo, players, 4000, 30, 60, 7);
+    EloRatings const ratings = elo.estimate();
+
+    // The anchors keep their ratings, not shifted to a mean of zero.
+    for (SimulatedPlayer const& anchor : anchors) {
+        CHECK(ratings.at(anchor.name).elo == anchor.elo);
+        CHECK(ratings.at(anchor.name).lower == anchor.elo);
+        CHECK(ratings.at(anchor.name).upper == anchor.elo);
+    }
+    PlayerRating const& rating = ratings.at("new");
+    CHECK(rating.elo == Catch::Approx(1600).margin(30));
+    CHECK(rating.lower < rating.elo);
+    CHECK(rating.upper > rating.elo);
+    CHECK(ratings.advantage == Catch::Approx(30).margin(15));
+}
+
+TEST_CASE("Read game outcomes", "[Elo]") {
+    Board const board{3, 3};
+    std::vector<GameRecorder> recorders;
+    for (Winner winner : {Winner::Red, Winner::Blue, Winner::Draw, Winner::Undecided}) {
+        GameRecorder& recorder = recorders.emplace_back(board, "x", "y");
+        recorder.record_winner(winner);
+    }
+
+    auto const path = std::filesystem::temp_directory_path() / "deep_ww_elo_games.json";
+    {
+        std::ofstream file{path};
+        file << all_to_json(recorders);
+        // Written before the result was part of the JSON.
+        file << R"({"creator": "y", "joiner": "x", "rows": 3, "columns": 3, "moves": ""})"
+             << "\n";
+    }
+    auto const outcomes = read_game_outcomes(path);
+    std::filesystem::remove(path);
+
+    REQUIRE(outcomes.size() == 5);
+    CHECK(outcomes[0].red == "x");
+    CHECK(outcomes[0].blue == "y");
+    CHECK(outcomes[0].winner == Winner::Red);
+    CHECK(outcomes[1].winner == Winner::Blue);
+    CHECK(outcomes[2].winner == Winner::Draw);
+    CHECK(outcomes[3].winner == Winner::Undecided);
+    CHECK(outcomes[4].red == "y");
+    CHECK(outcomes[4].winner == Winner::Undecided);
+}
+
+// Rates a ranking-sized field with tens of thousands of games.
+TEST_CASE("Benchmark Elo estimation", "[.benchmark][Elo]") {
+    std::vector<SimulatedPlayer> players;
+    for (int i = 0; i < 60; ++i) {
+        players.push_back({"model_" + std::to_string(i), 10.0 * i});
+    }
+
+    BayesElo elo;
+    auto start = std::chrono::steady_clock::now();
+    simulate_games(elo, players, 20000, 30, 60, 4);
+    double const add_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    EloRatings const ratings = elo.estimate();
+    double const estimate_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    simulate_games(elo, players, 1000, 30, 60, 5);
+    start = std::chrono::steady_clock::now();
+    EloRatings const updated = elo.estimate();
+    double const update_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Adding 20000 games: " << add_ms << " ms (includes simulating them)\n"
+              << "Estimate: " << estimate_ms << " ms in " << ratings.iterations << " iterations\n"
+              << "Update after 1000 more games: " << update_ms << " ms in " << updated.iterations
+              << " iterations\n";
+}
@@ -0,0 +1,149 @@
+#include "evaluation_cache.hpp"
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+
+// Distinct positions on an 8x8 board by moving both cats around.
+static std::vector<CacheEntry> make_entries(int count) {
+    std::vector<CacheEntry> entries;
+    for (int i = 0; i < count; ++i) {
+        Cell red_cat{i % 8, (i / 8) % 8};
+        Cell blue_cat{(i / 64) % 8, (i / 512) % 8};
+        Turn turn{i % 2 ? Player::Red : Player::Blue, Turn::First};
+        entries.push_back({Board{8, 8, red_cat, {0, 7}, blue_cat, {7, 7}}, turn, {}});
+    }
+    return entries;
+}
+
+static CompactEvaluation::Ref make_evaluation(Board const& board, float value, int edges) {
+    std::vector<TreeEdge> tree_edges;
+    for (int i = 0; i < edges; ++i) {
+        tree_edges.emplace_back(Wall{{i % 8, i / 8}, Wall::Right}, 1.0f / edges);
+    }
+    return CompactEvaluation::make(board, value, tree_edges);
+}
+
+static CacheEntryView view(CacheEntry const& entry) {
+    return {entry.board, entry.turn, entry.previous_position};
+}
+
+TEST_CASE("Cached evaluations are found", "[Evaluation Cache]") {
+    EvaluationCache cache{1 << 20};
+    auto const entries = make_entries(2);
+    auto const hash = EvaluationCache::hash(view(entries[0]));
+
+    CHECK_FALSE(cache.find(view(entries[0]), hash));
+
+    cache.insert(entries[0], hash, make_evaluation(entries[0].board, 0.25f, 3));
+
+    auto found = cache.find(view(entries[0]), hash);
+    REQUIRE(found);
+    CHECK(found->value == 0.25f);
+    REQUIRE(found->compact);
+    CHECK(found->compact->size() == 3);
+
+    SECTION("Keys are verified in full") {
+        CHECK_FALSE(cache.find(view(entries[1]), EvaluationCache::hash(view(entries[1]))));
+        // Even if the hashes collide.
+        CHECK_FALSE(cache.find(view(entries[1]), hash));
+
+        std::optional<PreviousPosition> previous = PreviousPosition{Pawn::Cat, {1, 0}};
+        CacheEntryView other_previous{entries[0].board, entries[0].turn, previous};
+        CHECK_FALSE(cache.find(other_previous, hash));
+    }
+}
+
+TEST_CASE("Cache stays within its memory budget", "[Evaluation Cache]") {
+    std::size_t const capacity = 64 << 10;
+    EvaluationCache cache{capacity};
+
+    for (auto const& entry : make_entries(1024)) {
+        cache.insert(entry, EvaluationCache::hash(view(entry)),
+                     make_evaluation(entry.board, 0.0f, 64));
+    }
+
+    CHECK(cache.size_bytes() > 0);
+    CHECK(cache.size_bytes() <= capacity);
+}
+
+// The previous CachedPolicy implementation, kept around for comparison.
+class ShardedLruCache {
+public:
+    ShardedLruCache(std::size_t capacity, unsigned shards) {
+        for (unsigned i = 0; i < shards; ++i) {
+            m_lrus.emplace_back(std::in_place, capacity / shards);
+        }
+    }
+
+    std::optional<Evaluation> find(CacheEntryView key, std::uint64_t hash) {
+        auto locked_lru = m_lrus[hash % m_lrus.size()].wlock();
+        auto existing_entry = locked_lru->find(key);
+        if (existing_entry == locked_lru->end()) {
+            return std::nullopt;
+        }
+        return existing_entry->second;
+    }
+
+    // Stores the evaluation with all its edges, as the previous implementation did.
+    void insert(CacheEntry key, std::uint64_t hash, CompactEvaluation::Ref evaluation) {
+        Evaluation full{evaluation->value(), evaluation->edges(key.board)};
+        m_lrus[hash % m_lrus.size()].wlock()->insert(std::move(key), std::move(full));
+    }
+
+private:
+    std::vector<folly::Synchronized<folly::EvictingCacheMap<CacheEntry, Evaluation>>> m_lrus;
+};
+
+template <typename Cache>
+static void benchmark_hits(std::string_view name, Cache& cache,
+                           std::vector<CacheEntry> const& entries) {
+    constexpr int kLookupsPerThread = 200'000;
+
+    std::vector<std::uint64_t> hashes;
+    for (auto const& entry : entries) {
+        hashes.push_back(EvaluationCache::hash(view(entry)));
+        cache.insert(entry, hashes.back(), make_evaluation(entry.board, 0.0f, 128));
+    }
+
+    for (int threads : {8, 16, 32}) {
+        std::atomic<int> hits = 0;
+        auto const start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::jthread> workers;
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    std::mt19937 twister(t);
+                    std::uniform_int_distribution<std::size_t> dist(0, entries.size() - 1);
+                    int local_hits = 0;
+                    for (int i = 0; i < kLookupsPerThread; ++i) {
+                        std::size_t const k = dist(twister);
+                        local_hits += bool(cache.find(view(entries[k]), hashes[k]));
+                    }
+                    hits += local_hits;
+                });
+            }
+        }
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+        double const lookups = double(threads) * kLookupsPerThread;
+        std::cout << name << " @ " << threads << " threads: " << lookups / elapsed.count() / 1e6
+                  << " M hits/s, " << elapsed.count() * threads / lookups * 1e9
+                  << " ns/hit, hit rate " << hits / lookups << "\n";
+    }
+}
+
+TEST_CASE("Hit throughput vs. sharded LRU", "[.benchmark][Evaluation Cache]") {
+    auto const entries = make_entries(4096);
+
+    EvaluationCache concurrent{std::size_t{256} << 20};
+    benchmark_hits("EvaluationCache", concurrent, entries);
+
+    ShardedLruCache sharded{100'000, std::thread::hardware_concurrency()};
+    benchmark_hits("ShardedLruCache", sharded, entries);
+}
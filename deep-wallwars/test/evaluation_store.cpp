@@ -0,0 +1,162 @@
+#include "evaluation_store.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include "mcts.hpp"
+
+static std::filesystem::path temp_store_path() {
+    auto path = std::filesystem::temp_directory_path() /
+                ("evaluation_store_test_" + std::to_string(::getpid()) + ".bin");
+    std::filesystem::remove(path);
+    return path;
+}
+
+static CompactEvaluation::Ref make_evaluation(Board const& board, float value) {
+    std::vector<TreeEdge> edges;
+    edges.emplace_back(PawnMove{Pawn::Cat, Direction::Right}, 0.5f);
+    edges.emplace_back(Wall{{2, 3}, Wall::Down}, 0.25f);
+    edges.emplace_back(PawnMove{Pawn::Mouse, Direction::Up}, 0.25f);
+    return CompactEvaluation::make(board, value, edges);
+}
+
+TEST_CASE("Evaluation store", "[Evaluation Store]") {
+    constexpr std::size_t kMaxBytes = 1 << 20;
+    constexpr std::uint64_t kModel = 17;
+
+    auto const path = temp_store_path();
+    Board board{6, 6};
+    Turn turn{Player::Red, Turn::First};
+    std::optional<PreviousPosition> previous;
+    CacheEntryView key{board, turn, previous};
+    auto const hash = EvaluationCache::hash(key);
+
+    {
+        EvaluationStore store{path, kModel, kMaxBytes};
+        REQUIRE(store.writable());
+        CHECK_FALSE(store.find(key, hash));
+        store.append(key, hash, make_evaluation(board, 0.5f));
+    }
+
+    SECTION("Evaluations survive a restart") {
+        EvaluationStore store{path, kModel, kMaxBytes};
+        CHECK(store.size() == 1);
+
+        auto found = store.find(key, hash);
+        REQUIRE(found);
+        CHECK((*found)->value() == 0.5f);
+
+        auto const edges = (*found)->edges(board);
+        REQUIRE(edges.size() == 3);
+        CHECK(edges[1].action == Action{Wall{{2, 3}, Wall::Down}});
+        CHECK(edges[1].prior == 0.25f);
+
+        // Same hash, different position.
+        Board other = board;
+        other.place_wall(Player::Blue, Wall{{0, 0}, Wall::Right});
+        CHECK_FALSE(store.find({other, turn, previous}, hash));
+    }
+
+    SECTION("A second process only reads") {
+        EvaluationStore writer{path, kModel, kMaxBytes};
+        EvaluationStore reader{path, kModel, kMaxBytes};
+        REQUIRE_FALSE(reader.writable());
+        CHECK(reader.find(key, hash));
+
+        // New evaluations of the writer become visible to the reader.
+        Turn other_turn{Player::Blue, Turn::First};
+        CacheEntryView other_key{board, other_turn, previous};
+        auto const other_hash = EvaluationCache::hash(other_key);
+
+        writer.append(other_key, other_hash, make_evaluation(board, -1.0f));
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+        while (!reader.find(other_key, other_hash) && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        CHECK(reader.find(other_key, other_hash));
+    }
+
+    SECTION("Replacing a store keeps its readers intact") {
+        std::optional<EvaluationStore> writer{std::in_place, path, kModel, kMaxBytes};
+        EvaluationStore reader{path, kModel, kMaxBytes};
+        writer.reset();
+
+        EvaluationStore other{path, kModel + 1, kMaxBytes};
+        REQUIRE(other.writable());
+        CHECK(reader.find(key, hash));
+    }
+
+    SECTION("Stores of other models are reset") {
+        EvaluationStore store{path, kModel + 1, kMaxBytes};
+        CHECK(store.size() == 0);
+        CHECK_FALSE(store.find(key, hash));
+    }
+
+    SECTION("Torn appends are dropped") {
+        auto const size = std::filesystem::file_size(path);
+        std::filesystem::resize_file(path, size - 4);
+
+        EvaluationStore store{path, kModel, kMaxBytes};
+        CHECK(store.size() == 0);
+        CHECK_FALSE(store.find(key, hash));
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Readers check the header once it is written", "[Evaluation Store]") {
+    constexpr std::size_t kMaxBytes = 1 << 20;
+    constexpr std::uint64_t kModel = 17;
+
+    auto const path = temp_store_path();
+    auto const other_path = path.string() + ".other";
+    Board board{6, 6};
+    Turn turn{Player::Red, Turn::First};
+    CacheEntryView key{board, turn, std::nullopt};
+    auto const hash = EvaluationCache::hash(key);
+
+    {
+        EvaluationStore other{other_path, kModel + 1, kMaxBytes};
+        other.append(key, hash, make_evaluation(board, 0.5f));
+    }
+
+    // Stands in for a writer that has not written the header yet.
+    int const fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    REQUIRE(::flock(fd, LOCK_EX) == 0);
+    EvaluationStore reader{path, kModel, kMaxBytes};
+    REQUIRE_FALSE(reader.writable());
+
+    std::ifstream file{other_path, std::ios::binary};
+    std::string const contents{std::istreambuf_iterator<char>{file}, {}};
+    REQUIRE(::pwrite(fd, contents.data(), contents.size(), 0) == ssize_t(contents.size()));
+
+    for (int i = 0; i < 10; ++i) {
+        CHECK_FALSE(reader.find(key, hash));
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+
+    ::close(fd);
+    std::filesystem::remove(path);
+    std::filesystem::remove(other_path);
+}
+
+TEST_CASE("Model identities cover the evaluation settings", "[Evaluation Store]") {
+    auto const path = temp_store_path();
+    std::ofstream{path, std::ios::binary} << std::string(3'000'000, 'w');
+
+    auto const identity = model_identity(path, "cpu_winograd=false");
+    CHECK(model_identity(path, "cpu_winograd=false") == identity);
+    CHECK(model_identity(path, "cpu_winograd=true") != identity);
+
+    std::ofstream{path, std::ios::binary | std::ios::app} << 'w';
+    CHECK(model_identity(path, "cpu_winograd=false") != identity);
+
+    std::filesystem::remove(path);
+}
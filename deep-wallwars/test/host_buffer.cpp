@@ -0,0 +1,184 @@
+#include "host_buffer.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "batched_model.hpp"
+#include "model.hpp"
+
+static bool aligned_to(void const* data, std::size_t alignment) {
+    return reinterpret_cast<std::uintptr_t>(data) % alignment == 0;
+}
+
+// Hands out default memory, but keeps count of it.
+struct CountingAllocator : HostAllocator {
+    void* allocate(std::size_t bytes) override {
+        ++allocations;
+        live_bytes += bytes;
+        return default_host_allocator()->allocate(bytes);
+    }
+
+    void deallocate(void* data, std::size_t bytes) noexcept override {
+        live_bytes -= bytes;
+        default_host_allocator()->deallocate(data, bytes);
+    }
+
+    std::atomic<int> allocations = 0;
+    std::atomic<std::size_t> live_bytes = 0;
+};
+
+struct AllocatingModel : Model {
+    AllocatingModel(std::shared_ptr<HostAllocator> allocator)
+        : Model{4, kModelInputChannels, 3, 3}, m_allocator{std::move(allocator)} {}
+
+    void inference(std::span<float> states, Output const& out) override {
+        for (int i = 0; i < int(out.values.size()); ++i) {
+            out.priors[prior_size() * i] = states[m_state_size * i];
+            out.values[i] = 0.5f;
+        }
+    }
+
+    std::shared_ptr<HostAllocator> host_allocator() const override {
+        return m_allocator;
+    }
+
+    std::shared_ptr<HostAllocator> m_allocator;
+};
+
+TEST_CASE("Aligned host buffers", "[Host Buffer]") {
+    SECTION("Small buffers are aligned to cache lines") {
+        HostBuffer<float> buffer(3);
+        REQUIRE(buffer.size() == 3);
+        CHECK(aligned_to(buffer.data(), AlignedHostAllocator::kAlignment));
+        CHECK(buffer[0] == 0.0f);
+        CHECK(buffer[2] == 0.0f);
+    }
+
+    SECTION("Large buffers are aligned to huge pages") {
+        std::size_t const size = AlignedHostAllocator::kHugePageSize / sizeof(float) + 1;
+        HostBuffer<float> buffer(size);
+        CHECK(aligned_to(buffer.data(), AlignedHostAllocator::kHugePageSize));
+        CHECK(buffer[size - 1] == 0.0f);
+    }
+
+    SECTION("Empty buffers") {
+        HostBuffer<float> buffer(0);
+        CHECK(buffer.size() == 0);
+        CHECK(std::span<float>(buffer).empty());
+    }
+}
+
+TEST_CASE("Move host buffers", "[Host Buffer]") {
+    auto allocator = std::make_shared<CountingAllocator>();
+    HostBuffer<int> first(4, allocator);
+    first[1] = 7;
+    int* const data = first.data();
+
+    HostBuffer<int> second{std::move(first)};
+    CHECK(second.data() == data);
+    CHECK(second[1] == 7);
+    CHECK(first.size() == 0);
+
+    HostBuffer<int> third(2, allocator);
+    third = std::move(second);
+    CHECK(third.data() == data);
+    CHECK(third.size() == 4);
+
+    // Only the two original allocations, both still alive.
+    CHECK(allocator->allocations == 2);
+    CHECK(allocator->live_bytes == 6 * sizeof(int));
+}
+
+TEST_CASE("Batched model allocates with the allocator of the model", "[Host Buffer]") {
+    auto allocator = std::make_shared<CountingAllocator>();
+    auto bm = std::make_unique<BatchedModel>(std::make_unique<AllocatingModel>(allocator), 12);
+
+    Board board{3, 3};
+    Turn turn{Player::Blue, Turn::First};
+    auto result = bm->inference(board, turn).get();
+    CHECK(result.value == 0.5f);
+    // States, values and at least one prior slab.
+    CHECK(allocator->allocations >= 3);
+
+    // The result keeps its slab alive even after the model is gone.
+    bm.reset();
+    CHECK(allocator->live_bytes > 0);
+    result = {};
+    CHECK(allocator->live_bytes == 0);
+}
+
+TEST_CASE("Slab pool", "[Host Buffer]") {
+    auto allocator = std::make_shared<CountingAllocator>();
+    SlabPool pool(16, allocator);
+
+    SECTION("Free slabs are reused") {
+        auto first = pool.acquire();
+        HostBuffer<float> const* const data = first.get();
+        first.reset();
+        CHECK(pool.acquire().get() == data);
+        CHECK(pool.allocations() == 1);
+    }
+
+    SECTION("Busy slabs beyond the pool are not kept") {
+        std::vector<std::shared_ptr<HostBuffer<float>>> held;
+        for (std::size_t i = 0; i < 3 * SlabPool::kMaxPooledSlabs; ++i) {
+            held.push_back(pool.acquire());
+        }
+        CHECK(pool.allocations() == 3 * SlabPool::kMaxPooledSlabs);
+
+        held.clear();
+        CHECK(allocator->live_bytes == SlabPool::kMaxPooledSlabs * 16 * sizeof(float));
+        for (std::size_t i = 0; i < SlabPool::kMaxPooledSlabs; ++i) {
+            held.push_back(pool.acquire());
+        }
+        CHECK(pool.allocations() == 3 * SlabPool::kMaxPooledSlabs);
+    }
+}
+
+// Delivering the priors of a batch as views into a pooled slab, against the previous copy of each
+// result's priors into its own vector.
+TEST_CASE("Benchmark prior delivery", "[.benchmark][Host Buffer]") {
+    // Batches of 256 positions of a 12x10 board: 2 walls per cell and 4 pawn moves.
+    std::size_t const batch_size = 256;
+    std::size_t const prior_size = 2 * 12 * 10 + 4;
+    int const batches = 2000;
+    HostBuffer<float> output(batch_size * prior_size);
+
+    auto time_ms = [](auto&& deliver) {
+        auto const start = std::chrono::steady_clock::now();
+        deliver();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count();
+    };
+
+    std::vector<std::vector<float>> copies(batch_size);
+    double const copy_ms = time_ms([&] {
+        for (int b = 0; b < batches; ++b) {
+            for (std::size_t i = 0; i < batch_size; ++i) {
+                float const* prior = output.data() + i * prior_size;
+                copies[i] = std::vector<float>(prior, prior + prior_size);
+            }
+        }
+    });
+
+    SlabPool pool(batch_size * prior_size, default_host_allocator());
+    std::vector<std::pair<std::shared_ptr<HostBuffer<float> const>, std::span<float const>>> views(
+        batch_size);
+    double const view_ms = time_ms([&] {
+        for (int b = 0; b < batches; ++b) {
+            auto slab = pool.acquire();
+            for (std::size_t i = 0; i < batch_size; ++i) {
+                views[i] = {slab, {slab->data() + i * prior_size, prior_size}};
+            }
+        }
+    });
+
+    std::cout << "Copying priors: " << copy_ms / batches << " ms per batch\n"
+              << "Slab views: " << view_ms / batches << " ms per batch, " << pool.allocations()
+              << " slabs allocated\n";
+}
@@ -0,0 +1,148 @@
+#include "inference_executor.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <folly/experimental/coro/BlockingWait.h>
+#include <folly/experimental/coro/Collect.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <ranges>
+#include <stdexcept>
+
+#include "batched_model.hpp"
+#include "batched_model_policy.hpp"
+#include "cpu_model.hpp"
+#include "mcts.hpp"
+
+static std::vector<int> available_cpus() {
+    cpu_set_t available;
+    REQUIRE(sched_getaffinity(0, sizeof(available), &available) == 0);
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &available)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+TEST_CASE("Parse CPU lists", "[Inference Executor]") {
+    CHECK(parse_cpu_list("") == std::vector<int>{});
+    CHECK(parse_cpu_list("3") == std::vector<int>{3});
+    CHECK(parse_cpu_list("0-3,8,10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+
+    CHECK_THROWS(parse_cpu_list("a"));
+    CHECK_THROWS(parse_cpu_list("-1"));
+    CHECK_THROWS(parse_cpu_list("1-"));
+    CHECK_THROWS(parse_cpu_list("3-1"));
+    CHECK_THROWS(parse_cpu_list("1,,2"));
+    CHECK_THROWS(parse_cpu_list("0-100000"));
+}
+
+TEST_CASE("Run every task once", "[Inference Executor]") {
+    InferenceExecutor executor{3};
+    CHECK(executor.threads() == 3);
+
+    std::vector<std::atomic<int>> runs(10);
+    executor.parallel_for(10, [&](int i) { ++runs[i]; });
+    for (auto const& count : runs) {
+        CHECK(count == 1);
+    }
+
+    // Two callers at once, like two models sharing the executor.
+    std::atomic<int> sum = 0;
+    std::jthread other{[&] { executor.parallel_for(100, [&](int i) { sum += i; }); }};
+    executor.parallel_for(100, [&](int i) { sum += i; });
+    other.join();
+    CHECK(sum == 2 * 4950);
+}
+
+TEST_CASE("Rethrow exceptions of tasks", "[Inference Executor]") {
+    InferenceExecutor executor{2};
+    std::atomic<int> runs = 0;
+    CHECK_THROWS_AS(executor.parallel_for(5,
+                                          [&](int i) {
+                                              ++runs;
+                                              if (i == 3) {
+                                                  throw std::logic_error("Task failed");
+                                              }
+                                          }),
+                    std::logic_error);
+    CHECK(runs == 5);
+
+    // The executor still works afterwards.
+    executor.parallel_for(2, [&](int) { ++runs; });
+    CHECK(runs == 7);
+}
+
+TEST_CASE("Pin threads to CPUs", "[Inference Executor]") {
+    int const cpu = available_cpus().at(0);
+    InferenceExecutor executor{std::vector{cpu}};
+    CHECK(executor.threads() == 1);
+
+    int ran_on = -1;
+    executor.parallel_for(1, [&](int) { ran_on = sched_getcpu(); });
+    CHECK(ran_on == cpu);
+
+    CHECK_THROWS(InferenceExecutor{std::vector{CPU_SETSIZE - 1}});
+    CHECK_THROWS(InferenceExecutor{std::vector<int>{}});
+}
+
+// Splits the cores of the host between search threads and pinned inference threads, and measures
+// the MCTS throughput of self-play like searches with the 8x8 model.
+TEST_CASE("Benchmark splitting cores between search and inference",
+          "[.benchmark][Inference Executor]") {
+    auto const cpus = available_cpus();
+    int const cores = int(cpus.size());
+    if (cores < 2) {
+        std::cout << "Needs at least two cores\n";
+        return;
+    }
+
+    int const trees = 32;
+    int const samples = 400;
+    std::cout << "Inference cores, search cores, samples/s, average batch\n";
+
+    int previous = 0;
+    for (int eighths = 1; eighths < 8; ++eighths) {
+        int const inference = std::clamp(cores * eighths / 8, 1, cores - 1);
+        if (inference == previous) {
+            continue;
+        }
+        previous = inference;
+
+        std::vector<int> const inference_cpus(cpus.begin(), cpus.begin() + inference);
+        std::vector<int> const search_cpus(cpus.begin() + inference, cpus.end());
+        auto executor = std::make_shared<InferenceExecutor>(inference_cpus);
+        folly::CPUThreadPoolExecutor search_pool(search_cpus.size(),
+                                                 pinned_thread_factory("Search", search_cpus));
+
+        std::vector<std::unique_ptr<Model>> models;
+        models.push_back(load_cpu_resnet(DEEP_WW_MODELS_DIR "/8x8_750000.onnx", 32, executor, {},
+                                         ConvAlgorithm::Winograd));
+        auto batched_model = std::make_shared<BatchedModel>(std::move(models), 4096);
+        BatchedModelPolicy policy{batched_model};
+
+        std::vector<std::unique_ptr<MCTS>> searches;
+        for (int i = 0; i < trees; ++i) {
+            MCTS::Options const opts{.max_parallelism = 8, .seed = std::uint32_t(i)};
+            searches.push_back(std::make_unique<MCTS>(policy, Board{8, 8}, opts));
+        }
+
+        auto const start = std::chrono::steady_clock::now();
+        folly::coro::blockingWait(folly::coro::collectAllRange(
+            searches | std::views::transform([&](auto const& mcts) {
+                return mcts->sample(samples).scheduleOn(&search_pool);
+            })));
+        double const seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << inference << ", " << cores - inference << ", "
+                  << trees * samples / seconds << ", "
+                  << double(batched_model->total_inferences()) / batched_model->total_batches()
+                  << "\n";
+    }
+}
@@ -1,6 +1,7 @@
 #include "mcts.hpp"
 
 #include <folly/Executor.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/GlobalExecutor.h>
 #include <folly/executors/QueuedImmediateExecutor.h>
 #include <folly/experimental/coro/BlockingWait.h>
@@ -8,8 +9,14 @@
 
 #include <atomic>
 #include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <iostream>
 #include <memory>
 
+#include "batched_model.hpp"
+#include "batched_model_policy.hpp"
+#include "cpu_model.hpp"
+#include "play.hpp"
 #include "simple_policy.hpp"
 
 // For testing, only generates moves downwards
@@ -115,3 +122,123 @@ TEST_CASE("Sample slow in parallel", "[MCTS]") {
     CHECK(mcts.root_samples() == 17);
     CHECK(*policy.samples > 3);
 }
+
+TEST_CASE("Two-tier search", "[MCTS]") {
+    Board board{4, 4};
+    DownPolicy policy;
+    DownPolicy fast_policy;
+    // The down moves lead through six positions: the root, the one below it, and four deeper ones,
+    // the last of which ends the game.
+    MCTS::Options opts{.fast_evaluate = fast_policy, .fast_depth = 1, .refine_samples = 10'000};
+
+    SECTION("Deep nodes use the fast evaluator") {
+        MCTS mcts{policy, board, opts};
+        folly::coro::blockingWait(mcts.sample(1000));
+
+        CHECK(*policy.samples == 2);
+        CHECK(*fast_policy.samples == 4);
+        CHECK(mcts.fast_evaluations() == 4);
+        CHECK(mcts.refined_evaluations() == 0);
+        CHECK(mcts.root_samples() == 1001);
+    }
+
+    SECTION("Visited nodes are evaluated again") {
+        opts.refine_samples = 2;
+        MCTS mcts{policy, board, opts};
+        folly::coro::blockingWait(mcts.sample(1000));
+
+        // Except for the end of the game, which needs no evaluation.
+        CHECK(mcts.refined_evaluations() == 3);
+        CHECK(*policy.samples == 5);
+        CHECK(mcts.root_samples() == 1001);
+    }
+
+    SECTION("Nodes close to a new root are evaluated again") {
+        MCTS mcts{policy, board, opts};
+        folly::coro::blockingWait(mcts.sample(10));
+        REQUIRE(mcts.commit_to_action());
+        REQUIRE(mcts.commit_to_action());
+        CHECK(mcts.refined_evaluations() == 0);
+
+        // The new root and the node below it.
+        folly::coro::blockingWait(mcts.sample(10));
+        CHECK(mcts.refined_evaluations() == 2);
+    }
+}
+
+TEST_CASE("Refined nodes take all actions of the main evaluator", "[MCTS]") {
+    Board board{5, 5};
+    // The fast evaluator only knows moves, the main one also places walls.
+    MCTS mcts{SimplePolicy{0.3, 1.5, 0.75},
+              board,
+              {.noise_factor = 0,
+               .fast_evaluate = SimplePolicy{1.0, 1.0, 1.0},
+               .fast_depth = 0,
+               .refine_samples = 10'000}};
+    folly::coro::blockingWait(mcts.sample(100));
+    CHECK(mcts.refined_evaluations() == 0);
+
+    // The new root was expanded by the fast evaluator and is refined by the next sample.
+    REQUIRE(mcts.commit_to_action());
+    folly::coro::blockingWait(mcts.sample(500));
+    CHECK(mcts.refined_evaluations() >= 1);
+
+    auto const edges = mcts.root_info().edges;
+    CHECK(std::ranges::any_of(edges, [](EdgeInfo const& edge) {
+        return std::holds_alternative<Wall>(edge.action) && edge.num_samples > 0;
+    }));
+}
+
+// Plays two-tier searches (the 8x8 model with SimplePolicy for deep nodes) against searches that
+// only use the model, with the same number of samples, and measures the throughput of both.
+TEST_CASE("Benchmark two-tier search", "[.benchmark][MCTS]") {
+    int const samples = 200;
+    int const games = 20;
+    Board const board{8, 8};
+    folly::CPUThreadPoolExecutor thread_pool(4);
+
+    auto load_model = [] {
+        return std::make_shared<BatchedModel>(
+            load_cpu_resnet(DEEP_WW_MODELS_DIR "/8x8_750000.onnx", 16, nullptr, {},
+                            ConvAlgorithm::Winograd),
+            4096);
+    };
+    auto const two_tier_model = load_model();
+    auto const full_model = load_model();
+    EvaluationFunction const fast = SimplePolicy{0.3, 1.5, 0.75};
+
+    std::cout << "Fast depth, model inferences per sample, samples/s, W/L/D against the model "
+                 "only\n";
+    for (int fast_depth : {1, 2, 4, 8}) {
+        EvaluationFunction const two_tier = BatchedModelPolicy{two_tier_model};
+
+        // Throughput of the first move.
+        std::size_t const inferences = two_tier_model->total_inferences();
+        auto const start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 10; ++i) {
+            MCTS mcts{two_tier,
+                      board,
+                      {.max_parallelism = 16,
+                       .seed = std::uint32_t(i),
+                       .fast_evaluate = fast,
+                       .fast_depth = fast_depth}};
+            folly::coro::blockingWait(mcts.sample(10 * samples).scheduleOn(&thread_pool));
+        }
+        double const seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double const per_sample =
+            double(two_tier_model->total_inferences() - inferences) / (100 * samples);
+
+        auto const recorders = folly::coro::blockingWait(
+            evaluation_play(board, games,
+                            {.model1 = {two_tier, "Two-tier", fast},
+                             .model2 = {BatchedModelPolicy{full_model}, "Model only"},
+                             .samples = samples,
+                             .fast_depth = fast_depth})
+                .scheduleOn(&thread_pool));
+        auto const results = tally_results(recorders).at("Two-tier");
+
+        std::cout << fast_depth << ", " << per_sample << ", " << 100 * samples / seconds << ", "
+                  << results.wins << "/" << results.losses << "/" << results.draws << "\n";
+    }
+}
@@ -0,0 +1,148 @@
+#include "model_host.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/experimental/coro/BlockingWait.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
+
+#include "model.hpp"
+#include "play.hpp"
+
+// Stand-in for a real model: the first prior of each position echoes its first input and the value
+// identifies the model.
+struct TaggedModel : Model {
+    TaggedModel(float tag) : Model{4, kModelInputChannels, 3, 3}, m_tag{tag} {}
+
+    void inference(std::span<float> states, Output const& out) override {
+        std::ranges::fill(out.priors, 1.0f);
+        for (int i = 0; i < int(out.values.size()); ++i) {
+            out.priors[prior_size() * i] = states[m_state_size * i];
+            out.values[i] = m_tag;
+        }
+    }
+
+    float m_tag;
+};
+
+static ModelLoader tagged_loader() {
+    return [](std::string const& name) -> std::unique_ptr<Model> {
+        if (name == "missing") {
+            throw std::runtime_error("No such model");
+        }
+        return std::make_unique<TaggedModel>(std::stof(name));
+    };
+}
+
+TEST_CASE("Inference is routed to the right model", "[Model Host]") {
+    ModelHost host{tagged_loader()};
+    auto const first = host.add_model("1");
+    auto const second = host.add_model("2");
+    CHECK(host.model_name(second) == "2");
+    CHECK(host.resident_models() == 0);
+
+    Board board{3, 3};
+    Turn turn{Player::Red, Turn::First};
+    auto state = convert_to_model_input(board, turn);
+
+    auto result = host.inference(first, board, turn).get();
+    CHECK(result.value == 1.0f);
+    CHECK(result.prior[0] == state[0]);
+    CHECK(host.inference(second, board, turn).get().value == 2.0f);
+
+    CHECK(host.total_loads() == 2);
+    CHECK(host.resident_models() == 2);
+
+    SECTION("Positions that do not fit the model fail on their own") {
+        CHECK_THROWS(host.inference(first, Board{4, 4}, turn).get());
+        CHECK(host.inference(first, board, turn).get().value == 1.0f);
+    }
+
+    SECTION("Models that fail to load fail their requests") {
+        auto const missing = host.add_model("missing");
+        CHECK_THROWS(host.inference(missing, board, turn).get());
+        CHECK(host.inference(second, board, turn).get().value == 2.0f);
+    }
+}
+
+TEST_CASE("Least recently used models are evicted", "[Model Host]") {
+    ModelHost host{tagged_loader(), ModelHostOptions{.max_resident_models = 2}};
+    std::vector<ModelHost::ModelId> ids;
+    for (std::string name : {"1", "2", "3"}) {
+        ids.push_back(host.add_model(name));
+    }
+
+    Board board{3, 3};
+    Turn turn{Player::Blue, Turn::First};
+    auto infer = [&](int i) { return host.inference(ids[i], board, turn).get().value; };
+
+    CHECK(infer(0) == 1.0f);
+    CHECK(infer(1) == 2.0f);
+    CHECK(infer(0) == 1.0f);
+    // Evicts the second model, which was used less recently than the first.
+    CHECK(infer(2) == 3.0f);
+    CHECK(infer(0) == 1.0f);
+
+    CHECK(host.total_loads() == 3);
+    CHECK(host.total_evictions() == 1);
+    CHECK(host.resident_models() == 2);
+
+    CHECK(infer(1) == 2.0f);
+    CHECK(host.total_loads() == 4);
+    CHECK(host.total_evictions() == 2);
+}
+
+TEST_CASE("Hosted model policy", "[Model Host]") {
+    auto host = std::make_shared<ModelHost>(tagged_loader());
+    HostedModelPolicy policy{host, host->add_model("0.5")};
+
+    Board board{3, 3};
+    auto eval = folly::coro::blockingWait(policy(board, {Player::Red, Turn::First}, {}));
+
+    CHECK(eval.value == 0.5f);
+    REQUIRE(!eval.edges.empty());
+
+    float total_prior = 0.0f;
+    for (TreeEdge const& edge : eval.edges) {
+        total_prior += edge.prior;
+    }
+    CHECK(std::abs(total_prior - 1.0f) < 1e-4f);
+}
+
+TEST_CASE("Ranking rounds keep the resident models stable", "[Model Host]") {
+    constexpr int kResidentModels = 4;
+    auto host = std::make_shared<ModelHost>(
+        tagged_loader(), ModelHostOptions{.max_resident_models = kResidentModels});
+
+    std::vector<NamedModel> models;
+    for (std::string name : {"0.1", "0.2", "0.3", "0.4", "0.5", "0.6", "0.7", "0.8"}) {
+        models.push_back(NamedModel{HostedModelPolicy{host, host->add_model(name)}, name});
+    }
+
+    auto const output_folder = std::filesystem::temp_directory_path() /
+                               ("model_host_test_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(output_folder);
+
+    // One tournament of eight models: four matchups, then two, then the final.
+    folly::CPUThreadPoolExecutor thread_pool(4);
+    auto const recorders = folly::coro::blockingWait(
+        ranking_play(Board{3, 3}, {.models = std::move(models),
+                                   .output_folder = output_folder,
+                                   .samples = 20,
+                                   .games_per_matchup = 4,
+                                   .num_tournaments = 1,
+                                   .max_parallel_samples = 4,
+                                   .move_limit = 10,
+                                   .max_models_in_flight = kResidentModels})
+            .scheduleOn(&thread_pool));
+    std::filesystem::remove_all(output_folder);
+
+    constexpr int kMatchups = 7;
+    CHECK(recorders.size() == kMatchups * 4);
+    // Each matchup loads at most its two models, and they stay loaded until it is over.
+    CHECK(host->total_loads() <= 2 * kMatchups);
+    CHECK(host->total_evictions() <= 2 * kMatchups - kResidentModels);
+}
@@ -0,0 +1,97 @@
+#include "opening_suite.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/experimental/coro/BlockingWait.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "simple_policy.hpp"
+
+static std::filesystem::path write_suite(std::string const& contents) {
+    auto path = std::filesystem::temp_directory_path() /
+                ("opening_suite_test_" + std::to_string(::getpid()) + ".txt");
+    std::ofstream{path} << contents;
+    return path;
+}
+
+TEST_CASE("Load openings in notation and as BGS configs", "[Opening Suite]") {
+    Board const board{8, 8, Variant::Standard};
+    auto const path = write_suite(
+        "# Cats first\n"
+        "\n"
+        "Cc1 Ch3\n"
+        R"({"name": "small", "variant": "standard", "boardWidth": 6, "boardHeight": 6, )"
+        R"("initialState": {"pawns": {"p1": {"cat": [5, 0], "mouse": [5, 5]}, )"
+        R"("p2": {"cat": [0, 5], "mouse": [0, 0]}}, "walls": []}, "moves": ["Ca4", "Cf3"]})"
+        "\n");
+    auto const openings = load_opening_suite(path, board);
+    std::filesystem::remove(path);
+
+    REQUIRE(openings.size() == 2);
+    CHECK(openings[0].name == "Cc1 Ch3");
+    CHECK(openings[0].board.position(Player::Red) == Cell{2, 0});
+    CHECK(openings[0].board.position(Player::Blue) == Cell{7, 2});
+
+    // Smaller boards are padded at the top left in the standard variant.
+    CHECK(openings[1].name == "small");
+    CHECK(openings[1].board.rows() == 8);
+    CHECK(openings[1].board.position(Player::Red) == Cell{0, 3});
+    CHECK(openings[1].board.position(Player::Blue) == Cell{5, 2});
+}
+
+TEST_CASE("Reject invalid openings", "[Opening Suite]") {
+    Board const board{8, 8, Variant::Standard};
+
+    auto check_rejected = [&](std::string const& contents) {
+        auto const path = write_suite(contents);
+        CHECK_THROWS(load_opening_suite(path, board));
+        std::filesystem::remove(path);
+    };
+
+    // Blue would be to move.
+    check_rejected("Cc1\n");
+    // The cat cannot leave the board.
+    check_rejected("Cc1 Ci2\n");
+    check_rejected("Cc1 nonsense\n");
+    check_rejected("# Only comments\n");
+    check_rejected(R"([{"variant": "classic", "boardWidth": 6, "boardHeight": 6}])");
+    CHECK_THROWS(load_opening_suite("/nonexistent/openings.txt", board));
+}
+
+TEST_CASE("Answer from the opening cache", "[Opening Suite]") {
+    folly::CPUThreadPoolExecutor thread_pool(4);
+    Board const board{5, 5};
+    std::vector<Opening> const openings{{"start", board}};
+
+    auto const cache = folly::coro::blockingWait(
+        OpeningCache::build(SimplePolicy{0.3, 1.5, 0.75}, openings, 50, 4)
+            .scheduleOn(&thread_pool));
+    CHECK(cache->size() > 1);
+
+    Turn const turn{Player::Red, Turn::First};
+    auto const cached = cache->find(board, turn, std::nullopt);
+    REQUIRE(cached);
+    CHECK(cached->compact);
+    CHECK(cache->hits() == 1);
+
+    Board const other{5, 5, Cell{2, 2}, Cell{0, 4}, Cell{4, 0}, Cell{4, 4}};
+    CHECK_FALSE(cache->find(other, turn, std::nullopt));
+    CHECK(cache->hits() == 1);
+
+    // The policy only asks the model about positions outside of the cache.
+    int model_calls = 0;
+    OpeningCachePolicy policy{
+        [&](Board const& board, Turn turn,
+            std::optional<PreviousPosition> previous_position) -> folly::coro::Task<Evaluation> {
+            ++model_calls;
+            co_return co_await SimplePolicy{0.3, 1.5, 0.75}(board, turn, previous_position);
+        },
+        cache};
+    folly::coro::blockingWait(policy(board, turn, std::nullopt));
+    CHECK(model_calls == 0);
+    folly::coro::blockingWait(policy(other, turn, std::nullopt));
+    CHECK(model_calls == 1);
+}
@@ -0,0 +1,109 @@
+#include "sprt.hpp"
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/experimental/coro/BlockingWait.h>
+
+#include <cmath>
+#include <random>
+
+#include "play.hpp"
+#include "simple_policy.hpp"
+
+// Plays pairs of games in which the tested model wins each game with the given probability.
+static SprtResult run_until_concluded(Sprt& sprt, double win_probability, int max_pairs,
+                                      std::uint32_t seed) {
+    std::mt19937 rng{seed};
+    std::bernoulli_distribution win(win_probability);
+    for (int i = 0; i < max_pairs && sprt.result() == SprtResult::Continue; ++i) {
+        sprt.add_pair(2 * win(rng) + 2 * win(rng));
+    }
+    return sprt.result();
+}
+
+// Never has a move, so it loses every game.
+struct ResigningPolicy {
+    folly::coro::Task<Evaluation> operator()(Board const&, Turn, std::optional<PreviousPosition>) {
+        co_return Evaluation{-1, {}};
+    };
+};
+
+TEST_CASE("SPRT bounds and statistics", "[SPRT]") {
+    Sprt sprt{{.elo0 = 0, .elo1 = 10, .alpha = 0.05, .beta = 0.1}};
+    CHECK(sprt.lower_bound() == Catch::Approx(std::log(0.1 / 0.95)));
+    CHECK(sprt.upper_bound() == Catch::Approx(std::log(0.9 / 0.05)));
+    CHECK(sprt.llr() == 0);
+    CHECK(sprt.result() == SprtResult::Continue);
+
+    sprt.add_pair(4);
+    sprt.add_pair(2);
+    sprt.add_pair(3);
+    sprt.add_pair(3);
+    CHECK(sprt.pairs() == 4);
+    CHECK(sprt.pentanomial() == std::array{0, 0, 1, 2, 1});
+    CHECK(sprt.score() == Catch::Approx(0.75));
+    CHECK(sprt.elo() == Catch::Approx(-400 * std::log10(1 / 0.75 - 1)));
+    CHECK(sprt.llr() > 0);
+
+    CHECK_THROWS(sprt.add_pair(5));
+    CHECK_THROWS(Sprt{{.elo0 = 10, .elo1 = 0}});
+    CHECK_THROWS(Sprt{{.alpha = 0}});
+}
+
+TEST_CASE("SPRT accepts the right hypothesis", "[SPRT]") {
+    SprtOptions const opts{.elo0 = 0, .elo1 = 30};
+
+    SECTION("Clearly stronger") {
+        Sprt sprt{opts};
+        // About 70 Elo.
+        CHECK(run_until_concluded(sprt, 0.6, 10000, 1) == SprtResult::AcceptH1);
+        CHECK(sprt.pairs() < 1000);
+    }
+
+    SECTION("Equally strong") {
+        Sprt sprt{opts};
+        CHECK(run_until_concluded(sprt, 0.5, 10000, 2) == SprtResult::AcceptH0);
+    }
+
+    SECTION("Weaker") {
+        Sprt sprt{opts};
+        CHECK(run_until_concluded(sprt, 0.4, 10000, 3) == SprtResult::AcceptH0);
+        CHECK(sprt.pairs() < 1000);
+    }
+
+    SECTION("Pairs with less variance conclude sooner") {
+        // The same score as winning the first game of each pair and losing the second, but
+        // without variance between pairs.
+        Sprt drawn{opts};
+        Sprt split{opts};
+        for (int i = 0; i < 200; ++i) {
+            drawn.add_pair(2);
+            split.add_pair(i % 2 == 0 ? 4 : 0);
+        }
+        CHECK(drawn.score() == split.score());
+        CHECK(drawn.llr() < split.llr());
+    }
+}
+
+TEST_CASE("Evaluation play stops once the SPRT concludes", "[SPRT]") {
+    folly::CPUThreadPoolExecutor thread_pool(4);
+    int const games = 100;
+
+    auto const recorders = folly::coro::blockingWait(
+        evaluation_play(Board{5, 5}, games,
+                        {.model1 = {SimplePolicy{0.3, 1.5, 0.75}, "Simple"},
+                         .model2 = {ResigningPolicy{}, "Resigning"},
+                         .samples = 20,
+                         .max_parallel_games = 4,
+                         .sprt = SprtOptions{.elo0 = 0, .elo1 = 100}})
+            .scheduleOn(&thread_pool));
+
+    // Only complete pairs are returned.
+    CHECK(recorders.size() % 2 == 0);
+    CHECK(recorders.size() >= 2);
+    CHECK(int(recorders.size()) < games);
+
+    auto const results = tally_results(recorders).at("Simple");
+    CHECK(results.wins == int(recorders.size()));
+}
@@ -0,0 +1,105 @@
+#include "wwnet.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "onnx_graph.hpp"
+
+static std::filesystem::path const kModel = DEEP_WW_MODELS_DIR "/8x8_750000.onnx";
+
+static std::filesystem::path temporary_path(std::string const& name) {
+    return std::filesystem::temp_directory_path() / name;
+}
+
+static std::vector<float> run(CpuResNetModel& model) {
+    std::vector<float> states(std::size_t(model.state_size()) * model.batch_size());
+    for (std::size_t i = 0; i < states.size(); ++i) {
+        states[i] = float(i * 37 % 101) / 100.0f;
+    }
+    std::vector<float> out(std::size_t(model.prior_size() + 1) * model.batch_size());
+    auto const priors = std::span(out).first(std::size_t(model.prior_size()) * model.batch_size());
+    auto const values = std::span(out).subspan(priors.size());
+    model.inference(states, {priors, values});
+    return out;
+}
+
+TEST_CASE("Wwnet files reproduce the ONNX model", "[Wwnet]") {
+    auto const path = temporary_path("deep_ww_test.wwnet");
+    auto const network = pack_resnet(resnet_from_onnx(read_onnx_graph(kModel)));
+    write_wwnet(network, path);
+
+    CpuResNetModel expected{network, 2};
+    auto mapped = map_wwnet(path);
+    CHECK(mapped.columns == 8);
+    CHECK(mapped.rows == 8);
+    CHECK(mapped.convs.size() == network.convs.size());
+    CHECK(reinterpret_cast<std::uintptr_t>(mapped.convs[1].weights.data()) % kWwnetAlignment == 0);
+
+    // The mapping outlives the file and the PackedResNet.
+    std::filesystem::remove(path);
+    CpuResNetModel model{std::move(mapped), 2};
+    CHECK(run(model) == run(expected));
+}
+
+TEST_CASE("Invalid wwnet files are rejected", "[Wwnet]") {
+    auto const path = temporary_path("deep_ww_invalid_test.wwnet");
+    write_wwnet(pack_resnet(resnet_from_onnx(read_onnx_graph(kModel))), path);
+    auto const size = std::filesystem::file_size(path);
+
+    auto patch = [&](std::size_t offset, std::uint32_t value) {
+        std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+        file.seekp(std::streamoff(offset));
+        file.write(reinterpret_cast<char const*>(&value), sizeof(value));
+    };
+
+    SECTION("Truncated") {
+        std::filesystem::resize_file(path, size - 1);
+        CHECK_THROWS(map_wwnet(path));
+    }
+
+    SECTION("Wrong magic") {
+        patch(offsetof(WwnetHeader, magic), 0);
+        CHECK_THROWS(map_wwnet(path));
+    }
+
+    SECTION("Other block size") {
+        patch(offsetof(WwnetHeader, conv_block), kConvBlock * 2);
+        CHECK_THROWS(map_wwnet(path));
+    }
+
+    SECTION("Other board size") {
+        patch(offsetof(WwnetHeader, rows), 4);
+        CHECK_THROWS(map_wwnet(path));
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Benchmark cold start to first inference", "[.benchmark][Wwnet]") {
+    auto const path = temporary_path("deep_ww_benchmark.wwnet");
+    write_wwnet(pack_resnet(resnet_from_onnx(read_onnx_graph(kModel))), path);
+
+    auto time = [](auto const& load) {
+        auto const start = std::chrono::steady_clock::now();
+        auto model = load();
+        auto const loaded = std::chrono::steady_clock::now();
+        run(*model);
+        auto const done = std::chrono::steady_clock::now();
+        std::cout << std::chrono::duration<double, std::milli>(loaded - start).count()
+                  << " ms to load, "
+                  << std::chrono::duration<double, std::milli>(done - start).count()
+                  << " ms to the first inference\n";
+    };
+
+    std::cout << ".onnx: ";
+    time([] { return load_cpu_resnet(kModel, 1); });
+    std::cout << ".wwnet: ";
+    time([&] { return load_cpu_resnet(path, 1); });
+
+    std::filesystem::remove(path);
+}